@@ -0,0 +1,53 @@
+#include "admission_controller.h"
+
+namespace {
+
+const int MAX_RETRY_INTERVALS = 10;
+
+} // namespace
+
+AdmissionController::AdmissionController(int targetMs, int intervalMs)
+    : shedFrom(RequestClass::BROWSE)
+    , aboveTarget(false)
+    , windowStart(0)
+    , overloadedIntervals(0)
+    , overloadedUntil(0)
+    , retryAfterMs(0)
+{
+    setTarget(targetMs, intervalMs);
+}
+
+void AdmissionController::setTarget(int targetMs, int intervalMs)
+{
+    this->targetMs = targetMs > 0 ? targetMs : 1;
+    this->intervalMs = intervalMs > this->targetMs ? intervalMs : this->targetMs;
+    retryAfterMs.store(static_cast<quint32>(this->intervalMs), std::memory_order_relaxed);
+}
+
+void AdmissionController::recordSojourn(qint64 sojournMs)
+{
+    std::lock_guard<std::mutex> locker(mutex);
+    // 队列排空过, 立即恢复接收
+    if (sojournMs < targetMs) {
+        aboveTarget = false;
+        overloadedIntervals = 0;
+        overloadedUntil.store(0, std::memory_order_relaxed);
+        return;
+    }
+
+    const qint64 now = nowMs();
+    if (!aboveTarget) {
+        aboveTarget = true;
+        windowStart = now;
+        return;
+    }
+    if (now - windowStart < intervalMs)
+        return;
+
+    // 整个 interval 都没有低于 target 的样本
+    overloadedIntervals = qMin(overloadedIntervals + 1, MAX_RETRY_INTERVALS);
+    retryAfterMs.store(static_cast<quint32>(intervalMs * overloadedIntervals), std::memory_order_relaxed);
+    // 下一次判定在一个 interval 之后, 多留一个 interval 避免两次判定之间出现空档
+    overloadedUntil.store(now + 2 * intervalMs, std::memory_order_relaxed);
+    windowStart = now;
+}
@@ -0,0 +1,56 @@
+#ifndef ADMISSION_CONTROLLER_H
+#define ADMISSION_CONTROLLER_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <QtGlobal>
+#include "request_scheduler.h"
+
+// 按排队时间做准入控制, 思路与 CoDel 相同: 一个 interval 内的最小排队时间都超过 target,
+// 说明队列没有排空过 (持续过载而不是突发), 此后新到的低优先级请求直接拒绝并给出建议的重试时间;
+// 出现一次低于 target 的排队时间或者两个 interval 内没有新的判定即恢复. 排队时间从网络层读到请求算起, 到拿到数据库为止,
+// 包含请求在本工作线程里排在同批其他请求后面的时间和在调度器里的等待
+// 所有工作线程共用一个数据库队列, 所以共用一份状态
+class AdmissionController
+{
+public:
+    AdmissionController(int targetMs = 10, int intervalMs = 100);
+
+    // 在服务启动前配置
+    void setTarget(int targetMs, int intervalMs);
+    // shedFrom 及优先级更低的类别在过载时被拒绝, 默认只拒绝浏览
+    void setShedFrom(RequestClass requestClass) { shedFrom = requestClass; }
+
+    // 请求拿到数据库时调用
+    void recordSojourn(qint64 sojournMs);
+
+    bool shouldShed(RequestClass requestClass) const
+    {
+        return requestClass >= shedFrom && overloadedUntil.load(std::memory_order_relaxed) > nowMs();
+    }
+    // 过载持续越久建议客户端等得越久, 最多 10 个 interval
+    quint32 retryAfter() const { return retryAfterMs.load(std::memory_order_relaxed); }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static qint64 nowMs()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    std::mutex mutex;
+    qint64 targetMs;
+    qint64 intervalMs;
+    RequestClass shedFrom;
+
+    bool aboveTarget;           // 最近的样本都超过 target
+    qint64 windowStart;         // 本轮 interval 的开始, 即连续超过 target 的起点
+    int overloadedIntervals;    // 连续过载的 interval 数
+    // 拒绝低优先级请求直到这个时刻; 被拒绝的请求不产生样本, 所以过载状态必须自己到期
+    std::atomic<qint64> overloadedUntil;
+    std::atomic<quint32> retryAfterMs;
+};
+
+#endif // ADMISSION_CONTROLLER_H
@@ -0,0 +1,100 @@
+// FrameDecoder 微基准: 混合大小的帧按随机长度切片喂入, 统计每秒解出的帧数
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "frame_decoder.h"
+
+namespace {
+
+// 浏览/购物车/心跳类小包为主, 少量商品列表和图片分块大包
+uint32_t pickBodySize(std::mt19937 &rng)
+{
+    std::uniform_int_distribution<int> bucket(0, 99);
+    const int b = bucket(rng);
+    if (b < 70)
+        return std::uniform_int_distribution<uint32_t>(16, 256)(rng);
+    if (b < 95)
+        return std::uniform_int_distribution<uint32_t>(1024, 4096)(rng);
+    return std::uniform_int_distribution<uint32_t>(16 * 1024, MAX_CHUNK_SIZE)(rng);
+}
+
+std::vector<char> buildStream(size_t frameCount, std::mt19937 &rng)
+{
+    std::vector<char> stream;
+    for (size_t i = 0; i < frameCount; ++i) {
+        const uint32_t bodySize = pickBodySize(rng);
+        const size_t offset = stream.size();
+        stream.resize(offset + PROTOCOL_HEADER_SIZE + bodySize, 'x');
+        ProtocolHelper::encodeHeader(
+            ProtocolHelper::makeHeader(MessageType::GET_PRODUCT_DETAIL_RESPONSE, bodySize, static_cast<uint32_t>(i)),
+            stream.data() + offset);
+    }
+    return stream;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const size_t frameCount = argc > 1 ? static_cast<size_t>(atol(argv[1])) : 200000;
+    const int rounds = argc > 2 ? atoi(argv[2]) : 10;
+
+    std::mt19937 rng(42);
+    const std::vector<char> stream = buildStream(frameCount, rng);
+
+    // 预先生成 TCP 读取的切片长度 (1B - 16KB), 测量时不掺入随机数开销
+    std::vector<size_t> cuts;
+    for (size_t pos = 0; pos < stream.size();) {
+        const size_t n = std::uniform_int_distribution<size_t>(1, 16 * 1024)(rng);
+        cuts.push_back(n);
+        pos += n;
+    }
+
+    FrameDecoder decoder;
+    size_t frames = 0;
+    uint64_t checksum = 0;
+    size_t capacityAfterWarmup = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; ++round) {
+        size_t pos = 0;
+        for (size_t cut : cuts) {
+            const size_t n = std::min(cut, stream.size() - pos);
+            if (n == 0)
+                break;
+            memcpy(decoder.prepareWrite(n), stream.data() + pos, n);
+            decoder.commitWrite(n);
+            pos += n;
+
+            FrameView frame;
+            FrameDecoder::Status status;
+            while ((status = decoder.next(frame)) == FrameDecoder::Status::FRAME_READY) {
+                ++frames;
+                checksum += frame.header.sequence_id + static_cast<unsigned char>(frame.body[0]);
+            }
+            if (status == FrameDecoder::Status::BAD_HEADER) {
+                fprintf(stderr, "decode error %d\n", static_cast<int>(decoder.error()));
+                return 1;
+            }
+        }
+        if (round == 0) {
+            capacityAfterWarmup = decoder.capacity();
+        }
+    }
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const double megabytes = static_cast<double>(stream.size()) * rounds / (1024.0 * 1024.0);
+    printf("frames:          %zu\n", frames);
+    printf("elapsed:         %.3f s\n", elapsed);
+    printf("frames/sec:      %.0f\n", frames / elapsed);
+    printf("throughput:      %.1f MB/s\n", megabytes / elapsed);
+    printf("buffer capacity: %zu bytes (after warmup %zu)\n", decoder.capacity(), capacityAfterWarmup);
+    printf("checksum:        %llu\n", static_cast<unsigned long long>(checksum));
+
+    // 第一轮之后缓冲区不应再增长
+    return decoder.capacity() == capacityAfterWarmup ? 0 : 2;
+}
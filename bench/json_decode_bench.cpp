@@ -0,0 +1,200 @@
+// JSON 消息体解码基准: nlohmann DOM (parse + get_to) 对比 json_codec.h 的流式解码
+// 用法: json_decode_bench [轮数] [抓包文件]
+// 抓包文件每行一条消息: 十进制 MessageType, 一个空格, JSON 消息体; 不给时使用内置的典型消息
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "json_codec.h"
+#include "protocol_json.h"
+
+namespace {
+
+struct Payload {
+    MessageType type;
+    std::string body;
+};
+
+// 按消息类型选择请求结构体, 两种解码各实例化一份
+template<typename T>
+bool decodeDom(const std::string& body, size_t& checksum)
+{
+    try {
+        T value{};
+        nlohmann::json::parse(body).get_to(value);
+        checksum += sizeof(value);
+        return true;
+    }
+    catch (const nlohmann::json::exception&) {
+        return false;
+    }
+}
+
+template<typename T>
+bool decodeStream(const std::string& body, size_t& checksum)
+{
+    T value{};
+    JsonReader reader(body.data(), body.size());
+    if (!decodeJson(reader, value) || !reader.finish())
+        return false;
+    checksum += sizeof(value);
+    return true;
+}
+
+using DecodeFunction = bool (*)(const std::string&, size_t&);
+
+struct Decoder {
+    MessageType type;
+    DecodeFunction dom;
+    DecodeFunction stream;
+};
+
+#define BENCH_DECODER(messageType, Type) { MessageType::messageType, &decodeDom<Type>, &decodeStream<Type> }
+
+const Decoder decoders[] = {
+    BENCH_DECODER(LOGIN_REQUEST, LoginRequest),
+    BENCH_DECODER(REGISTER_REQUEST, RegisterRequest),
+    BENCH_DECODER(GET_USER_INFO_REQUEST, UserInfoRequest),
+    BENCH_DECODER(GET_PRODUCT_LIST_REQUEST, ProductListRequest),
+    BENCH_DECODER(GET_PRODUCT_LIST_RESPONSE, ProductListResponse),
+    BENCH_DECODER(GET_PRODUCT_DETAIL_REQUEST, ProductDetailRequest),
+    BENCH_DECODER(GET_PRODUCT_DETAIL_RESPONSE, ProductDetailResponse),
+    BENCH_DECODER(CREATE_PRODUCT_REQUEST, CreateProductRequest),
+    BENCH_DECODER(GET_CART_REQUEST, GetCartRequest),
+    BENCH_DECODER(ADD_TO_CART_REQUEST, AddToCartRequest),
+    BENCH_DECODER(UPDATE_CART_ITEM_REQUEST, UpdateCartItemRequest),
+    BENCH_DECODER(CREATE_ORDER_REQUEST, CreateOrderRequest),
+    BENCH_DECODER(GET_ORDER_LIST_REQUEST, OrderListRequest),
+};
+
+const Decoder* findDecoder(MessageType type)
+{
+    for (const Decoder& decoder : decoders) {
+        if (decoder.type == type)
+            return &decoder;
+    }
+    return nullptr;
+}
+
+// 内置消息按客户端实际发出的字段生成, 商品数据取自 data/data.db 中的样例行
+std::vector<Payload> builtinPayloads()
+{
+    std::vector<Payload> payloads;
+    auto add = [&payloads](MessageType type, const auto& value) {
+        Payload payload{ type, std::string() };
+        encodeJson(payload.body, value);
+        payloads.push_back(std::move(payload));
+    };
+
+    add(MessageType::LOGIN_REQUEST, LoginRequest{ "cnm", "liupass" });
+    add(MessageType::GET_PRODUCT_LIST_REQUEST, ProductListRequest{ 1, 20, "cate", "" });
+    add(MessageType::GET_PRODUCT_LIST_REQUEST, ProductListRequest{ 3, 20, "", "机械键盘 87键" });
+    add(MessageType::GET_PRODUCT_DETAIL_REQUEST, ProductDetailRequest{ 123 });
+    add(MessageType::ADD_TO_CART_REQUEST, AddToCartRequest{ 255, OrderItem{ 123, 1, 2, 34.0 } });
+    add(MessageType::UPDATE_CART_ITEM_REQUEST, UpdateCartItemRequest{ 255, 123, 1, 3 });
+    add(MessageType::CREATE_ORDER_REQUEST, CreateOrderRequest{ 255, "sanda 5号楼 301", 1.0, "" });
+    add(MessageType::GET_ORDER_LIST_REQUEST, OrderListRequest{ 255, 1, 10, 0 });
+
+    Product product{};
+    product.productID = 123;
+    product.description = "desc 商品详细描述, 包含材质, 尺寸和售后说明";
+    product.brief_description = "brief";
+    product.description_imageURLs = { "url1", "url2", "url3" };
+    product.specification = "sprci";
+    product.brand = "brand";
+    product.product_class = { ProductClass{ 3, 34, "34", "标准版", 34.0 }, ProductClass{ 4, 12, "35", "加强版", 49.9 } };
+    product.productName = "name";
+    product.category = "cate";
+    product.sellerID = 234;
+    product.salesCount = 4;
+
+    ProductDetailResponse detail{};
+    detail.product = product;
+    add(MessageType::GET_PRODUCT_DETAIL_RESPONSE, detail);
+
+    ProductListResponse list{};
+    for (int i = 0; i < 20; ++i) {
+        product.productID = 100 + i;
+        list.products.push_back(product);
+    }
+    list.total_count = 200;
+    list.total_pages = 10;
+    add(MessageType::GET_PRODUCT_LIST_RESPONSE, list);
+    return payloads;
+}
+
+bool loadCapture(const char* path, std::vector<Payload>& payloads)
+{
+    std::ifstream in(path);
+    if (!in) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        const size_t space = line.find(' ');
+        if (space == std::string::npos)
+            continue;
+        const auto type = static_cast<MessageType>(atoi(line.substr(0, space).c_str()));
+        if (!findDecoder(type))
+            continue;
+        payloads.push_back(Payload{ type, line.substr(space + 1) });
+    }
+    return true;
+}
+
+double run(const std::vector<Payload>& payloads, int rounds, bool stream, size_t& checksum)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; ++round) {
+        for (const Payload& payload : payloads) {
+            const Decoder* decoder = findDecoder(payload.type);
+            if (!(stream ? decoder->stream : decoder->dom)(payload.body, checksum)) {
+                fprintf(stderr, "decode failed: %s\n", payload.body.c_str());
+                exit(1);
+            }
+        }
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    const int rounds = argc > 1 ? atoi(argv[1]) : 20000;
+
+    std::vector<Payload> payloads;
+    if (argc > 2) {
+        if (!loadCapture(argv[2], payloads))
+            return 1;
+    }
+    else {
+        payloads = builtinPayloads();
+    }
+    if (payloads.empty()) {
+        fprintf(stderr, "no payloads\n");
+        return 1;
+    }
+
+    size_t bytes = 0;
+    for (const Payload& payload : payloads) {
+        bytes += payload.body.size();
+    }
+
+    size_t domChecksum = 0;
+    size_t streamChecksum = 0;
+    const double domSeconds = run(payloads, rounds, false, domChecksum);
+    const double streamSeconds = run(payloads, rounds, true, streamChecksum);
+
+    const double messages = static_cast<double>(payloads.size()) * rounds;
+    const double megabytes = static_cast<double>(bytes) * rounds / (1024.0 * 1024.0);
+    printf("payloads:        %zu (%zu bytes)\n", payloads.size(), bytes);
+    printf("dom:             %.0f msg/s, %.1f MB/s\n", messages / domSeconds, megabytes / domSeconds);
+    printf("stream:          %.0f msg/s, %.1f MB/s\n", messages / streamSeconds, megabytes / streamSeconds);
+    printf("speedup:         %.2fx\n", domSeconds / streamSeconds);
+
+    return domChecksum == streamChecksum ? 0 : 2;
+}
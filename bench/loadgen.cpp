@@ -0,0 +1,686 @@
+// 压测客户端: 模拟大量买家连接, 按比例发送登录, 浏览, 加购, 下单和秒杀请求, 统计各类请求的吞吐和延迟分位数
+// 用法: irondeal_loadgen [--host=127.0.0.1] [--port=8888] [--clients=1000] [--threads=4] [--duration=30]
+//       [--warmup=2] [--mix=login:1,list:20,detail:40,cart:20,checkout:10,seckill:9] [--products=100]
+//       [--seckill-product=1] [--codec=json|binary] [--think=0] [--user-prefix=loadgen]
+// 每个模拟客户端同一时间只有一个请求在途 (闭环), 收到响应后等待 think 毫秒再发下一个;
+// 连接后先注册 (用户已存在时失败, 忽略) 再登录, 之后按比例随机选择请求; 秒杀为加购和下单放在一个批量请求里
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <random>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "body_codec.h"
+#include "frame_decoder.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum Operation {
+    OP_LOGIN,
+    OP_LIST,
+    OP_DETAIL,
+    OP_CART,
+    OP_CHECKOUT,
+    OP_SECKILL,
+    OP_COUNT
+};
+
+const char* const OPERATION_NAMES[OP_COUNT] = { "login", "list", "detail", "cart", "checkout", "seckill" };
+
+// 统计按请求的 MessageType 归类, 秒杀是 BATCH_REQUEST; 注册只在连接时发一次, 同样计入
+struct TypeName {
+    MessageType type;
+    const char* name;
+};
+
+const TypeName REPORTED_TYPES[] = {
+    { MessageType::REGISTER_REQUEST, "REGISTER" },
+    { MessageType::LOGIN_REQUEST, "LOGIN" },
+    { MessageType::GET_PRODUCT_LIST_REQUEST, "GET_PRODUCT_LIST" },
+    { MessageType::GET_PRODUCT_DETAIL_REQUEST, "GET_PRODUCT_DETAIL" },
+    { MessageType::ADD_TO_CART_REQUEST, "ADD_TO_CART" },
+    { MessageType::CREATE_ORDER_REQUEST, "CREATE_ORDER" },
+    { MessageType::BATCH_REQUEST, "BATCH (seckill)" },
+};
+
+struct Config {
+    std::string host = "127.0.0.1";
+    int port = 8888;
+    int clients = 1000;
+    int threads = 4;
+    int duration = 30;      // 秒, 不含预热
+    int warmup = 2;         // 秒, 期间的请求不计入统计
+    int weights[OP_COUNT] = { 1, 20, 40, 20, 10, 9 };
+    int products = 100;
+    int seckillProduct = 1;
+    BodyCodec codec = BodyCodec::JSON;
+    int thinkMs = 0;
+    std::string userPrefix = "loadgen";
+};
+
+struct TypeStats {
+    uint64_t errors = 0;        // 业务错误 (不含下面两类)
+    uint64_t rateLimited = 0;
+    uint64_t overloaded = 0;
+    std::vector<uint32_t> latencies;    // 微秒, 只记录成功的请求
+};
+
+// 每个线程一份, 结束后合并
+struct ThreadStats {
+    std::map<uint16_t, TypeStats> types;
+    uint64_t connectFailures = 0;
+    uint64_t disconnects = 0;
+};
+
+enum class ClientState {
+    CONNECTING,
+    REGISTERING,
+    LOGGING_IN,
+    RUNNING,
+    CLOSED
+};
+
+struct SimClient {
+    int fd = -1;
+    int index = 0;
+    ClientState state = ClientState::CONNECTING;
+    int userID = 0;
+    FrameDecoder decoder;
+    QByteArray out;
+    qsizetype outPos = 0;
+    bool waitingWrite = false;
+    uint32_t sequence = 0;
+    MessageType inflight = MessageType::UNKNOWN;
+    Clock::time_point sentAt;
+    Clock::time_point nextSendAt;   // think 时间结束的时刻
+    bool idle = false;              // 正在 think, 没有请求在途
+};
+
+class Worker
+{
+public:
+    Worker(const Config& config, const sockaddr_in& address, int firstClient, int clientCount, uint32_t seed)
+        : config(config)
+        , address(address)
+        , rng(seed)
+        , clients(static_cast<size_t>(clientCount))
+    {
+        for (int i = 0; i < clientCount; ++i) {
+            clients[static_cast<size_t>(i)].index = firstClient + i;
+        }
+        for (int i = 0; i < OP_COUNT; ++i) {
+            totalWeight += config.weights[i];
+        }
+    }
+
+    void run(Clock::time_point measureFrom, Clock::time_point stopAt);
+    const ThreadStats& statistics() const { return stats; }
+
+private:
+    void connectClient(SimClient& client);
+    void closeClient(SimClient& client, bool failure);
+    void onReadable(SimClient& client);
+    bool flush(SimClient& client);
+    void onResponse(SimClient& client, const FrameView& frame);
+    void sendNext(SimClient& client);
+    void send(SimClient& client, MessageType type, const std::string& body);
+    template<typename Request>
+    void sendRequest(SimClient& client, MessageType type, const Request& request);
+    void record(const SimClient& client, ErrorCode code);
+    void updateEvents(SimClient& client);
+
+    const Config& config;
+    sockaddr_in address;
+    std::mt19937 rng;
+    std::vector<SimClient> clients;
+    int totalWeight = 0;
+    int epollFd = -1;
+    bool measuring = false;
+    ThreadStats stats;
+    std::string bodyBuffer;
+};
+
+template<typename Request>
+void Worker::sendRequest(SimClient& client, MessageType type, const Request& request)
+{
+    bodyBuffer.clear();
+    encodeBody(config.codec, request, bodyBuffer);
+    send(client, type, bodyBuffer);
+}
+
+void Worker::run(Clock::time_point measureFrom, Clock::time_point stopAt)
+{
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        perror("epoll_create1");
+        return;
+    }
+    for (SimClient& client : clients) {
+        connectClient(client);
+    }
+
+    epoll_event events[256];
+    for (;;) {
+        const Clock::time_point now = Clock::now();
+        measuring = now >= measureFrom;
+        if (now >= stopAt)
+            break;
+
+        // 有客户端在 think 时每毫秒检查一次
+        const int timeout = config.thinkMs > 0 ? 1 : 100;
+        const int n = epoll_wait(epollFd, events, 256, timeout);
+        if (n < 0 && errno != EINTR) {
+            perror("epoll_wait");
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            SimClient& client = clients[events[i].data.u32];
+            if (client.state == ClientState::CLOSED)
+                continue;
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                closeClient(client, client.state == ClientState::CONNECTING);
+                continue;
+            }
+            if (events[i].events & EPOLLOUT) {
+                if (client.state == ClientState::CONNECTING) {
+                    int error = 0;
+                    socklen_t length = sizeof(error);
+                    getsockopt(client.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+                    if (error != 0) {
+                        closeClient(client, true);
+                        continue;
+                    }
+                    // 连接建立后先注册再登录, 用户名按客户端编号固定, 重复运行时注册失败但登录成功
+                    client.state = ClientState::REGISTERING;
+                    const std::string name = config.userPrefix + std::to_string(client.index);
+                    sendRequest(client, MessageType::REGISTER_REQUEST, RegisterRequest{ name, name, name, "" });
+                }
+                else if (!flush(client)) {
+                    closeClient(client, false);
+                    continue;
+                }
+            }
+            if ((events[i].events & EPOLLIN) && client.state != ClientState::CLOSED)
+                onReadable(client);
+        }
+
+        if (config.thinkMs > 0) {
+            const Clock::time_point wake = Clock::now();
+            for (SimClient& client : clients) {
+                if (client.idle && client.state == ClientState::RUNNING && wake >= client.nextSendAt)
+                    sendNext(client);
+            }
+        }
+    }
+
+    for (SimClient& client : clients) {
+        if (client.fd >= 0)
+            ::close(client.fd);
+    }
+    ::close(epollFd);
+}
+
+void Worker::connectClient(SimClient& client)
+{
+    client.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (client.fd < 0) {
+        ++stats.connectFailures;
+        client.state = ClientState::CLOSED;
+        return;
+    }
+    const int one = 1;
+    setsockopt(client.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(client.fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0
+        && errno != EINPROGRESS) {
+        closeClient(client, true);
+        return;
+    }
+
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLOUT;
+    event.data.u32 = static_cast<uint32_t>(&client - clients.data());
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, client.fd, &event);
+    client.waitingWrite = true;
+}
+
+void Worker::closeClient(SimClient& client, bool failure)
+{
+    if (failure)
+        ++stats.connectFailures;
+    else
+        ++stats.disconnects;
+    if (client.fd >= 0) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, client.fd, nullptr);
+        ::close(client.fd);
+    }
+    client.fd = -1;
+    client.state = ClientState::CLOSED;
+}
+
+void Worker::updateEvents(SimClient& client)
+{
+    const bool wantWrite = client.outPos < client.out.size();
+    if (wantWrite == client.waitingWrite)
+        return;
+    epoll_event event{};
+    event.events = wantWrite ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    event.data.u32 = static_cast<uint32_t>(&client - clients.data());
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, client.fd, &event);
+    client.waitingWrite = wantWrite;
+}
+
+bool Worker::flush(SimClient& client)
+{
+    while (client.outPos < client.out.size()) {
+        const ssize_t n = ::send(client.fd, client.out.constData() + client.outPos,
+            static_cast<size_t>(client.out.size() - client.outPos), MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        client.outPos += n;
+    }
+    if (client.outPos == client.out.size()) {
+        client.out.resize(0);
+        client.outPos = 0;
+    }
+    updateEvents(client);
+    return true;
+}
+
+void Worker::onReadable(SimClient& client)
+{
+    for (;;) {
+        char* buffer = client.decoder.prepareWrite(16 * 1024);
+        const ssize_t n = ::recv(client.fd, buffer, client.decoder.writableBytes(), 0);
+        if (n == 0) {
+            closeClient(client, false);
+            return;
+        }
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                closeClient(client, false);
+            return;
+        }
+        client.decoder.commitWrite(static_cast<size_t>(n));
+
+        FrameView frame;
+        FrameDecoder::Status status;
+        while ((status = client.decoder.next(frame)) == FrameDecoder::Status::FRAME_READY) {
+            onResponse(client, frame);
+            if (client.state == ClientState::CLOSED)
+                return;
+        }
+        if (status == FrameDecoder::Status::BAD_HEADER) {
+            fprintf(stderr, "client %d: invalid frame from server\n", client.index);
+            closeClient(client, false);
+            return;
+        }
+    }
+}
+
+void Worker::send(SimClient& client, MessageType type, const std::string& body)
+{
+    client.inflight = type;
+    client.idle = false;
+    client.sentAt = Clock::now();
+    ProtocolHelper::appendMessage(client.out, type, body.data(), static_cast<uint32_t>(body.size()),
+        ++client.sequence, ProtocolHelper::versionForCodec(config.codec));
+    if (!flush(client))
+        closeClient(client, false);
+}
+
+void Worker::record(const SimClient& client, ErrorCode code)
+{
+    if (!measuring)
+        return;
+    TypeStats& typeStats = stats.types[static_cast<uint16_t>(client.inflight)];
+    if (code == ErrorCode::SUCCESS) {
+        const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - client.sentAt);
+        typeStats.latencies.push_back(static_cast<uint32_t>(elapsed.count()));
+    }
+    else if (code == ErrorCode::RATE_LIMITED) {
+        ++typeStats.rateLimited;
+    }
+    else if (code == ErrorCode::SERVER_OVERLOADED) {
+        ++typeStats.overloaded;
+    }
+    else {
+        ++typeStats.errors;
+    }
+}
+
+// 只解码响应开头的 BaseResponse; 二进制编码下其余字段留在末尾, 不能经 decodeBody 整体校验
+ErrorCode baseResponseCode(BodyCodec codec, const char* body, uint32_t length)
+{
+    BaseResponse response{};
+    if (codec == BodyCodec::BINARY) {
+        BinaryReader reader(body, length);
+        return decode(reader, response) ? response.error_code : ErrorCode::UNKNOWN_ERROR;
+    }
+    return decodeBody(codec, body, length, response) ? response.error_code : ErrorCode::UNKNOWN_ERROR;
+}
+
+// 从响应中取出错误码; 批量响应以最后一个子响应 (下单) 为准
+ErrorCode responseCode(const FrameView& frame, BodyCodec codec, int* userID)
+{
+    if (frame.type() == MessageType::ERROR_RESPONSE) {
+        ErrorResponse error{};
+        return decodeBody(codec, frame.body, frame.body_length, error) ? error.error_code : ErrorCode::UNKNOWN_ERROR;
+    }
+    if (frame.type() == MessageType::LOGIN_RESPONSE) {
+        LoginResponse login{};
+        if (!decodeBody(codec, frame.body, frame.body_length, login))
+            return ErrorCode::UNKNOWN_ERROR;
+        *userID = login.user_id;
+        return login.error_code;
+    }
+    if (frame.type() == MessageType::REGISTER_RESPONSE) {
+        RegisterResponse registered{};
+        if (!decodeBody(codec, frame.body, frame.body_length, registered))
+            return ErrorCode::UNKNOWN_ERROR;
+        *userID = registered.user_id;
+        return registered.error_code;
+    }
+
+    const char* body = frame.body;
+    uint32_t length = frame.body_length;
+    if (frame.type() == MessageType::BATCH_RESPONSE) {
+        const char* cursor = frame.body;
+        const char* end = frame.body + frame.body_length;
+        MessageType type = MessageType::UNKNOWN;
+        while (cursor < end) {
+            if (!ProtocolHelper::readBatchItem(cursor, end, type, body, length))
+                return ErrorCode::UNKNOWN_ERROR;
+        }
+        if (type == MessageType::ERROR_RESPONSE) {
+            ErrorResponse error{};
+            return decodeBody(codec, body, length, error) ? error.error_code : ErrorCode::UNKNOWN_ERROR;
+        }
+    }
+    return baseResponseCode(codec, body, length);
+}
+
+void Worker::onResponse(SimClient& client, const FrameView& frame)
+{
+    // 推送和心跳不属于在途请求
+    if (frame.header.sequence_id != client.sequence || client.inflight == MessageType::UNKNOWN)
+        return;
+
+    int userID = 0;
+    const ErrorCode code = responseCode(frame, config.codec, &userID);
+    record(client, code);
+    client.inflight = MessageType::UNKNOWN;
+
+    if (client.state == ClientState::REGISTERING) {
+        client.state = ClientState::LOGGING_IN;
+        const std::string name = config.userPrefix + std::to_string(client.index);
+        sendRequest(client, MessageType::LOGIN_REQUEST, LoginRequest{ name, name });
+        return;
+    }
+    if (client.state == ClientState::LOGGING_IN) {
+        if (code != ErrorCode::SUCCESS) {
+            fprintf(stderr, "client %d: login failed (%d)\n", client.index, static_cast<int>(code));
+            closeClient(client, false);
+            return;
+        }
+        client.userID = userID;
+        client.state = ClientState::RUNNING;
+    }
+    else if (frame.type() == MessageType::LOGIN_RESPONSE && code == ErrorCode::SUCCESS) {
+        client.userID = userID;
+    }
+
+    if (config.thinkMs > 0) {
+        client.idle = true;
+        client.nextSendAt = Clock::now() + std::chrono::milliseconds(config.thinkMs);
+        return;
+    }
+    sendNext(client);
+}
+
+void Worker::sendNext(SimClient& client)
+{
+    int pick = std::uniform_int_distribution<int>(0, totalWeight - 1)(rng);
+    int operation = 0;
+    while (pick >= config.weights[operation]) {
+        pick -= config.weights[operation];
+        ++operation;
+    }
+    const int productID = std::uniform_int_distribution<int>(1, config.products)(rng);
+    const std::string name = config.userPrefix + std::to_string(client.index);
+
+    switch (operation) {
+    case OP_LOGIN:
+        sendRequest(client, MessageType::LOGIN_REQUEST, LoginRequest{ name, name });
+        break;
+    case OP_LIST:
+        sendRequest(client, MessageType::GET_PRODUCT_LIST_REQUEST,
+            ProductListRequest{ std::uniform_int_distribution<int>(1, 10)(rng), 20, "", "" });
+        break;
+    case OP_DETAIL:
+        sendRequest(client, MessageType::GET_PRODUCT_DETAIL_REQUEST, ProductDetailRequest{ productID });
+        break;
+    case OP_CART: {
+        AddToCartRequest request{};
+        request.user_id = client.userID;
+        request.item = OrderItem{ productID, 1, 1, 0.0 };
+        sendRequest(client, MessageType::ADD_TO_CART_REQUEST, request);
+        break;
+    }
+    case OP_CHECKOUT:
+        sendRequest(client, MessageType::CREATE_ORDER_REQUEST,
+            CreateOrderRequest{ client.userID, "loadgen address", 1.0, "" });
+        break;
+    case OP_SECKILL: {
+        // 抢同一件商品: 加购和下单在一个批量请求里, 服务端放进同一个事务
+        AddToCartRequest cart{};
+        cart.user_id = client.userID;
+        cart.item = OrderItem{ config.seckillProduct, 1, 1, 0.0 };
+        QByteArray batch;
+        bodyBuffer.clear();
+        encodeBody(config.codec, cart, bodyBuffer);
+        ProtocolHelper::appendBatchItem(batch, MessageType::ADD_TO_CART_REQUEST, bodyBuffer.data(),
+            static_cast<uint32_t>(bodyBuffer.size()));
+        bodyBuffer.clear();
+        encodeBody(config.codec, CreateOrderRequest{ client.userID, "loadgen address", 1.0, "" }, bodyBuffer);
+        ProtocolHelper::appendBatchItem(batch, MessageType::CREATE_ORDER_REQUEST, bodyBuffer.data(),
+            static_cast<uint32_t>(bodyBuffer.size()));
+        send(client, MessageType::BATCH_REQUEST, std::string(batch.constData(), static_cast<size_t>(batch.size())));
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+bool parseMix(const std::string& value, int weights[OP_COUNT])
+{
+    std::fill(weights, weights + OP_COUNT, 0);
+    size_t start = 0;
+    while (start < value.size()) {
+        size_t end = value.find(',', start);
+        if (end == std::string::npos)
+            end = value.size();
+        const std::string item = value.substr(start, end - start);
+        const size_t colon = item.find(':');
+        if (colon == std::string::npos)
+            return false;
+        const std::string name = item.substr(0, colon);
+        const int weight = atoi(item.c_str() + colon + 1);
+        int operation = 0;
+        while (operation < OP_COUNT && name != OPERATION_NAMES[operation]) {
+            ++operation;
+        }
+        if (operation == OP_COUNT || weight < 0)
+            return false;
+        weights[operation] = weight;
+        start = end + 1;
+    }
+    int total = 0;
+    for (int i = 0; i < OP_COUNT; ++i) {
+        total += weights[i];
+    }
+    return total > 0;
+}
+
+bool parseArguments(int argc, char* argv[], Config& config)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        const size_t equals = argument.find('=');
+        if (argument.compare(0, 2, "--") != 0 || equals == std::string::npos) {
+            fprintf(stderr, "bad argument: %s\n", argv[i]);
+            return false;
+        }
+        const std::string key = argument.substr(2, equals - 2);
+        const std::string value = argument.substr(equals + 1);
+        if (key == "host")
+            config.host = value;
+        else if (key == "port")
+            config.port = atoi(value.c_str());
+        else if (key == "clients")
+            config.clients = atoi(value.c_str());
+        else if (key == "threads")
+            config.threads = atoi(value.c_str());
+        else if (key == "duration")
+            config.duration = atoi(value.c_str());
+        else if (key == "warmup")
+            config.warmup = atoi(value.c_str());
+        else if (key == "products")
+            config.products = atoi(value.c_str());
+        else if (key == "seckill-product")
+            config.seckillProduct = atoi(value.c_str());
+        else if (key == "think")
+            config.thinkMs = atoi(value.c_str());
+        else if (key == "user-prefix")
+            config.userPrefix = value;
+        else if (key == "codec" && (value == "json" || value == "binary"))
+            config.codec = value == "json" ? BodyCodec::JSON : BodyCodec::BINARY;
+        else if (key == "mix") {
+            if (!parseMix(value, config.weights)) {
+                fprintf(stderr, "bad mix: %s\n", value.c_str());
+                return false;
+            }
+        }
+        else {
+            fprintf(stderr, "unknown argument: %s\n", argv[i]);
+            return false;
+        }
+    }
+    if (config.clients <= 0 || config.threads <= 0 || config.duration <= 0 || config.products <= 0) {
+        fprintf(stderr, "clients, threads, duration and products must be positive\n");
+        return false;
+    }
+    config.threads = std::min(config.threads, config.clients);
+    return true;
+}
+
+double percentile(const std::vector<uint32_t>& sorted, double q)
+{
+    if (sorted.empty())
+        return 0.0;
+    const size_t index = std::min(sorted.size() - 1, static_cast<size_t>(q * static_cast<double>(sorted.size())));
+    return sorted[index] / 1000.0;
+}
+
+void report(const std::vector<Worker*>& workers, double seconds)
+{
+    ThreadStats total;
+    for (const Worker* worker : workers) {
+        const ThreadStats& stats = worker->statistics();
+        total.connectFailures += stats.connectFailures;
+        total.disconnects += stats.disconnects;
+        for (const auto& entry : stats.types) {
+            TypeStats& merged = total.types[entry.first];
+            merged.errors += entry.second.errors;
+            merged.rateLimited += entry.second.rateLimited;
+            merged.overloaded += entry.second.overloaded;
+            merged.latencies.insert(merged.latencies.end(), entry.second.latencies.begin(),
+                entry.second.latencies.end());
+        }
+    }
+
+    printf("%-20s %10s %10s %8s %8s %8s %9s %9s %9s %9s %9s\n", "type", "ok", "ok/s", "errors", "limited",
+        "shed", "p50 ms", "p90 ms", "p99 ms", "p99.9 ms", "max ms");
+    uint64_t allOk = 0;
+    for (const TypeName& typeName : REPORTED_TYPES) {
+        auto it = total.types.find(static_cast<uint16_t>(typeName.type));
+        if (it == total.types.end())
+            continue;
+        TypeStats& stats = it->second;
+        std::sort(stats.latencies.begin(), stats.latencies.end());
+        const uint64_t ok = stats.latencies.size();
+        allOk += ok;
+        printf("%-20s %10llu %10.0f %8llu %8llu %8llu %9.2f %9.2f %9.2f %9.2f %9.2f\n", typeName.name,
+            static_cast<unsigned long long>(ok), static_cast<double>(ok) / seconds,
+            static_cast<unsigned long long>(stats.errors), static_cast<unsigned long long>(stats.rateLimited),
+            static_cast<unsigned long long>(stats.overloaded), percentile(stats.latencies, 0.5),
+            percentile(stats.latencies, 0.9), percentile(stats.latencies, 0.99), percentile(stats.latencies, 0.999),
+            stats.latencies.empty() ? 0.0 : stats.latencies.back() / 1000.0);
+    }
+    printf("total:               %.0f ok/s over %.1f s\n", static_cast<double>(allOk) / seconds, seconds);
+    printf("connect failures:    %llu\n", static_cast<unsigned long long>(total.connectFailures));
+    printf("disconnects:         %llu\n", static_cast<unsigned long long>(total.disconnects));
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Config config;
+    if (!parseArguments(argc, argv, config))
+        return 1;
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(config.port));
+    if (inet_pton(AF_INET, config.host.c_str(), &address.sin_addr) != 1) {
+        fprintf(stderr, "bad host: %s\n", config.host.c_str());
+        return 1;
+    }
+
+    const Clock::time_point start = Clock::now();
+    const Clock::time_point measureFrom = start + std::chrono::seconds(config.warmup);
+    const Clock::time_point stopAt = measureFrom + std::chrono::seconds(config.duration);
+
+    std::vector<Worker*> workers;
+    std::vector<std::thread> threads;
+    int assigned = 0;
+    for (int i = 0; i < config.threads; ++i) {
+        const int count = (config.clients - assigned) / (config.threads - i);
+        workers.push_back(new Worker(config, address, assigned, count, static_cast<uint32_t>(i + 1)));
+        assigned += count;
+    }
+    for (Worker* worker : workers) {
+        threads.emplace_back([worker, measureFrom, stopAt]() { worker->run(measureFrom, stopAt); });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    printf("clients: %d, threads: %d, codec: %s, think: %d ms\n", config.clients, config.threads,
+        config.codec == BodyCodec::JSON ? "json" : "binary", config.thinkMs);
+    report(workers, static_cast<double>(config.duration));
+    for (Worker* worker : workers) {
+        delete worker;
+    }
+    return 0;
+}
@@ -0,0 +1,325 @@
+#ifndef BINARY_CODEC_H
+#define BINARY_CODEC_H
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <QByteArray>
+#include "protocol_fields.h"
+
+// 紧凑二进制消息体编码
+// 字段按声明顺序依次写出, 不写字段名:
+//   无符号整数 -> LEB128 变长整数; 有符号整数 -> zigzag 后再变长编码
+//   double/float -> 8/4 字节小端; 字符串/字节数组 -> 变长长度 + 原始字节; 数组 -> 变长个数 + 元素
+// 字段表见 protocol_fields.h
+
+class BinaryWriter
+{
+public:
+    explicit BinaryWriter(std::string& out) : out(out) {}
+
+    void writeVarUInt(uint64_t value)
+    {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    void writeVarInt(int64_t value)
+    {
+        writeVarUInt((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    void writeRaw(const void* data, size_t size)
+    {
+        out.append(static_cast<const char*>(data), size);
+    }
+
+    void writeFixed64(uint64_t value)
+    {
+        char bytes[8];
+        for (int i = 0; i < 8; ++i) {
+            bytes[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+        }
+        writeRaw(bytes, sizeof(bytes));
+    }
+
+    void writeFixed32(uint32_t value)
+    {
+        char bytes[4];
+        for (int i = 0; i < 4; ++i) {
+            bytes[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+        }
+        writeRaw(bytes, sizeof(bytes));
+    }
+
+    void writeBytes(const char* data, size_t size)
+    {
+        writeVarUInt(size);
+        writeRaw(data, size);
+    }
+
+private:
+    std::string& out;
+};
+
+// 读取越界或格式错误时 ok() 变为 false, 之后的读取全部失败
+class BinaryReader
+{
+public:
+    BinaryReader(const char* data, size_t size)
+        : cur(reinterpret_cast<const unsigned char*>(data))
+        , end(reinterpret_cast<const unsigned char*>(data) + size)
+        , good(true)
+    {
+    }
+
+    bool ok() const { return good; }
+    bool atEnd() const { return cur == end; }
+
+    bool readVarUInt(uint64_t& value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 64 && good; shift += 7) {
+            if (cur == end)
+                break;
+            const unsigned char byte = *cur++;
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+                return true;
+        }
+        return good = false;
+    }
+
+    bool readVarInt(int64_t& value)
+    {
+        uint64_t raw = 0;
+        if (!readVarUInt(raw))
+            return false;
+        value = static_cast<int64_t>((raw >> 1) ^ (~(raw & 1) + 1));
+        return true;
+    }
+
+    bool readFixed64(uint64_t& value)
+    {
+        if (!require(8))
+            return false;
+        value = 0;
+        for (int i = 0; i < 8; ++i) {
+            value |= static_cast<uint64_t>(cur[i]) << (8 * i);
+        }
+        cur += 8;
+        return true;
+    }
+
+    bool readFixed32(uint32_t& value)
+    {
+        if (!require(4))
+            return false;
+        value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value |= static_cast<uint32_t>(cur[i]) << (8 * i);
+        }
+        cur += 4;
+        return true;
+    }
+
+    // 返回指向输入缓冲区的指针, 不拷贝
+    bool readBytes(const char*& data, size_t& size)
+    {
+        uint64_t length = 0;
+        if (!readVarUInt(length) || !require(length))
+            return false;
+        data = reinterpret_cast<const char*>(cur);
+        size = static_cast<size_t>(length);
+        cur += length;
+        return true;
+    }
+
+    // 读取数组个数, 每个元素至少占 1 字节, 超过剩余长度的个数必然非法
+    bool readCount(size_t& count)
+    {
+        uint64_t value = 0;
+        if (!readVarUInt(value) || value > static_cast<uint64_t>(end - cur))
+            return good = false;
+        count = static_cast<size_t>(value);
+        return true;
+    }
+
+private:
+    bool require(uint64_t size)
+    {
+        if (!good || static_cast<uint64_t>(end - cur) < size)
+            return good = false;
+        return true;
+    }
+
+    const unsigned char* cur;
+    const unsigned char* end;
+    bool good;
+};
+
+// 基础类型
+
+template<typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+inline void encode(BinaryWriter& w, T value)
+{
+    if (std::is_signed<T>::value)
+        w.writeVarInt(static_cast<int64_t>(value));
+    else
+        w.writeVarUInt(static_cast<uint64_t>(value));
+}
+
+template<typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+inline bool decode(BinaryReader& r, T& value)
+{
+    // 超出 T 范围的值按格式错误处理, 不截断, 与 JSON 解码的 "整数越界" 一致
+    if (std::is_signed<T>::value) {
+        int64_t v = 0;
+        if (!r.readVarInt(v))
+            return false;
+        if (v < static_cast<int64_t>(std::numeric_limits<T>::min())
+            || v > static_cast<int64_t>(std::numeric_limits<T>::max()))
+            return false;
+        value = static_cast<T>(v);
+    }
+    else {
+        uint64_t v = 0;
+        if (!r.readVarUInt(v))
+            return false;
+        if (v > static_cast<uint64_t>(std::numeric_limits<T>::max()))
+            return false;
+        value = static_cast<T>(v);
+    }
+    return true;
+}
+
+template<typename T, typename std::enable_if<std::is_enum<T>::value, int>::type = 0>
+inline void encode(BinaryWriter& w, T value)
+{
+    encode(w, static_cast<typename std::underlying_type<T>::type>(value));
+}
+
+template<typename T, typename std::enable_if<std::is_enum<T>::value, int>::type = 0>
+inline bool decode(BinaryReader& r, T& value)
+{
+    typename std::underlying_type<T>::type raw{};
+    if (!decode(r, raw))
+        return false;
+    value = static_cast<T>(raw);
+    return true;
+}
+
+inline void encode(BinaryWriter& w, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    w.writeFixed64(bits);
+}
+
+inline bool decode(BinaryReader& r, double& value)
+{
+    uint64_t bits = 0;
+    if (!r.readFixed64(bits))
+        return false;
+    memcpy(&value, &bits, sizeof(value));
+    return true;
+}
+
+inline void encode(BinaryWriter& w, float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    w.writeFixed32(bits);
+}
+
+inline bool decode(BinaryReader& r, float& value)
+{
+    uint32_t bits = 0;
+    if (!r.readFixed32(bits))
+        return false;
+    memcpy(&value, &bits, sizeof(value));
+    return true;
+}
+
+inline void encode(BinaryWriter& w, const std::string& value)
+{
+    w.writeBytes(value.data(), value.size());
+}
+
+inline bool decode(BinaryReader& r, std::string& value)
+{
+    const char* data = nullptr;
+    size_t size = 0;
+    if (!r.readBytes(data, size))
+        return false;
+    value.assign(data, size);
+    return true;
+}
+
+inline void encode(BinaryWriter& w, const QByteArray& value)
+{
+    w.writeBytes(value.constData(), static_cast<size_t>(value.size()));
+}
+
+inline bool decode(BinaryReader& r, QByteArray& value)
+{
+    const char* data = nullptr;
+    size_t size = 0;
+    if (!r.readBytes(data, size))
+        return false;
+    value = QByteArray(data, static_cast<qsizetype>(size));
+    return true;
+}
+
+template<typename T>
+inline void encode(BinaryWriter& w, const std::vector<T>& values)
+{
+    w.writeVarUInt(values.size());
+    for (const auto& value : values) {
+        encode(w, value);
+    }
+}
+
+template<typename T>
+inline bool decode(BinaryReader& r, std::vector<T>& values)
+{
+    size_t count = 0;
+    if (!r.readCount(count))
+        return false;
+    // count 只受剩余字节数限制, 不按它预先分配; 元素逐个追加, 内存随实际解析出的元素增长
+    values.clear();
+    for (size_t i = 0; i < count; ++i) {
+        values.emplace_back();
+        if (!decode(r, values.back()))
+            return false;
+    }
+    return true;
+}
+
+// 结构体: 按 Fields<T> 的字段顺序依次编码
+
+template<typename T, typename std::enable_if<hasFields<T>, int>::type = 0>
+inline void encode(BinaryWriter& w, const T& value)
+{
+    Fields<T>::forEach([&](const char*, auto member) {
+        encode(w, value.*member);
+    });
+}
+
+template<typename T, typename std::enable_if<hasFields<T>, int>::type = 0>
+inline bool decode(BinaryReader& r, T& value)
+{
+    bool ok = true;
+    Fields<T>::forEach([&](const char*, auto member) {
+        ok = ok && decode(r, value.*member);
+    });
+    return ok;
+}
+
+#endif // BINARY_CODEC_H
@@ -0,0 +1,45 @@
+#ifndef BODY_CODEC_H
+#define BODY_CODEC_H
+
+#include <string>
+#include "binary_codec.h"
+#include "com_protocol.h"
+#include "json_codec.h"
+
+// 按连接协商的编码 (见 PROTOCOL_VERSION_BINARY) 编解码消息体
+
+// 编码结果追加到 out 末尾
+template<typename T>
+void encodeBody(BodyCodec codec, const T& value, std::string& out)
+{
+    if (codec == BodyCodec::BINARY) {
+        BinaryWriter writer(out);
+        encode(writer, value);
+        return;
+    }
+    encodeJson(out, value);
+}
+
+// 失败时 error 给出原因
+template<typename T>
+bool decodeBody(BodyCodec codec, const char* data, size_t size, T& value, std::string* error = nullptr)
+{
+    if (codec == BodyCodec::BINARY) {
+        // 与 JSON 一致, 消息体末尾多出的字节按格式错误处理
+        BinaryReader reader(data, size);
+        if (decode(reader, value) && reader.atEnd())
+            return true;
+        if (error)
+            *error = "二进制消息体格式错误";
+        return false;
+    }
+
+    JsonReader reader(data, size);
+    if (decodeJson(reader, value) && reader.finish())
+        return true;
+    if (error)
+        *error = std::string("JSON 格式错误: ") + reader.error() + " (偏移 " + std::to_string(reader.errorOffset()) + ")";
+    return false;
+}
+
+#endif // BODY_CODEC_H
@@ -0,0 +1,207 @@
+#include "com_protocol.h"
+#include <cstring>
+#include <QDateTime>
+#include "body_codec.h"
+
+namespace {
+
+void writeU16(char *out, uint16_t value)
+{
+    out[0] = static_cast<char>(value & 0xFF);
+    out[1] = static_cast<char>((value >> 8) & 0xFF);
+}
+
+void writeU32(char *out, uint32_t value)
+{
+    out[0] = static_cast<char>(value & 0xFF);
+    out[1] = static_cast<char>((value >> 8) & 0xFF);
+    out[2] = static_cast<char>((value >> 16) & 0xFF);
+    out[3] = static_cast<char>((value >> 24) & 0xFF);
+}
+
+uint16_t readU16(const char *data)
+{
+    const auto *p = reinterpret_cast<const unsigned char *>(data);
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t readU32(const char *data)
+{
+    const auto *p = reinterpret_cast<const unsigned char *>(data);
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8)
+        | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+} // namespace
+
+uint16_t ProtocolHelper::calculateChecksum(const QByteArray &data)
+{
+    // 16位反码求和 (与 IP/TCP 校验和算法相同)
+    const auto *p = reinterpret_cast<const unsigned char *>(data.constData());
+    const qsizetype size = data.size();
+    uint32_t sum = 0;
+
+    qsizetype i = 0;
+    for (; i + 1 < size; i += 2) {
+        sum += static_cast<uint32_t>(p[i] | (p[i + 1] << 8));
+    }
+    if (i < size) {
+        sum += p[i];
+    }
+
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return static_cast<uint16_t>(~sum);
+}
+
+ProtocolHeader ProtocolHelper::makeHeader(MessageType type, uint32_t body_length, uint32_t sequence_id,
+    uint16_t version, uint16_t deadline_ms)
+{
+    ProtocolHeader header;
+    header.magic = PROTOCOL_MAGIC;
+    header.version = version;
+    header.type = static_cast<uint16_t>(type);
+    header.deadline_ms = deadline_ms;
+    header.sequence_id = sequence_id;
+    header.body_length = body_length;
+    return header;
+}
+
+void ProtocolHelper::encodeHeader(const ProtocolHeader &header, char *out)
+{
+    writeU16(out, header.magic);
+    writeU16(out + 2, header.version);
+    writeU16(out + 4, header.type);
+    writeU16(out + 6, header.deadline_ms);
+    writeU32(out + 8, header.sequence_id);
+    writeU32(out + 12, header.body_length);
+}
+
+void ProtocolHelper::decodeHeader(const char *data, ProtocolHeader &header)
+{
+    header.magic = readU16(data);
+    header.version = readU16(data + 2);
+    header.type = readU16(data + 4);
+    header.deadline_ms = readU16(data + 6);
+    header.sequence_id = readU32(data + 8);
+    header.body_length = readU32(data + 12);
+}
+
+uint16_t ProtocolHelper::deadlineBudget(int timeoutMs)
+{
+    if (timeoutMs <= 0 || timeoutMs > UINT16_MAX)
+        return NO_DEADLINE;
+    return static_cast<uint16_t>(timeoutMs);
+}
+
+bool ProtocolHelper::isSupportedVersion(uint16_t version)
+{
+    return version == PROTOCOL_VERSION || version == PROTOCOL_VERSION_BINARY;
+}
+
+BodyCodec ProtocolHelper::codecForVersion(uint16_t version)
+{
+    return version == PROTOCOL_VERSION_BINARY ? BodyCodec::BINARY : BodyCodec::JSON;
+}
+
+uint16_t ProtocolHelper::versionForCodec(BodyCodec codec)
+{
+    return codec == BodyCodec::BINARY ? PROTOCOL_VERSION_BINARY : PROTOCOL_VERSION;
+}
+
+QByteArray ProtocolHelper::serializeMessage(MessageType type, const QByteArray &body, uint32_t sequence_id)
+{
+    return serializeMessage(type, body.constData(), static_cast<uint32_t>(body.size()), sequence_id);
+}
+
+QByteArray ProtocolHelper::serializeMessage(MessageType type, const char *body, uint32_t length, uint32_t sequence_id)
+{
+    // 一次分配, 协议头和消息体连续存放
+    QByteArray message(static_cast<qsizetype>(PROTOCOL_HEADER_SIZE + length), Qt::Uninitialized);
+    encodeHeader(makeHeader(type, length, sequence_id), message.data());
+    if (length > 0) {
+        memcpy(message.data() + PROTOCOL_HEADER_SIZE, body, length);
+    }
+    return message;
+}
+
+void ProtocolHelper::appendMessage(QByteArray &out, MessageType type, const char *body, uint32_t length,
+    uint32_t sequence_id, uint16_t version, uint16_t deadline_ms)
+{
+    const qsizetype offset = out.size();
+    out.resize(offset + static_cast<qsizetype>(PROTOCOL_HEADER_SIZE + length));
+    encodeHeader(makeHeader(type, length, sequence_id, version, deadline_ms), out.data() + offset);
+    if (length > 0) {
+        memcpy(out.data() + offset + PROTOCOL_HEADER_SIZE, body, length);
+    }
+}
+
+void ProtocolHelper::appendBatchItem(QByteArray &out, MessageType type, const char *body, uint32_t length)
+{
+    const qsizetype offset = out.size();
+    out.resize(offset + static_cast<qsizetype>(BATCH_ITEM_HEADER_SIZE + length));
+    char *item = out.data() + offset;
+    writeU16(item, static_cast<uint16_t>(type));
+    writeU32(item + 2, length);
+    if (length > 0) {
+        memcpy(item + BATCH_ITEM_HEADER_SIZE, body, length);
+    }
+}
+
+bool ProtocolHelper::readBatchItem(const char *&cursor, const char *end, MessageType &type, const char *&body,
+    uint32_t &length)
+{
+    if (end - cursor < static_cast<ptrdiff_t>(BATCH_ITEM_HEADER_SIZE))
+        return false;
+    const uint32_t itemLength = readU32(cursor + 2);
+    if (static_cast<size_t>(end - cursor) - BATCH_ITEM_HEADER_SIZE < itemLength)
+        return false;
+
+    type = static_cast<MessageType>(readU16(cursor));
+    body = cursor + BATCH_ITEM_HEADER_SIZE;
+    length = itemLength;
+    cursor = body + itemLength;
+    return true;
+}
+
+bool ProtocolHelper::parseHeader(const QByteArray &data, ProtocolHeader &header)
+{
+    if (data.size() < static_cast<qsizetype>(PROTOCOL_HEADER_SIZE))
+        return false;
+
+    decodeHeader(data.constData(), header);
+
+    if (header.magic != PROTOCOL_MAGIC)
+        return false;
+    if (!isSupportedVersion(header.version))
+        return false;
+    return true;
+}
+
+QByteArray ProtocolHelper::createErrorResponse(ErrorCode code, const std::string &message, uint32_t sequence_id,
+    BodyCodec codec)
+{
+    QByteArray out;
+    appendErrorResponse(out, code, message, sequence_id, codec);
+    return out;
+}
+
+void ProtocolHelper::appendErrorResponse(QByteArray &out, ErrorCode code, const std::string &message,
+    uint32_t sequence_id, BodyCodec codec, uint32_t retry_after_ms)
+{
+    ErrorResponse error{ code, message, sequence_id, retry_after_ms };
+    thread_local std::string body;
+    body.clear();
+    encodeBody(codec, error, body);
+    appendMessage(out, MessageType::ERROR_RESPONSE, body.data(), static_cast<uint32_t>(body.size()), sequence_id,
+        versionForCodec(codec));
+}
+
+QByteArray ProtocolHelper::createHeartbeat()
+{
+    Heartbeat heartbeat{ static_cast<uint64_t>(QDateTime::currentMSecsSinceEpoch()) };
+    std::string body;
+    encodeBody(BodyCodec::JSON, heartbeat, body);
+    return serializeMessage(MessageType::HEARTBEAT, body.data(), static_cast<uint32_t>(body.size()));
+}
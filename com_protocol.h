@@ -12,6 +12,15 @@
 // 协议版本号
 const uint16_t PROTOCOL_VERSION = 0x0001;
 
+// 二进制消息体协议版本号, 客户端以该版本发出的请求按二进制编码应答
+const uint16_t PROTOCOL_VERSION_BINARY = 0x0002;
+
+// 消息体编码
+enum class BodyCodec : uint8_t {
+    JSON = 0,
+    BINARY
+};
+
 // 消息类型枚举
 enum class MessageType : uint16_t {
     UNKNOWN = 0,
@@ -88,7 +97,22 @@ enum class MessageType : uint16_t {
 
     // 主题切换
     CHANGE_THEME_REQUEST,
-    CHANGE_THEME_RESPONSE
+    CHANGE_THEME_RESPONSE,
+
+    // 批量请求, 消息体是若干子消息, 见 ProtocolHelper::appendBatchItem
+    BATCH_REQUEST,
+    BATCH_RESPONSE,
+
+    // 商品库存和价格订阅, 变化时服务端主动推送 PRODUCT_UPDATE_PUSH (sequence_id 为 0)
+    SUBSCRIBE_REQUEST,
+    SUBSCRIBE_RESPONSE,
+    UNSUBSCRIBE_REQUEST,
+    UNSUBSCRIBE_RESPONSE,
+    PRODUCT_UPDATE_PUSH,
+
+    // 运行统计
+    STATS_REQUEST,
+    STATS_RESPONSE
 };
 
 // 错误码枚举
@@ -105,7 +129,9 @@ enum class ErrorCode : uint16_t {
     INSUFFICIENT_STOCK,
     INVALID_IMAGE_FORMAT,
     IMAGE_TOO_LARGE,
-    OPERATION_TIMEOUT
+    OPERATION_TIMEOUT,
+    RATE_LIMITED,
+    SERVER_OVERLOADED   // 服务端过载, 请求未执行; ErrorResponse::retry_after_ms 之后可以重试
 };
 
 // 图片类型枚举
@@ -122,7 +148,7 @@ struct ProtocolHeader {
     uint16_t magic;         // 魔数 0xDEAL
     uint16_t version;       // 协议版本
     uint16_t type;          // 消息类型
-    uint16_t reserved;      // 保留字段
+    uint16_t deadline_ms;   // 请求的截止时间预算 (毫秒), 0 表示不限; 响应为 0
     uint32_t sequence_id;   // 序列号用于匹配请求响应
     uint32_t body_length;   // 消息体长度
 };
@@ -131,9 +157,32 @@ struct ProtocolHeader {
 // 魔数定义
 const uint16_t PROTOCOL_MAGIC = 0xDEAL;
 
+// 协议头在线路上的长度 (小端字节序, 与结构体布局一致)
+const uint32_t PROTOCOL_HEADER_SIZE = sizeof(ProtocolHeader);
+
+// deadline_ms 从服务端收到请求时开始计时 (两端时钟不同步), 过期的请求不再访问数据库, 直接回复 OPERATION_TIMEOUT
+const uint16_t NO_DEADLINE = 0;
+
+// 批量消息体中每个子消息的头: 2 字节消息类型 + 4 字节消息体长度 (小端), 子消息共用批量消息的版本和截止时间
+const uint32_t BATCH_ITEM_HEADER_SIZE = 6;
+const int MAX_BATCH_ITEMS = 64;
+
+// 每个连接最多订阅的商品数
+const int MAX_SUBSCRIPTIONS = 256;
+
 // 最大数据块大小 (64KB - 协议头大小)
 const uint32_t MAX_CHUNK_SIZE = 65536 - sizeof(ProtocolHeader);
 
+// 默认的消息体长度上限 (4MB), 可在解码器上单独配置
+const uint32_t DEFAULT_MAX_BODY_LENGTH = 4 * 1024 * 1024;
+
+// 客户端空闲时发送心跳的间隔; 服务端默认超过 3 个间隔没有收到任何数据即断开连接
+const int HEARTBEAT_INTERVAL_MS = 30 * 1000;
+const int DEFAULT_IDLE_TIMEOUT_MS = 3 * HEARTBEAT_INTERVAL_MS;
+
+// 待支付订单的默认保留时间, 超时自动取消并归还库存
+const int DEFAULT_ORDER_PAYMENT_TIMEOUT_MS = 15 * 60 * 1000;
+
 // 响应基础结构
 struct BaseResponse {
     ErrorCode error_code;
@@ -441,11 +490,71 @@ struct ChangeThemeResponse : BaseResponse {
     std::string current_theme;
 };
 
+// 订阅商品库存和价格变化
+struct SubscribeRequest {
+    std::vector<int> product_ids;
+};
+
+// 订阅响应
+struct SubscribeResponse : BaseResponse {
+    int subscription_count; // 本连接当前订阅的商品数
+};
+
+// 取消订阅请求, product_ids 为空时取消全部
+struct UnsubscribeRequest {
+    std::vector<int> product_ids;
+};
+
+// 取消订阅响应
+struct UnsubscribeResponse : BaseResponse {
+    int subscription_count;
+};
+
+// 单个规格的最新库存和价格
+struct ClassUpdate {
+    int class_id;
+    int stock;
+    double price;
+};
+
+// 商品变化推送, 只包含有变化的规格; 商品被删除时所有规格按库存 0 推送, 订阅随之取消
+struct ProductUpdatePush {
+    int product_id;
+    std::vector<ClassUpdate> classes;
+};
+
+// 运行统计请求
+struct StatsRequest {
+    int min_count;      // 只返回样本数不少于该值的条目, 0 表示所有有样本的条目
+};
+
+// 一类请求或一种数据库操作的耗时分布, 时间单位毫秒
+struct LatencyStats {
+    int message_type;   // 请求的 MessageType, 数据库操作为 0
+    std::string name;   // 数据库操作名, 请求为空
+    uint64_t count;
+    uint64_t errors;    // 以 ERROR_RESPONSE 回复的次数 (限流, 过载, 超时, 格式错误); 数据库操作为 0
+    double mean_ms;
+    double p50_ms;
+    double p90_ms;
+    double p99_ms;
+    double p999_ms;
+    double max_ms;
+};
+
+// 运行统计响应, 各项从服务启动起累计
+struct StatsResponse : BaseResponse {
+    int64_t uptime_ms;
+    std::vector<LatencyStats> requests;
+    std::vector<LatencyStats> db_operations;
+};
+
 // 错误响应
 struct ErrorResponse {
     ErrorCode error_code;
     std::string error_message;
     uint32_t original_sequence_id;
+    uint32_t retry_after_ms;    // SERVER_OVERLOADED 时建议客户端等待的时间, 0 表示未给出
 };
 
 // 心跳包
@@ -462,11 +571,45 @@ public:
     // 序列化消息
     static QByteArray serializeMessage(MessageType type, const QByteArray &body, uint32_t sequence_id = 0);
 
+    // 序列化消息 (原始内存版本, 避免调用方先构造 QByteArray)
+    static QByteArray serializeMessage(MessageType type, const char *body, uint32_t length, uint32_t sequence_id = 0);
+
+    // 把完整消息 (头+体) 追加到 out 末尾, 发送缓冲区复用时避免中间拷贝
+    static void appendMessage(QByteArray &out, MessageType type, const char *body, uint32_t length,
+        uint32_t sequence_id = 0, uint16_t version = PROTOCOL_VERSION, uint16_t deadline_ms = NO_DEADLINE);
+
     // 反序列化消息头
     static bool parseHeader(const QByteArray &data, ProtocolHeader &header);
 
+    // 构造协议头
+    static ProtocolHeader makeHeader(MessageType type, uint32_t body_length, uint32_t sequence_id = 0,
+        uint16_t version = PROTOCOL_VERSION, uint16_t deadline_ms = NO_DEADLINE);
+
+    // 把客户端的超时换算成协议头里的截止时间预算, 超出 16 位能表示的范围时不设预算
+    static uint16_t deadlineBudget(int timeoutMs);
+
+    // 协议头编解码 (out/data 至少 PROTOCOL_HEADER_SIZE 字节)
+    static void encodeHeader(const ProtocolHeader &header, char *out);
+    static void decodeHeader(const char *data, ProtocolHeader &header);
+
+    // 是否是本端支持的协议版本
+    static bool isSupportedVersion(uint16_t version);
+
+    // 协议版本与消息体编码的对应关系
+    static BodyCodec codecForVersion(uint16_t version);
+    static uint16_t versionForCodec(BodyCodec codec);
+
+    // 批量消息体的子消息编解码; readBatchItem 从 cursor 处读出一个子消息并前移, 数据不完整时返回 false
+    static void appendBatchItem(QByteArray &out, MessageType type, const char *body, uint32_t length);
+    static bool readBatchItem(const char *&cursor, const char *end, MessageType &type, const char *&body,
+        uint32_t &length);
+
     // 创建错误响应
-    static QByteArray createErrorResponse(ErrorCode code, const std::string &message, uint32_t sequence_id);
+    static QByteArray createErrorResponse(ErrorCode code, const std::string &message, uint32_t sequence_id,
+        BodyCodec codec = BodyCodec::JSON);
+    // 直接追加到发送缓冲区, 不产生中间的 QByteArray
+    static void appendErrorResponse(QByteArray &out, ErrorCode code, const std::string &message, uint32_t sequence_id,
+        BodyCodec codec = BodyCodec::JSON, uint32_t retry_after_ms = 0);
 
     // 创建心跳包
     static QByteArray createHeartbeat();
@@ -1,3 +1,312 @@
 #include "communicator.h"
 
+namespace {
 
+const qint64 READ_CHUNK_SIZE = 64 * 1024;
+
+} // namespace
+
+Client::Client(QObject* parent)
+    : QObject(parent)
+    , socket(new QTcpSocket(this))
+    , nextSequence(1)
+    , defaultTimeout(10000)
+    , heartbeatInterval(HEARTBEAT_INTERVAL_MS)
+    , bodyCodec(BodyCodec::JSON)
+    , timeoutTimer(new QTimer(this))
+    , lastSendTime(0)
+    , heartbeatTimer(0)
+    , connecting(false)
+{
+    timeoutTimer->setSingleShot(true);
+
+    connect(socket, &QTcpSocket::connected, this, &Client::onConnected);
+    connect(socket, &QTcpSocket::readyRead, this, &Client::onReadyRead);
+    connect(socket, &QTcpSocket::disconnected, this, &Client::onDisconnected);
+    // disconnected 只在连接建立之后发出, 连接失败时从状态变化得知
+    connect(socket, &QTcpSocket::stateChanged, this, &Client::onStateChanged);
+    connect(timeoutTimer, &QTimer::timeout, this, &Client::onTimeout);
+}
+
+Client::~Client()
+{
+    // 析构时不再回调, 避免调用方持有的对象已经销毁
+    pending.clear();
+}
+
+void Client::connectToServer(const QString& host, quint16 port)
+{
+    decoder.reset();
+    connecting = true;
+    socket->connectToHost(host, port);
+}
+
+void Client::disconnectFromServer()
+{
+    socket->disconnectFromHost();
+}
+
+bool Client::isConnected() const
+{
+    return socket->state() == QAbstractSocket::ConnectedState;
+}
+
+quint32 Client::sendRequest(MessageType type, BodyCodec codec, const char* body, uint32_t length,
+    Completion completion, int timeoutMs)
+{
+    // 0 保留给服务端主动推送的消息
+    const quint32 sequence = nextSequence++;
+    if (nextSequence == 0)
+        nextSequence = 1;
+
+    if (timeoutMs < 0)
+        timeoutMs = defaultTimeout;
+
+    PendingRequest request;
+    request.completion = std::move(completion);
+    if (timeoutMs > 0) {
+        request.deadline = timers.schedule(timeoutMs, [this, sequence]() {
+            expireRequest(sequence);
+        });
+    }
+    pending.insert(sequence, std::move(request));
+
+    // 连接尚未建立时 QTcpSocket 会缓存写入, 连接成功后发出
+    ProtocolHelper::appendMessage(outBuffer, type, body, length, sequence, ProtocolHelper::versionForCodec(codec),
+        ProtocolHelper::deadlineBudget(timeoutMs));
+    socket->write(outBuffer);
+    outBuffer.resize(0);
+    lastSendTime = timers.now();
+
+    scheduleTimer();
+    return sequence;
+}
+
+quint32 Client::sendBatch(const Batch& batch, std::function<void(const BatchResult&)> callback, int timeoutMs)
+{
+    return sendRequest(MessageType::BATCH_REQUEST, batch.codec, batch.body.constData(),
+        static_cast<uint32_t>(batch.body.size()),
+        [callback](const FrameView* frame, ErrorCode code, const std::string& message) {
+            BatchResult result;
+            result.codec = frame ? ProtocolHelper::codecForVersion(frame->header.version) : BodyCodec::JSON;
+            if (!frame) {
+                result.error_code = code;
+                result.error_msg = message;
+            }
+            else if (frame->type() != MessageType::BATCH_RESPONSE) {
+                // 整批被拒绝时服务端回复 ERROR_RESPONSE
+                const BaseResponse error = decodeResponse<BaseResponse>(frame, code, message);
+                result.error_code = error.error_code == ErrorCode::SUCCESS ? ErrorCode::INVALID_REQUEST
+                                                                           : error.error_code;
+                result.error_msg = error.error_msg;
+            }
+            else {
+                result.body = QByteArray(frame->body, static_cast<qsizetype>(frame->body_length));
+                const char* begin = result.body.constData();
+                const char* cursor = begin;
+                const char* end = begin + result.body.size();
+                while (cursor < end) {
+                    BatchResult::Item item{};
+                    const char* itemBody = nullptr;
+                    if (!ProtocolHelper::readBatchItem(cursor, end, item.type, itemBody, item.length)) {
+                        result.items.clear();
+                        result.error_code = ErrorCode::INVALID_REQUEST;
+                        result.error_msg = "批量响应格式错误";
+                        break;
+                    }
+                    item.offset = itemBody - begin;
+                    result.items.push_back(item);
+                }
+            }
+            if (callback)
+                callback(result);
+        }, timeoutMs);
+}
+
+MessageType Client::BatchResult::type(int index) const
+{
+    if (index < 0 || index >= size())
+        return MessageType::UNKNOWN;
+    return items[static_cast<size_t>(index)].type;
+}
+
+void Client::onConnected()
+{
+    connecting = false;
+    // 连接建立前 (如还在解析主机名) 没有底层 socket, 设置会被忽略
+    socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    armHeartbeat(heartbeatInterval);
+    scheduleTimer();
+    emit connected();
+}
+
+void Client::onReadyRead()
+{
+    FrameView frame;
+    FrameDecoder::Status status = FrameDecoder::Status::NEED_MORE;
+
+    for (;;) {
+        const qint64 available = qMin(socket->bytesAvailable(), READ_CHUNK_SIZE);
+        if (available <= 0)
+            break;
+
+        const qint64 n = socket->read(decoder.prepareWrite(static_cast<size_t>(available)), available);
+        if (n <= 0)
+            break;
+        decoder.commitWrite(static_cast<size_t>(n));
+
+        while ((status = decoder.next(frame)) == FrameDecoder::Status::FRAME_READY) {
+            auto it = pending.find(frame.header.sequence_id);
+            if (it == pending.end()) {
+                // 心跳回显
+                if (frame.type() == MessageType::HEARTBEAT && frame.header.sequence_id == 0)
+                    continue;
+                if (frame.type() == MessageType::PRODUCT_UPDATE_PUSH) {
+                    ProductUpdatePush update{};
+                    if (decodeBody(ProtocolHelper::codecForVersion(frame.header.version), frame.body,
+                            frame.body_length, update))
+                        emit productUpdated(update);
+                    continue;
+                }
+                emit messageReceived(frame.type(), QByteArray(frame.body, static_cast<qsizetype>(frame.body_length)));
+                continue;
+            }
+
+            PendingRequest request = std::move(it.value());
+            pending.erase(it);
+            timers.cancel(request.deadline);
+
+            if (frame.type() == MessageType::ERROR_RESPONSE) {
+                ErrorResponse error{};
+                if (decodeBody(ProtocolHelper::codecForVersion(frame.header.version), frame.body,
+                        frame.body_length, error)
+                    && error.error_code == ErrorCode::SERVER_OVERLOADED)
+                    emit serverOverloaded(static_cast<int>(error.retry_after_ms));
+            }
+            request.completion(&frame, ErrorCode::SUCCESS, std::string());
+        }
+        if (status == FrameDecoder::Status::BAD_HEADER)
+            break;
+    }
+
+    if (status == FrameDecoder::Status::BAD_HEADER) {
+        qDebug() << "Invalid frame from server, error" << static_cast<int>(decoder.error());
+        // abort 会发出 disconnected, 由 onDisconnected 让未完成的请求失败
+        socket->abort();
+        return;
+    }
+
+    scheduleTimer();
+}
+
+void Client::onDisconnected()
+{
+    failAll(ErrorCode::NETWORK_ERROR, "连接已断开");
+    emit disconnected();
+}
+
+void Client::onStateChanged(QAbstractSocket::SocketState state)
+{
+    if (state != QAbstractSocket::UnconnectedState || !connecting)
+        return;
+    connecting = false;
+    failAll(ErrorCode::NETWORK_ERROR, "连接服务器失败");
+    emit connectFailed(socket->errorString());
+}
+
+void Client::onTimeout()
+{
+    timers.advance();
+    scheduleTimer();
+}
+
+void Client::expireRequest(quint32 sequence)
+{
+    auto it = pending.find(sequence);
+    if (it == pending.end())
+        return;
+
+    // 超时后到达的响应会被当作无主消息丢弃
+    PendingRequest request = std::move(it.value());
+    pending.erase(it);
+    request.completion(nullptr, ErrorCode::OPERATION_TIMEOUT, "请求超时");
+}
+
+void Client::failAll(ErrorCode code, const std::string& message)
+{
+    QHash<quint32, PendingRequest> failed;
+    failed.swap(pending);
+    timers.cancel(heartbeatTimer);
+    heartbeatTimer = 0;
+    for (auto it = failed.begin(); it != failed.end(); ++it) {
+        timers.cancel(it.value().deadline);
+    }
+    scheduleTimer();
+
+    for (auto it = failed.begin(); it != failed.end(); ++it) {
+        it.value().completion(nullptr, code, message);
+    }
+}
+
+void Client::armHeartbeat(qint64 delayMs)
+{
+    if (heartbeatInterval <= 0)
+        return;
+    heartbeatTimer = timers.schedule(delayMs, [this]() {
+        onHeartbeatTimer();
+    });
+}
+
+void Client::onHeartbeatTimer()
+{
+    // 期间发过请求就不必再发心跳, 顺延到下一个间隔
+    heartbeatTimer = 0;
+    const qint64 idle = timers.now() - lastSendTime;
+    if (idle < heartbeatInterval) {
+        armHeartbeat(heartbeatInterval - idle);
+        return;
+    }
+    if (isConnected()) {
+        socket->write(ProtocolHelper::createHeartbeat());
+        lastSendTime = timers.now();
+    }
+    armHeartbeat(heartbeatInterval);
+}
+
+void Client::scheduleTimer()
+{
+    const int wait = timers.nextTimeout();
+    if (wait < 0)
+        timeoutTimer->stop();
+    else
+        timeoutTimer->start(wait);
+}
+
+quint32 Client::sendLoginRequest(const LoginRequest& request, std::function<void(const LoginResponse&)> callback)
+{
+    return this->request<LoginResponse>(MessageType::LOGIN_REQUEST, request, std::move(callback));
+}
+
+quint32 Client::sendProductListRequest(const ProductListRequest& request,
+    std::function<void(const ProductListResponse&)> callback)
+{
+    return this->request<ProductListResponse>(MessageType::GET_PRODUCT_LIST_REQUEST, request, std::move(callback));
+}
+
+quint32 Client::sendProductDetailRequest(const ProductDetailRequest& request,
+    std::function<void(const ProductDetailResponse&)> callback)
+{
+    return this->request<ProductDetailResponse>(MessageType::GET_PRODUCT_DETAIL_REQUEST, request, std::move(callback));
+}
+
+quint32 Client::sendAddToCartRequest(const AddToCartRequest& request,
+    std::function<void(const AddToCartResponse&)> callback)
+{
+    return this->request<AddToCartResponse>(MessageType::ADD_TO_CART_REQUEST, request, std::move(callback));
+}
+
+quint32 Client::sendCreateOrderRequest(const CreateOrderRequest& request,
+    std::function<void(const CreateOrderResponse&)> callback)
+{
+    return this->request<CreateOrderResponse>(MessageType::CREATE_ORDER_REQUEST, request, std::move(callback));
+}
@@ -1,52 +1,240 @@
 #ifndef COMMUNICATOR_H
 #define COMMUNICATOR_H
 
+#include <functional>
+#include <QFuture>
+#include <QFutureInterface>
+#include <QHash>
 #include <QTcpSocket>
+#include <QTimer>
 #include "com_protocol.h"
-//
-//class Client : public QObject {
-//    Q_OBJECT
-//
-//public:
-//    explicit Client(QTcpSocket* socket, QObject* parent = nullptr);
-//
-//    void sendLoginRequest(const LoginRequest& request);
-//    void sendProductListRequest(const ProductListRequest& request);
-//    void sendProductDetailRequest(const ProductDetailRequest& request);
-//    void sendPurchaseRequest(const PurchaseRequest& request);
-//    void sendSeckillRequest(const SeckillRequest& request);
-//
-//signals:
-//    void loginResponseReceived(const LoginResponse& response);
-//    void productListResponseReceived(const ProductListResponse& response);
-//    void productDetailResponseReceived(const ProductDetailResponse& response);
-//    void purchaseResponseReceived(const PurchaseResponse& response);
-//    void seckillResponseReceived(const SeckillResponse& response);
-//
-//private slots:
-//    void onReadyRead();
-//    void onDisconnected();
-//
-//private:
-//    QTcpSocket* socket;
-//    void handleLoginResponse();
-//    void handleProductListResponse();
-//    void handleProductDetailResponse();
-//    void handlePurchaseResponse();
-//    void handleSeckillResponse();
-//    template<typename T>
-//    void sendMessage(const T& message);
-//};
+#include "body_codec.h"
+#include "frame_decoder.h"
+#include "timer_wheel.h"
 
+// 异步客户端
+// 同一个 socket 上可以同时有多个请求在途, 响应按 sequence_id 匹配回调用方, 允许乱序返回;
+// 每个请求有独立的超时, 超时后回调收到 ErrorCode::OPERATION_TIMEOUT; 连接空闲时自动发送心跳
+class Client : public QObject {
+    Q_OBJECT
 
+public:
+    explicit Client(QObject* parent = nullptr);
+    ~Client();
 
+    void connectToServer(const QString& host, quint16 port);
+    void disconnectFromServer();
+    bool isConnected() const;
 
+    // 默认超时 (毫秒), timeoutMs < 0 的请求使用该值, 0 表示不超时
+    void setDefaultTimeout(int timeoutMs) { defaultTimeout = timeoutMs; }
+    // 超过 intervalMs 没有发出任何请求时发送心跳, 0 表示不发送; 在 connectToServer 之前调用
+    void setHeartbeatInterval(int intervalMs) { heartbeatInterval = intervalMs; }
+    int pendingCount() const { return static_cast<int>(pending.size()); }
 
+    // 请求体编码, 默认 JSON; 服务端按请求的协议版本用同一编码回复
+    void setBodyCodec(BodyCodec codec) { bodyCodec = codec; }
+    BodyCodec getBodyCodec() const { return bodyCodec; }
 
+    // 批量请求: 子请求按添加顺序编号, 一次往返发出; 由 createBatch 创建, 使用创建时的请求体编码
+    class Batch {
+    public:
+        template<typename Request>
+        int add(MessageType type, const Request& request);
+        int size() const { return count; }
 
+    private:
+        friend class Client;
+        explicit Batch(BodyCodec codec) : codec(codec), count(0) {}
 
+        BodyCodec codec;
+        QByteArray body;
+        int count;
+    };
 
+    // 批量响应, 第 index 项对应第 index 个子请求
+    class BatchResult {
+    public:
+        // 整批失败 (超时, 断线, 服务端拒绝) 时不是 SUCCESS, 此时 get 返回同样的错误
+        ErrorCode error_code = ErrorCode::SUCCESS;
+        std::string error_msg;
 
+        int size() const { return static_cast<int>(items.size()); }
+        MessageType type(int index) const;
+        template<typename Response>
+        Response get(int index) const;
 
+    private:
+        friend class Client;
+        struct Item {
+            MessageType type;
+            qsizetype offset;
+            uint32_t length;
+        };
+
+        BodyCodec codec = BodyCodec::JSON;
+        QByteArray body;
+        std::vector<Item> items;
+    };
+
+    Batch createBatch() const { return Batch(bodyCodec); }
+    quint32 sendBatch(const Batch& batch, std::function<void(const BatchResult&)> callback, int timeoutMs = -1);
+
+    // 回调方式, 回调在 Client 所在线程调用; 返回本次请求的 sequence_id
+    template<typename Response, typename Request>
+    quint32 request(MessageType type, const Request& request,
+        std::function<void(const Response&)> callback, int timeoutMs = -1);
+
+    // future 方式
+    template<typename Response, typename Request>
+    QFuture<Response> requestAsync(MessageType type, const Request& request, int timeoutMs = -1);
+
+    quint32 sendLoginRequest(const LoginRequest& request, std::function<void(const LoginResponse&)> callback);
+    quint32 sendProductListRequest(const ProductListRequest& request,
+        std::function<void(const ProductListResponse&)> callback);
+    quint32 sendProductDetailRequest(const ProductDetailRequest& request,
+        std::function<void(const ProductDetailResponse&)> callback);
+    quint32 sendAddToCartRequest(const AddToCartRequest& request,
+        std::function<void(const AddToCartResponse&)> callback);
+    quint32 sendCreateOrderRequest(const CreateOrderRequest& request,
+        std::function<void(const CreateOrderResponse&)> callback);
+
+signals:
+    void connected();
+    void disconnected();
+    // 连接没有建立起来 (拒绝连接、主机名解析失败等), 之前排队的请求已收到 NETWORK_ERROR
+    void connectFailed(const QString& reason);
+    // 不属于任何在途请求的消息 (服务端心跳等)
+    void messageReceived(MessageType type, const QByteArray& body);
+    // 订阅的商品库存或价格变化 (SUBSCRIBE_REQUEST 之后由服务端推送)
+    void productUpdated(const ProductUpdatePush& update);
+    // 服务端过载拒绝了请求, 建议 retryAfterMs 毫秒内不再发送低优先级请求 (对应请求的回调照常收到 SERVER_OVERLOADED)
+    void serverOverloaded(int retryAfterMs);
+
+private slots:
+    void onConnected();
+    void onReadyRead();
+    void onDisconnected();
+    void onStateChanged(QAbstractSocket::SocketState state);
+    void onTimeout();
+
+private:
+    // frame 为空表示请求失败, 此时 code/message 给出原因
+    using Completion = std::function<void(const FrameView* frame, ErrorCode code, const std::string& message)>;
+
+    struct PendingRequest {
+        Completion completion;
+        TimerWheel::TimerId deadline = 0;
+    };
+
+    quint32 sendRequest(MessageType type, BodyCodec codec, const char* body, uint32_t length, Completion completion,
+        int timeoutMs);
+    void expireRequest(quint32 sequence);
+    void failAll(ErrorCode code, const std::string& message);
+    void armHeartbeat(qint64 delayMs);
+    void onHeartbeatTimer();
+    void scheduleTimer();
+
+    // 把响应帧解析为 Response, 服务端返回 ERROR_RESPONSE 时转换为 Response 的错误码
+    template<typename Response>
+    static Response decodeResponse(const FrameView* frame, ErrorCode code, const std::string& message);
+
+    QTcpSocket* socket;
+    FrameDecoder decoder;
+    QByteArray outBuffer;
+    quint32 nextSequence;
+    int defaultTimeout;
+    int heartbeatInterval;
+    BodyCodec bodyCodec;
+    QHash<quint32, PendingRequest> pending;
+    TimerWheel timers;      // 请求超时和心跳, 由 timeoutTimer 驱动
+    QTimer* timeoutTimer;
+    qint64 lastSendTime;
+    TimerWheel::TimerId heartbeatTimer;
+    bool connecting;        // connectToServer 之后、连接建立之前
+};
+
+template<typename Response>
+Response Client::decodeResponse(const FrameView* frame, ErrorCode code, const std::string& message)
+{
+    Response response{};
+    if (!frame) {
+        response.error_code = code;
+        response.error_msg = message;
+        return response;
+    }
+
+    const BodyCodec codec = ProtocolHelper::codecForVersion(frame->header.version);
+    std::string error;
+    if (frame->type() == MessageType::ERROR_RESPONSE) {
+        ErrorResponse errorResponse{};
+        if (decodeBody(codec, frame->body, frame->body_length, errorResponse, &error)) {
+            response.error_code = errorResponse.error_code;
+            response.error_msg = errorResponse.error_message;
+            return response;
+        }
+    }
+    else if (decodeBody(codec, frame->body, frame->body_length, response, &error)) {
+        return response;
+    }
+
+    response = Response{};
+    response.error_code = ErrorCode::INVALID_REQUEST;
+    response.error_msg = error;
+    return response;
+}
+
+template<typename Response, typename Request>
+quint32 Client::request(MessageType type, const Request& request,
+    std::function<void(const Response&)> callback, int timeoutMs)
+{
+    std::string body;
+    encodeBody(bodyCodec, request, body);
+    return sendRequest(type, bodyCodec, body.data(), static_cast<uint32_t>(body.size()),
+        [callback](const FrameView* frame, ErrorCode code, const std::string& message) {
+            const Response response = decodeResponse<Response>(frame, code, message);
+            if (callback)
+                callback(response);
+        }, timeoutMs);
+}
+
+template<typename Request>
+int Client::Batch::add(MessageType type, const Request& request)
+{
+    std::string encoded;
+    encodeBody(codec, request, encoded);
+    ProtocolHelper::appendBatchItem(body, type, encoded.data(), static_cast<uint32_t>(encoded.size()));
+    return count++;
+}
+
+template<typename Response>
+Response Client::BatchResult::get(int index) const
+{
+    if (error_code != ErrorCode::SUCCESS)
+        return decodeResponse<Response>(nullptr, error_code, error_msg);
+    if (index < 0 || index >= size())
+        return decodeResponse<Response>(nullptr, ErrorCode::INVALID_REQUEST, "批量响应中没有该项");
+
+    const Item& item = items[static_cast<size_t>(index)];
+    FrameView frame;
+    frame.header = ProtocolHelper::makeHeader(item.type, item.length, static_cast<uint32_t>(index),
+        ProtocolHelper::versionForCodec(codec));
+    frame.body = body.constData() + item.offset;
+    frame.body_length = item.length;
+    return decodeResponse<Response>(&frame, ErrorCode::SUCCESS, std::string());
+}
+
+template<typename Response, typename Request>
+QFuture<Response> Client::requestAsync(MessageType type, const Request& request, int timeoutMs)
+{
+    // QFutureInterface 在 Qt 5 和 Qt 6 中都有, 副本共享同一个结果
+    QFutureInterface<Response> promise;
+    promise.reportStarted();
+    this->request<Response>(type, request, [promise](const Response& response) mutable {
+        promise.reportResult(response);
+        promise.reportFinished();
+    }, timeoutMs);
+    return promise.future();
+}
 
 #endif // COMMUNICATOR_H
@@ -1,14 +1,464 @@
 #include "database_manager.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+namespace {
+
+const char* const DB_OPERATION_NAMES[] = {
+    "createUser",
+    "getUserByID",
+    "getUserByUsername",
+    "updateUser",
+    "updateUserRating",
+    "deleteUser",
+    "createProduct",
+    "getProductByID",
+    "getProductsByIDs",
+    "updateProduct",
+    "deleteProduct",
+    "getProductList",
+    "getProductsBySeller",
+    "decreaseStock",
+    "createOrder",
+    "getOrderById",
+    "getOrdersByUserID",
+    "updateOrderStatus",
+    "deleteOrder",
+    "getCartByUserID",
+    "updateCart",
+    "clearCart",
+    "addItemToCart",
+    "updateCartItemQuantity",
+    "removeItemFromCart",
+    "commitTransaction",
+    "checkpoint",
+};
+static_assert(sizeof(DB_OPERATION_NAMES) / sizeof(DB_OPERATION_NAMES[0]) == DB_OPERATION_COUNT,
+    "DB_OPERATION_NAMES must match DbOperation");
+
+// 作用域结束时把耗时记入直方图
+class OperationTimer
+{
+public:
+    explicit OperationTimer(LatencyHistogram& histogram)
+        : histogram(histogram)
+        , start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~OperationTimer()
+    {
+        histogram.record(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+
+private:
+    LatencyHistogram& histogram;
+    std::chrono::steady_clock::time_point start;
+};
+
+quint64 nextPoolID()
+{
+    static std::atomic<quint64> counter{ 0 };
+    return ++counter;
+}
+
+// 按编号批量读商品时每条语句绑定的编号个数, 不足的位置绑定 NULL, 超出的分批查询
+const int PRODUCT_ID_CHUNK = 50;
+
+// "(:id0, :id1, ...)", 不依赖 json_each, 旧版本 SQLite 也能编译
+std::string productIDPlaceholders()
+{
+    std::string placeholders = "(";
+    for (int i = 0; i < PRODUCT_ID_CHUNK; ++i) {
+        if (i > 0)
+            placeholders += ", ";
+        placeholders += ":id" + std::to_string(i);
+    }
+    return placeholders + ")";
+}
+
+// 绑定 ids[start, start + PRODUCT_ID_CHUNK)
+void bindProductIDs(QSqlQuery& query, const std::vector<int>& ids, size_t start)
+{
+    static const std::vector<QString> names = []() {
+        std::vector<QString> result;
+        for (int i = 0; i < PRODUCT_ID_CHUNK; ++i) {
+            result.push_back(QString(":id%1").arg(i));
+        }
+        return result;
+    }();
+    for (int i = 0; i < PRODUCT_ID_CHUNK; ++i) {
+        const size_t index = start + static_cast<size_t>(i);
+        query.bindValue(names[i], index < ids.size() ? QVariant(ids[index]) : QVariant());
+    }
+}
+
+// 打开中的连接池: poolID -> DatabaseManager, 线程退出时据此归还连接
+QMutex poolRegistryMutex;
+std::unordered_map<quint64, DatabaseManager*> poolRegistry;
+
+// 缓存的语句用完后 finish, 释放结果集和它持有的读锁; 绑定的值留到下次覆盖
+class StatementGuard
+{
+public:
+    explicit StatementGuard(QSqlQuery& query)
+        : query(query)
+    {
+    }
+
+    ~StatementGuard() { query.finish(); }
+
+private:
+    QSqlQuery& query;
+};
+
+// 多条语句组成的写操作放进一个事务, 已在事务中时是一个保存点; 没有 commit 就离开作用域时回滚
+class TransactionScope
+{
+public:
+    explicit TransactionScope(DatabaseManager& db)
+        : db(db)
+        , active(db.beginTransaction())
+    {
+    }
+
+    ~TransactionScope()
+    {
+        if (active)
+            db.rollbackTransaction();
+    }
+
+    bool isActive() const { return active; }
+
+    bool commit()
+    {
+        active = false;
+        return db.commitTransaction();
+    }
+
+private:
+    DatabaseManager& db;
+    bool active;
+};
+
+} // namespace
+
+const char* DatabaseManager::operationName(DbOperation operation)
+{
+    return DB_OPERATION_NAMES[static_cast<int>(operation)];
+}
+
+const char* DatabaseManager::statementSql(Statement id)
+{
+    switch (id) {
+    case Statement::INSERT_USER:
+        return "INSERT INTO users (userID, username, password, nickname, avatarURL, "
+            "phone, default_address, rating, numsofRate, balance, registerTime, userLevel) "
+            "VALUES (:userID, :username, :password, :nickname, :avatarURL, "
+            ":phone, :default_address, :rating, :numsofRate, :balance, :registerTime, :userLevel)";
+    case Statement::SELECT_USER:
+        return "SELECT * FROM users WHERE userID = :userID";
+    case Statement::SELECT_USER_ID_BY_USERNAME:
+        return "SELECT userID FROM users WHERE username = :username";
+    case Statement::UPDATE_USER:
+        return "UPDATE users SET username = :username, password = :password, "
+            "nickname = :nickname, avatarURL = :avatarURL, phone = :phone, "
+            "default_address = :default_address, rating = :rating, numsofRate = :numsofRate, balance = :balance, "
+            "registerTime = :registerTime, userLevel = :userLevel "
+            "WHERE userID = :userID";
+    case Statement::UPDATE_USER_RATING:
+        return "UPDATE users SET rating = :rating WHERE userID = :userID";
+    case Statement::DELETE_CART_ITEMS:
+        return "DELETE FROM cart_items WHERE userID = :userID";
+    case Statement::DELETE_USER:
+        return "DELETE FROM users WHERE userID = :userID";
+    case Statement::INSERT_PRODUCT:
+        return "INSERT INTO products (productID, description, brief_description, "
+            "specification, brand, productName, category, sellerID, salesCount) "
+            "VALUES (:productID, :description, :brief_description, "
+            ":specification, :brand, :productName, :category, :sellerID, :salesCount)";
+    case Statement::INSERT_PRODUCT_IMAGE:
+        return "INSERT INTO product_images (productID, imageURL) "
+            "VALUES (:productID, :imageURL)";
+    case Statement::INSERT_PRODUCT_CLASS:
+        return "INSERT INTO product_classes (classID, productID, stock, "
+            "small_imageURL, name, price) "
+            "VALUES (:classID, :productID, :stock, "
+            ":small_imageURL, :name, :price)";
+    case Statement::UPSERT_PRODUCT_CLASS:
+        return "INSERT INTO product_classes (classID, productID, stock, small_imageURL, name, price) "
+            "VALUES (:classID, :productID, :stock, :small_imageURL, :name, :price) "
+            "ON CONFLICT(classID) DO UPDATE SET stock = excluded.stock, small_imageURL = excluded.small_imageURL, "
+            "name = excluded.name, price = excluded.price "
+            "WHERE product_classes.productID = excluded.productID";
+    // 固定 PRODUCT_ID_CHUNK 个编号参数, 见 bindProductIDs
+    case Statement::SELECT_PRODUCTS_BY_IDS: {
+        static const std::string sql = "SELECT * FROM products WHERE productID IN " + productIDPlaceholders();
+        return sql.c_str();
+    }
+    case Statement::SELECT_IMAGES_BY_PRODUCT_IDS: {
+        static const std::string sql = "SELECT productID, imageURL FROM product_images WHERE productID IN "
+            + productIDPlaceholders() + " ORDER BY productID, imageID";
+        return sql.c_str();
+    }
+    case Statement::SELECT_CLASSES_BY_PRODUCT_IDS: {
+        static const std::string sql = "SELECT * FROM product_classes WHERE productID IN "
+            + productIDPlaceholders() + " ORDER BY productID, classID";
+        return sql.c_str();
+    }
+    case Statement::SELECT_PRODUCT_CLASSES:
+        return "SELECT * FROM product_classes WHERE productID = :productID";
+    case Statement::UPDATE_PRODUCT:
+        return "UPDATE products SET description = :description, "
+            "brief_description = :brief_description, specification = :specification, "
+            "brand = :brand, productName = :productName, category = :category, "
+            "sellerID = :sellerID, salesCount = :salesCount "
+            "WHERE productID = :productID";
+    case Statement::DELETE_PRODUCT_IMAGES:
+        return "DELETE FROM product_images WHERE productID = :productID";
+    case Statement::DELETE_PRODUCT_CLASSES:
+        return "DELETE FROM product_classes WHERE productID = :productID";
+    case Statement::DELETE_PRODUCT_CLASS:
+        return "DELETE FROM product_classes WHERE classID = :classID";
+    case Statement::DELETE_PRODUCT:
+        return "DELETE FROM products WHERE productID = :productID";
+    case Statement::COUNT_PRODUCTS:
+        return "SELECT COUNT(*) FROM products "
+            "WHERE (:category IS NULL OR category = :category2) "
+            "AND (:keyword IS NULL OR productName LIKE :keyword2 OR brief_description LIKE :keyword3)";
+    case Statement::SELECT_PRODUCT_PAGE:
+        return "SELECT productID FROM products "
+            "WHERE (:category IS NULL OR category = :category2) "
+            "AND (:keyword IS NULL OR productName LIKE :keyword2 OR brief_description LIKE :keyword3) "
+            "ORDER BY salesCount DESC, productID LIMIT :limit OFFSET :offset";
+    case Statement::COUNT_SELLER_PRODUCTS:
+        return "SELECT COUNT(*) FROM products WHERE sellerID = :sellerID";
+    case Statement::SELECT_SELLER_PRODUCT_PAGE:
+        return "SELECT productID FROM products WHERE sellerID = :sellerID "
+            "ORDER BY productID DESC LIMIT :limit OFFSET :offset";
+    case Statement::DECREASE_STOCK:
+        return "UPDATE product_classes SET stock = stock - :quantity "
+            "WHERE classID = :classID AND productID = :productID AND stock >= :minStock";
+    case Statement::INSERT_ORDER:
+        return "INSERT INTO orders (orderID, userID, sellerID, totalAmount, status, address, createdTime) "
+            "VALUES (:orderID, :userID, :sellerID, :totalAmount, :status, :address, :createdTime)";
+    case Statement::INSERT_ORDER_ITEM:
+        return "INSERT INTO order_items (orderID, productID, classID, quantity, price) "
+            "VALUES (:orderID, :productID, :classID, :quantity, :price)";
+    case Statement::SELECT_ORDER:
+        return "SELECT * FROM orders WHERE orderID = :orderID";
+    case Statement::SELECT_ORDER_ITEMS:
+        return "SELECT * FROM order_items WHERE orderID = :orderID";
+    case Statement::UPDATE_ORDER_STATUS:
+        return "UPDATE orders SET status = :status WHERE orderID = :orderID";
+    case Statement::DELETE_ORDER_ITEMS:
+        return "DELETE FROM order_items WHERE orderID = :orderID";
+    case Statement::DELETE_ORDER:
+        return "DELETE FROM orders WHERE orderID = :orderID";
+    case Statement::COUNT_USER_ORDERS:
+        return "SELECT COUNT(*) FROM orders WHERE userID = :userID AND (:status <= 0 OR status = :status2)";
+    case Statement::SELECT_USER_ORDER_PAGE:
+        return "SELECT orderID FROM orders WHERE userID = :userID AND (:status <= 0 OR status = :status2) "
+            "ORDER BY orderID DESC LIMIT :limit OFFSET :offset";
+    case Statement::SELECT_CART:
+        return "SELECT ci.productID, ci.classID, ci.quantity, pc.price, p.productName, pc.name as className "
+            "FROM cart_items ci "
+            "JOIN product_classes pc ON ci.classID = pc.classID "
+            "JOIN products p ON ci.productID = p.productID "
+            "WHERE ci.userID = :userID";
+    case Statement::INSERT_CART_ITEM:
+        return "INSERT INTO cart_items (userID, productID, classID, quantity) "
+            "VALUES (:userID, :productID, :classID, :quantity)";
+    case Statement::SELECT_CART_ITEM_QUANTITY:
+        return "SELECT quantity FROM cart_items WHERE userID = :userID AND productID = :productID AND classID = :classID";
+    case Statement::UPDATE_CART_ITEM_QUANTITY:
+        return "UPDATE cart_items SET quantity = :quantity WHERE userID = :userID AND productID = :productID AND classID = :classID";
+    case Statement::DELETE_CART_ITEM:
+        return "DELETE FROM cart_items WHERE userID = :userID AND productID = :productID AND classID = :classID";
+    }
+    return "";
+}
 
 DatabaseManager::DatabaseManager()
     : isOpen(false)
+    , nextConnection(0)
+    , poolID(nextPoolID())
 {
-    db = QSqlDatabase::addDatabase("QSQLITE");
+    registerPool();
 }
 
 DatabaseManager::~DatabaseManager()
 {
     disconnectFromDatabase();
+    unregisterPool();
+}
+
+void DatabaseManager::registerPool()
+{
+    QMutexLocker locker(&poolRegistryMutex);
+    poolRegistry[poolID] = this;
+}
+
+void DatabaseManager::unregisterPool()
+{
+    // 正在归还连接的线程持有 poolRegistryMutex, 注销之后不会再有线程通过它访问本对象
+    QMutexLocker locker(&poolRegistryMutex);
+    poolRegistry.erase(poolID);
+}
+
+DatabaseManager::ThreadConnections::~ThreadConnections()
+{
+    QMutexLocker locker(&poolRegistryMutex);
+    for (quint64 pool : pools) {
+        // 已关闭的池不在登记表里, 连接已随池关闭
+        const auto it = poolRegistry.find(pool);
+        if (it != poolRegistry.end())
+            it->second->releaseConnection(std::this_thread::get_id());
+    }
+}
+
+void DatabaseManager::releaseConnection(std::thread::id thread)
+{
+    std::unique_ptr<Connection> conn;
+    {
+        QMutexLocker locker(&poolMutex);
+        const auto it = connections.find(thread);
+        if (it == connections.end())
+            return;
+        conn = std::move(it->second);
+        connections.erase(it);
+    }
+    // 未提交的事务随连接关闭回滚
+    closeConnection(*conn);
+}
+
+DatabaseManager::Connection& DatabaseManager::connection() const
+{
+    // 线程最近用过的连接, 同一个池的后续访问不加锁
+    thread_local quint64 cachedPool = 0;
+    thread_local Connection* cached = nullptr;
+    thread_local ThreadConnections owned;
+    if (cachedPool == poolID)
+        return *cached;
+
+    QMutexLocker locker(&poolMutex);
+    std::unique_ptr<Connection>& conn = connections[std::this_thread::get_id()];
+    if (!conn) {
+        conn = std::make_unique<Connection>();
+        openConnection(*conn, QString("irondeal_%1_%2").arg(poolID).arg(nextConnection++));
+        owned.pools.push_back(poolID);
+    }
+    cachedPool = poolID;
+    cached = conn.get();
+    return *conn;
+}
+
+QSqlQuery& DatabaseManager::statement(Statement id) const
+{
+    Connection& conn = connection();
+    std::unique_ptr<QSqlQuery>& query = conn.statements[static_cast<int>(id)];
+    if (query)
+        return *query;
+
+    query = std::make_unique<QSqlQuery>(conn.db);
+    query->setForwardOnly(true);
+    if (!query->prepare(statementSql(id))) {
+        qDebug() << "Prepare statement failed:" << query->lastError().text();
+        qDebug() << "SQL:" << statementSql(id);
+        // 编译失败的语句不缓存, 这次执行会报错, 下次重新编译
+        std::unique_ptr<QSqlQuery>& failed = conn.unprepared[static_cast<int>(id)];
+        failed = std::move(query);
+        return *failed;
+    }
+    return *query;
+}
+
+bool DatabaseManager::openConnection(Connection& conn, const QString& name) const
+{
+    conn.db = QSqlDatabase::addDatabase("QSQLITE", name);
+    conn.db.setHostName(hostName);
+    conn.db.setDatabaseName(databasePath);
+    conn.db.setUserName(userName);
+    conn.db.setPassword(password);
+    if (!conn.db.open()) {
+        qDebug() << "Error: Cannot open database connection" << name << ":" << conn.db.lastError().text();
+        return false;
+    }
+    return configureConnection(conn.db);
+}
+
+bool DatabaseManager::configureConnection(const QSqlDatabase& conn) const
+{
+    // cache_size 取负值时单位为 KiB
+    const QStringList pragmas = {
+        "PRAGMA foreign_keys = ON;",
+        QString("PRAGMA busy_timeout = %1;").arg(storage.busyTimeoutMs),
+        QString("PRAGMA synchronous = %1;").arg(storage.synchronous),
+        QString("PRAGMA cache_size = -%1;").arg(storage.cacheSizeKiB),
+        QString("PRAGMA mmap_size = %1;").arg(storage.mmapSize),
+        QString("PRAGMA temp_store = %1;").arg(storage.tempStore),
+        QString("PRAGMA wal_autocheckpoint = %1;").arg(storage.autoCheckpointPages),
+    };
+    QSqlQuery query(conn);
+    for (const QString& pragma : pragmas) {
+        if (!query.exec(pragma)) {
+            qDebug() << "Failed to configure connection:" << query.lastError().text();
+            qDebug() << "SQL:" << pragma;
+            return false;
+        }
+    }
+    return true;
+}
+
+void DatabaseManager::closeConnections()
+{
+    // 先注销, 此后退出的线程不再来归还旧池的连接; 不能在持有 poolMutex 时注销, 归还的顺序是先登记表后 poolMutex
+    // 连接只能在打开它的线程上关闭: 这里只关闭当前线程的, 其他线程的由它们退出时归还,
+    // 因此调用前必须先停止其他访问数据库的线程
+    unregisterPool();
+    {
+        QMutexLocker locker(&poolMutex);
+        const auto own = connections.find(std::this_thread::get_id());
+        if (own != connections.end()) {
+            closeConnection(*own->second);
+            connections.erase(own);
+        }
+        Q_ASSERT_X(connections.empty(), "DatabaseManager::closeConnections",
+            "other threads still hold database connections");
+        if (!connections.empty()) {
+            // 不能跨线程关闭, 宁可泄漏; 这些线程之后不会再用旧池的连接
+            qDebug() << connections.size() << "database connections still owned by running threads";
+            for (auto& entry : connections) {
+                entry.second.release();
+            }
+            connections.clear();
+        }
+        poolID = nextPoolID();
+    }
+    registerPool();
+}
+
+void DatabaseManager::closeConnection(Connection& conn)
+{
+    const QString name = conn.db.connectionName();
+    for (std::unique_ptr<QSqlQuery>& query : conn.statements) {
+        query.reset();
+    }
+    for (std::unique_ptr<QSqlQuery>& query : conn.unprepared) {
+        query.reset();
+    }
+    conn.db.close();
+    // removeDatabase 要求不再有 QSqlDatabase 引用该连接
+    conn.db = QSqlDatabase();
+    QSqlDatabase::removeDatabase(name);
+}
+
+int DatabaseManager::connectionCount() const
+{
+    QMutexLocker locker(&poolMutex);
+    return static_cast<int>(connections.size());
 }
 
 bool DatabaseManager::connectToDatabase(const QString& host,
@@ -16,14 +466,16 @@ bool DatabaseManager::connectToDatabase(const QString& host,
     const QString& user,
     const QString& password)
 {
-    db.setHostName(host);
-    db.setDatabaseName(dbname);
-    db.setUserName(user);
-    db.setPassword(password);
-
-    if (!db.open()) {
-        qDebug() << "Error: connection with database failed: " << db.lastError().text();
-        isOpen = false;
+    disconnectFromDatabase();
+    hostName = host;
+    databasePath = dbname;
+    userName = user;
+    this->password = password;
+
+    // 先在调用线程打开一个连接, 确认参数可用
+    if (!database().isOpen()) {
+        qDebug() << "Error: connection with database failed";
+        closeConnections();
         return false;
     }
 
@@ -34,13 +486,20 @@ bool DatabaseManager::connectToDatabase(const QString& host,
 
 void DatabaseManager::disconnectFromDatabase()
 {
-    if (db.isOpen()) {
-        db.close();
+    if (isOpen) {
+        closeConnections();
         isOpen = false;
         qDebug() << "Database connection closed";
     }
 }
 
+void DatabaseManager::notifyProductChanged(int productID)
+{
+    for (const ProductListener& listener : productListeners) {
+        listener(productID);
+    }
+}
+
 bool DatabaseManager::executeQuery(const QString& query)
 {
     if (!isOpen) {
@@ -48,7 +507,7 @@ bool DatabaseManager::executeQuery(const QString& query)
         return false;
     }
 
-    QSqlQuery sqlQuery(db);
+    QSqlQuery sqlQuery(database());
     if (!sqlQuery.exec(query)) {
         qDebug() << "Query failed: " << sqlQuery.lastError().text();
         qDebug() << "Query: " << query;
@@ -57,18 +516,17 @@ bool DatabaseManager::executeQuery(const QString& query)
     return true;
 }
 
-bool DatabaseManager::createUser(const User& user)
+bool DatabaseManager::createUser(const User& user, int* newUserID)
 {
+    const OperationTimer timer(operationLatency[static_cast<int>(DbOperation::CREATE_USER)]);
     if (!isOpen)
         return false;
 
-    QSqlQuery query(db);
-    query.prepare("INSERT INTO users (userID, username, password, nickname, avatarURL, "
-        "phone, default_address, rating, numsofRate, balance, registerTime, userLevel) "
-        "VALUES (:userID, :username, :password, :nickname, :avatarURL, "
-        ":phone, :default_address, :rating, :numsofRate, :balance, :registerTime, :userLevel)");
+    QSqlQuery& query = statement(Statement::INSERT_USER);
+    const StatementGuard queryGuard(query);
 
-    query.bindValue(":userID", user.userID);
+    // userID <= 0 时绑定 NULL, 由 AUTOINCREMENT 分配
+    query.bindValue(":userID", user.userID > 0 ? QVariant(user.userID) : QVariant());
     query.bindValue(":username", QString::fromStdString(user.username));
     query.bindValue(":password", QString::fromStdString(user.password));
     query.bindValue(":nickname", QString::fromStdString(user.nickname));
@@ -86,9 +544,13 @@ bool DatabaseManager::createUser(const User& user)
         return false;
     }
 
+    const int userID = user.userID > 0 ? user.userID : query.lastInsertId().toInt();
+    if (newUserID)
+        *newUserID = userID;
+
     // 为用户创建购物车
-    if (!createUserCart(user.userID)) {
-        qDebug() << "Failed to create cart for user: " << user.userID;
+    if (!createUserCart(userID)) {
+        qDebug() << "Failed to create cart for user: " << userID;
         return false;
     }
 
@@ -97,12 +559,13 @@ bool DatabaseManager::createUser(const User& user)
 
 User DatabaseManager::getUserByID(int userID)
 {
-    User user;
+    const OperationTimer timer(operationLatency[static_cast<int>(DbOperation::GET_USER_BY_ID)]);
+    User user{};
     if (!isOpen)
         return user;
 
-    QSqlQuery query(db);
-    query.prepare("SELECT * FROM users WHERE userID = :userID");
+    QSqlQuery& query = statement(Statement::SELECT_USER);
+    const StatementGuard queryGuard(query);
     query.bindValue(":userID", userID);
 
     if (!query.exec() || !query.next()) {
@@ -126,17 +589,32 @@ User DatabaseManager::getUserByID(int userID)
     return user;
 }
 
+User DatabaseManager::getUserByUsername(const std::string& username)
+{
+    const OperationTimer timer(operationLatency[static_cast<int>(DbOperation::GET_USER_BY_USERNAME)]);
+    User user{};
+    if (!isOpen)
+        return user;
+
+    QSqlQuery& query = statement(Statement::SELECT_USER_ID_BY_USERNAME);
+    const StatementGuard queryGuard(query);
+    query.bindValue(":username", QString::fromStdString(username));
+
+    if (!query.exec() || !query.next()) {
+        return user;
+    }
+
+    return getUserByID(query.value("userID").toInt());
+}
+
 bool DatabaseManager::updateUser(const User& user)
 {
+    const OperationTimer timer(operationLatency[static_cast<int>(DbOperation::UPDATE_USER)]);
     if (!isOpen)
         return false;
 
-    QSqlQuery query(db);
-    query.prepare("UPDATE users SET username = :username, password = :password, "
-        "nickname = :nickname, avatarURL = :avatarURL, phone = :phone, "
-        "default_address = :default_address, rating = :rating, numsofRate = :numsofRate, balance = :balance, "
-        "registerTime = :registerTime, userLevel = :userLevel "
-        "WHERE userID = :userID");
+    QSqlQuery& query = statement(Statement::UPDATE_USER);
+    const StatementGuard queryGuard(query);
 
     query.bindValue(":username", QString::fromStdString(user.username));
     query.bindValue(":password", QString::fromStdString(user.password));
@@ -160,11 +638,12 @@ bool DatabaseManager::updateUser(const User& user)
 
 bool DatabaseManager::updateUserRating(int userID, int newRating)
 {
+    const OperationTimer timer(operationLatency[static_cast<int>(DbOperation::UPDATE_USER_RATING)]);
     if (!isOpen)
         return false;
 
-    QSqlQuery query(db);
-    query.prepare("UPDATE users SET rating = :rating WHERE userID = :userID");
+    QSqlQuery& query = statement(Statement::UPDATE_USER_RATING);
+    const StatementGuard queryGuard(query);
     query.bindValue(":rating", newRating);
     query.bindValue(":userID", userID);
 
@@ -177,40 +656,52 @@ bool DatabaseManager::updateUserRating(int userID, int newRating)
 
 bool DatabaseManager::deleteUser(int userID)
 {
+    const OperationTimer timer(operationLatency[static_cast<int>(DbOperation::DELETE_USER)]);
     if (!isOpen)
         return false;
 
+    // 任一步失败时整体回滚
+    TransactionScope transaction(*this);
+    if (!transaction.isActive())
+        return false;
+
     // 先删除用户的购物车
-    QSqlQuery deleteCartQuery(db);
-    deleteCartQuery.prepare("DELETE FROM cart_items WHERE userID = :userID");
+    QSqlQuery& deleteCartQuery = statement(Statement::DELETE_CART_ITEMS);
+    const StatementGuard deleteCartQueryGuard(deleteCartQuery);
     deleteCartQuery.bindValue(":userID", userID);
-    deleteCartQuery.exec();
+    if (!deleteCartQuery.exec()) {
+        qDebug() << "Delete user cart failed: " << deleteCartQuery.lastError().text();
+        return false;
+    }
 
     // 再删除用户
-    QSqlQuery query(db);
-    query.prepare("DELETE FROM users WHERE userID = :userID");
+    QSqlQuery& query = statement(Statement::DELETE_USER);
+    const StatementGuard queryGuard(query);
     query.bindValue(":userID", userID);
 
     if (!query.exec()) {
         qDebug() << "Delete user failed: " << query.lastError().text();
         return false;
     }
-    return true;
+    return transaction.commit();
 }
 
-bool DatabaseManager::createProduct(const Product& product)
+bool DatabaseManager::createProduct(const Product& product, int* newProductID)
 {
+    const OperationTimer timer(operationLatency[static_cast<int>(DbOperation::CREATE_PRODUCT)]);
     if (!isOpen)
         return false;
 
+    // 任一步失败时整体回滚
+    TransactionScope transaction(*this);
+    if (!transaction.isActive())
+        return false;
+
     // 首先插入产品基本信息
-    QSqlQuery query(db);
-    query.prepare("INSERT INTO products (productID, description, brief_description, "
-        "specification, brand, productName, category, sellerID, salesCount) "
-        "VALUES (:productID, :description, :brief_description, "
-        ":specification, :brand, :productName, :category, :sellerID, :salesCount)");
+    QSqlQuery& query = statement(Statement::INSERT_PRODUCT);
+    const StatementGuard queryGuard(query);
 
-    query.bindValue(":productID", product.productID);
+    query.bindValue(":productID", product.productID > 0 ? QVariant(product.productID) : QVariant());
     query.bindValue(":description", QString::fromStdString(product.description));
     query.bindValue(":brief_description", QString::fromStdString(product.brief_description));
     query.bindValue(":specification", QString::fromStdString(product.specification));
@@ -225,29 +716,29 @@ bool DatabaseManager::createProduct(const Product& product)
         return false;
     }
 
+    const int productID = product.productID > 0 ? product.productID : query.lastInsertId().toInt();
+    if (newProductID)
+        *newProductID = productID;
+
     // 插入产品图片
+    QSqlQuery& imgQuery = statement(Statement::INSERT_PRODUCT_IMAGE);
+    const StatementGuard imgQueryGuard(imgQuery);
     for (const auto& imageURL : product.description_imageURLs) {
-        QSqlQuery imgQuery(db);
-        imgQuery.prepare("INSERT INTO product_images (productID, imageURL) "
-            "VALUES (:productID, :imageURL)");
-        imgQuery.bindValue(":productID", product.productID);
+        imgQuery.bindValue(":productID", productID);
         imgQuery.bindValue(":imageURL", QString::fromStdString(imageURL));
 
         if (!imgQuery.exec()) {
             qDebug() << "Insert product image failed: " << imgQuery.lastError().text();
+            return false;
         }
     }
 
     // 插入产品分类
+    QSqlQuery& classQuery = statement(Statement::INSERT_PRODUCT_CLASS);
+    const StatementGuard classQueryGuard(classQuery);
     for (const auto& productClass : product.product_class) {
-        QSqlQuery classQuery(db);
-        classQuery.prepare("INSERT INTO product_classes (classID, productID, stock, "
-            "small_imageURL, name, price) "
-            "VALUES (:classID, :productID, :stock, "
-            ":small_imageURL, :name, :price)");
-
-        classQuery.bindValue(":classID", productClass.classID);
-        classQuery.bindValue(":productID", product.productID);
+        classQuery.bindValue(":classID", productClass.classID > 0 ? QVariant(productClass.classID) : QVariant());
+        classQuery.bindValue(":productID", productID);
         classQuery.bindValue(":stock", productClass.stock);
         classQuery.bindValue(":small_imageURL", QString::fromStdString(productClass.small_imageURL));
         classQuery.bindValue(":name", QString::fromStdString(productClass.name));
@@ -255,82 +746,131 @@ bool DatabaseManager::createProduct(const Product& product)
 
         if (!classQuery.exec()) {
             qDebug() << "Insert product class failed: " << classQuery.lastError().text();
+            return false;
         }
     }
 
-    return true;
+    return transaction.commit();
 }
 
 Product DatabaseManager::getProductByID(int productID)
 {
-    Product product;
-    if (!isOpen)
-        return product;
+    const OperationTimer timer(operationLatency[static_cast<int>(DbOperation::GET_PRODUCT_BY_ID)]);
+    std::vector<Product> products = loadProducts({ productID });
+    return products.empty() ? Product{} : std::move(products.front());
+}
 
-    // 获取产品基本信息
-    QSqlQuery query(db);
-    query.prepare("SELECT * FROM products WHERE productID = :productID");
-    query.bindValue(":productID", productID);
+std::vector<Product> DatabaseManager::getProductsByIDs(const std::vector<int>& productIDs)
+{
+    const OperationTimer timer(operationLatency[static_cast<int>(DbOperation::GET_PRODUCTS_BY_IDS)]);
+    return loadProducts(productIDs);
+}
 
-    if (!query.exec() || !query.next()) {
-        qDebug() << "Get product failed: " << query.lastError().text();
-        return product;
-    }
-
-    product.productID = query.value("productID").toInt();
-    product.description = query.value("description").toString().toStdString();
-    product.brief_description = query.value("brief_description").toString().toStdString();
-    product.specification = query.value("specification").toString().toStdString();
-    product.brand = query.value("brand").toString().toStdString();
-    product.productName = query.value("productName").toString().toStdString();
-    product.category = query.value("category").toString().toStdString();
-    product.sellerID = query.value("sellerID").toInt();
-    product.salesCount = query.value("salesCount").toInt();
-
-    // 获取产品图片
-    QSqlQuery imgQuery(db);
-    imgQuery.prepare("SELECT imageURL FROM product_images WHERE productID = :productID");
-    imgQuery.bindValue(":productID", productID);
-
-    if (imgQuery.exec()) {
-        while (imgQuery.next()) {
-            product.description_imageURLs.push_back(
-                imgQuery.value("imageURL").toString().toStdString());
-        }
+std::vector<Product> DatabaseManager::loadProducts(const std::vector<int>& productIDs)
+{
+    std::vector<Product> products(productIDs.size(), Product{});
+    if (!isOpen || productIDs.empty())
+        return products;
+
+    // 商品编号 -> 在 productIDs 中第一次出现的位置, 重复的编号最后复制
+    std::unordered_map<int, size_t> positions;
+    std::vector<int> ids;
+    for (size_t i = 0; i < productIDs.size(); ++i) {
+        if (positions.emplace(productIDs[i], i).second)
+            ids.push_back(productIDs[i]);
     }
+    auto find = [&](int productID) -> Product* {
+        const auto it = positions.find(productID);
+        return it == positions.end() ? nullptr : &products[it->second];
+    };
 
-    // 获取产品分类
-    QSqlQuery classQuery(db);
-    classQuery.prepare("SELECT * FROM product_classes WHERE productID = :productID");
-    classQuery.bindValue(":productID", productID);
+    for (size_t start = 0; start < ids.size(); start += PRODUCT_ID_CHUNK) {
+        // 获取产品基本信息
+        {
+            QSqlQuery& query = statement(Statement::SELECT_PRODUCTS_BY_IDS);
+            const StatementGuard queryGuard(query);
+            bindProductIDs(query, ids, start);
+            if (!query.exec()) {
+                qDebug() << "Get products failed: " << query.lastError().text();
+                return std::vector<Product>(productIDs.size(), Product{});
+            }
+            while (query.next()) {
+                Product* product = find(query.value("productID").toInt());
+                if (!product)
+                    continue;
+                product->productID = query.value("productID").toInt();
+                product->description = query.value("description").toString().toStdString();
+                product->brief_description = query.value("brief_description").toString().toStdString();
+                product->specification = query.value("specification").toString().toStdString();
+                product->brand = query.value("brand").toString().toStdString();
+                product->productName = query.value("productName").toString().toStdString();
+                product->category = query.value("category").toString().toStdString();
+                product->sellerID = query.value("sellerID").toInt();
+                product->salesCount = query.value("salesCount").toInt();
+            }
+        }
 
-    if (classQuery.exec()) {
-        while (classQuery.next()) {
-            ProductClass productClass;
-            productClass.classID = classQuery.value("classID").toInt();
-            productClass.stock = classQuery.value("stock").toInt();
-            productClass.small_imageURL = classQuery.value("small_imageURL").toString().toStdString();
-            productClass.name = classQuery.value("name").toString().toStdString();
-            productClass.price = classQuery.value("price").toDouble();
+        // 获取产品图片
+        {
+            QSqlQuery& imgQuery = statement(Statement::SELECT_IMAGES_BY_PRODUCT_IDS);
+            const StatementGuard imgQueryGuard(imgQuery);
+            bindProductIDs(imgQuery, ids, start);
+            if (imgQuery.exec()) {
+                while (imgQuery.next()) {
+                    Product* product = find(imgQuery.value("productID").toInt());
+                    if (product)
+                        product->description_imageURLs.push_back(imgQuery.value("imageURL").toString().toStdString());
+                }
+            }
+        }
 
-            product.product_class.push_back(productClass);
+        // 获取产品分类
+        {
+            QSqlQuery& classQuery = statement(Statement::SELECT_CLASSES_BY_PRODUCT_IDS);
+            const StatementGuard classQueryGuard(classQuery);
+            bindProductIDs(classQuery, ids, start);
+            if (classQuery.exec()) {
+                while (classQuery.next()) {
+                    Product* product = find(classQuery.value("productID").toInt());
+                    if (!product)
+                        continue;
+                    ProductClass productClass{};
+                    productClass.classID = classQuery.value("classID").toInt();
+                    productClass.stock = classQuery.value("stock").toInt();
+                    productClass.small_imageURL = classQuery.value("small_imageURL").toString().toStdString();
+                    productClass.name = classQuery.value("name").toString().toStdString();
+                    productClass.price = classQuery.value("price").toDouble();
+
+                    product->product_class.push_back(productClass);
+                }
+            }
         }
     }
 
-    return product;
+    // 基本信息不存在的商品不返回图片和规格
+    for (size_t i = 0; i < productIDs.size(); ++i) {
+        const size_t first = positions[productIDs[i]];
+        if (first != i)
+            products[i] = products[first];
+        else if (products[i].productID == 0)
+            products[i] = Product{};
+    }
+    return products;
 }
 
 bool DatabaseManager::updateProduct(const Product& product)
 {
+    const OperationTimer timer(operationLatency[static_cast<int>(DbOperation::UPDATE_PRODUCT)]);
     if (!isOpen)
         return false;
 
-    QSqlQuery query(db);
-    query.prepare("UPDATE products SET description = :description, "
-        "brief_description = :brief_description, specification = :specification, "
-        "brand = :brand, productName = :productName, category = :category, "
-        "sellerID = :sellerID, salesCount = :salesCount "
-        "WHERE productID = :productID");
+    // 任一步失败时整体回滚
+    TransactionScope transaction(*this);
+    if (!transaction.isActive())
+        return false;
+
+    QSqlQuery& query = statement(Statement::UPDATE_PRODUCT);
+    const StatementGuard queryGuard(query);
 
     query.bindValue(":description", QString::fromStdString(product.description));
     query.bindValue(":brief_description", QString::fromStdString(product.brief_description));
@@ -348,84 +888,241 @@ bool DatabaseManager::updateProduct(const Product& product)
     }
 
     // 更新产品图片（先删除再插入）
-    QSqlQuery deleteImgQuery(db);
-    deleteImgQuery.prepare("DELETE FROM product_images WHERE productID = :productID");
+    QSqlQuery& deleteImgQuery = statement(Statement::DELETE_PRODUCT_IMAGES);
+    const StatementGuard deleteImgQueryGuard(deleteImgQuery);
     deleteImgQuery.bindValue(":productID", product.productID);
-    deleteImgQuery.exec();
+    if (!deleteImgQuery.exec()) {
+        qDebug() << "Delete product images failed: " << deleteImgQuery.lastError().text();
+        return false;
+    }
 
+    QSqlQuery& imgQuery = statement(Statement::INSERT_PRODUCT_IMAGE);
+    const StatementGuard imgQueryGuard(imgQuery);
     for (const auto& imageURL : product.description_imageURLs) {
-        QSqlQuery imgQuery(db);
-        imgQuery.prepare("INSERT INTO product_images (productID, imageURL) "
-            "VALUES (:productID, :imageURL)");
         imgQuery.bindValue(":productID", product.productID);
         imgQuery.bindValue(":imageURL", QString::fromStdString(imageURL));
-        imgQuery.exec();
+        if (!imgQuery.exec()) {
+            qDebug() << "Insert product image failed: " << imgQuery.lastError().text();
+            return false;
+        }
     }
 
-    // 更新产品分类（先删除再插入）
-    QSqlQuery deleteClassQuery(db);
-    deleteClassQuery.prepare("DELETE FROM product_classes WHERE productID = :productID");
-    deleteClassQuery.bindValue(":productID", product.productID);
-    deleteClassQuery.exec();
-
+    // 更新产品分类: 已有的规格原地更新, 购物车引用的 classID 保持不变; 不再出现的规格删除
+    std::vector<int> keptClasses;
+    QSqlQuery& classQuery = statement(Statement::UPSERT_PRODUCT_CLASS);
+    const StatementGuard classQueryGuard(classQuery);
     for (const auto& productClass : product.product_class) {
-        QSqlQuery classQuery(db);
-        classQuery.prepare("INSERT INTO product_classes (classID, productID, stock, "
-            "small_imageURL, name, price) "
-            "VALUES (:classID, :productID, :stock, "
-            ":small_imageURL, :name, :price)");
-
-        classQuery.bindValue(":classID", productClass.classID);
+        classQuery.bindValue(":classID", productClass.classID > 0 ? QVariant(productClass.classID) : QVariant());
         classQuery.bindValue(":productID", product.productID);
         classQuery.bindValue(":stock", productClass.stock);
         classQuery.bindValue(":small_imageURL", QString::fromStdString(productClass.small_imageURL));
         classQuery.bindValue(":name", QString::fromStdString(productClass.name));
         classQuery.bindValue(":price", productClass.price);
 
-        classQuery.exec();
+        // classID 属于其他商品时不会修改任何行
+        if (!classQuery.exec() || classQuery.numRowsAffected() != 1) {
+            qDebug() << "Update product class failed: " << classQuery.lastError().text();
+            return false;
+        }
+        keptClasses.push_back(productClass.classID > 0 ? productClass.classID : classQuery.lastInsertId().toInt());
     }
 
-    return true;
+    QSqlQuery& existingQuery = statement(Statement::SELECT_PRODUCT_CLASSES);
+    const StatementGuard existingQueryGuard(existingQuery);
+    existingQuery.bindValue(":productID", product.productID);
+    if (!existingQuery.exec()) {
+        qDebug() << "Get product classes failed: " << existingQuery.lastError().text();
+        return false;
+    }
+    std::vector<int> removedClasses;
+    while (existingQuery.next()) {
+        const int classID = existingQuery.value("classID").toInt();
+        if (std::find(keptClasses.begin(), keptClasses.end(), classID) == keptClasses.end())
+            removedClasses.push_back(classID);
+    }
+
+    // 仍在购物车中的规格受外键约束不能删除, 整个更新回滚
+    QSqlQuery& deleteClassQuery = statement(Statement::DELETE_PRODUCT_CLASS);
+    const StatementGuard deleteClassQueryGuard(deleteClassQuery);
+    for (int classID : removedClasses) {
+        deleteClassQuery.bindValue(":classID", classID);
+        if (!deleteClassQuery.exec()) {
+            qDebug() << "Delete product class failed: " << deleteClassQuery.lastError().text();
+            return false;
+        }
+    }
+
+    notifyProductChanged(product.productID);
+    return transaction.commit();
 }
 
 bool DatabaseManager::deleteProduct(int productID)
 {
+    const OperationTimer timer(operationLatency[static_cast<int>(DbOperation::DELETE_PRODUCT)]);
     if (!isOpen)
         return false;
 
+    // 任一步失败时整体回滚
+    TransactionScope transaction(*this);
+    if (!transaction.isActive())
+        return false;
+
     // 先删除相关数据
-    QSqlQuery deleteImgQuery(db);
-    deleteImgQuery.prepare("DELETE FROM product_images WHERE productID = :productID");
+    QSqlQuery& deleteImgQuery = statement(Statement::DELETE_PRODUCT_IMAGES);
+    const StatementGuard deleteImgQueryGuard(deleteImgQuery);
     deleteImgQuery.bindValue(":productID", productID);
-    deleteImgQuery.exec();
+    if (!deleteImgQuery.exec()) {
+        qDebug() << "Delete product images failed: " << deleteImgQuery.lastError().text();
+        return false;
+    }
 
-    QSqlQuery deleteClassQuery(db);
-    deleteClassQuery.prepare("DELETE FROM product_classes WHERE productID = :productID");
+    QSqlQuery& deleteClassQuery = statement(Statement::DELETE_PRODUCT_CLASSES);
+    const StatementGuard deleteClassQueryGuard(deleteClassQuery);
     deleteClassQuery.bindValue(":productID", productID);
-    deleteClassQuery.exec();
+    if (!deleteClassQuery.exec()) {
+        qDebug() << "Delete product classes failed: " << deleteClassQuery.lastError().text();
+        return false;
+    }
 
     // 再删除产品
-    QSqlQuery query(db);
-    query.prepare("DELETE FROM products WHERE productID = :productID");
+    QSqlQuery& query = statement(Statement::DELETE_PRODUCT);
+    const StatementGuard queryGuard(query);
     query.bindValue(":productID", productID);
 
     if (!query.exec()) {
         qDebug() << "Delete product failed: " << query.lastError().text();
         return false;
     }
+    notifyProductChanged(productID);
+    return transaction.commit();
+}
+
+std::vector<Product> DatabaseManager::getProductList(int page, int pageSize, const std::string& category,
+    const std::string& keyword, int* totalCount)
+{
+    const OperationTimer timer(operationLatency[static_cast<int>(DbOperation::GET_PRODUCT_LIST)]);
+    std::vector<Product> products;
+    if (!isOpen)
+        return products;
+
+    if (page < 1)
+        page = 1;
+    if (pageSize < 1)
+        pageSize = 20;
+
+    // 过滤条件为 NULL 时不过滤, 四种组合共用一条语句
+    const QVariant categoryFilter = category.empty() ? QVariant() : QVariant(QString::fromStdString(category));
+    const QVariant keywordFilter = keyword.empty()
+        ? QVariant() : QVariant("%" + QString::fromStdString(keyword) + "%");
+    auto bindFilters = [&](QSqlQuery& q) {
+        q.bindValue(":category", categoryFilter);
+        q.bindValue(":category2", categoryFilter);
+        q.bindValue(":keyword", keywordFilter);
+        q.bindValue(":keyword2", keywordFilter);
+        q.bindValue(":keyword3", keywordFilter);
+    };
+
+    if (totalCount) {
+        QSqlQuery& countQuery = statement(Statement::COUNT_PRODUCTS);
+        const StatementGuard countQueryGuard(countQuery);
+        bindFilters(countQuery);
+        *totalCount = (countQuery.exec() && countQuery.next()) ? countQuery.value(0).toInt() : 0;
+    }
+
+    QSqlQuery& query = statement(Statement::SELECT_PRODUCT_PAGE);
+    const StatementGuard queryGuard(query);
+    bindFilters(query);
+    query.bindValue(":limit", pageSize);
+    query.bindValue(":offset", static_cast<qint64>(page - 1) * pageSize);
+
+    if (!query.exec()) {
+        qDebug() << "Get product list failed: " << query.lastError().text();
+        return products;
+    }
+
+    std::vector<int> productIDs;
+    while (query.next()) {
+        productIDs.push_back(query.value("productID").toInt());
+    }
+    return loadProducts(productIDs);
+}
+
+std::vector<Product> DatabaseManager::getProductsBySeller(int sellerID, int page, int pageSize, int* totalCount)
+{
+    const OperationTimer timer(operationLatency[static_cast<int>(DbOperation::GET_PRODUCTS_BY_SELLER)]);
+    std::vector<Product> products;
+    if (!isOpen)
+        return products;
+
+    if (page < 1)
+        page = 1;
+    if (pageSize < 1)
+        pageSize = 20;
+
+    if (totalCount) {
+        QSqlQuery& countQuery = statement(Statement::COUNT_SELLER_PRODUCTS);
+        const StatementGuard countQueryGuard(countQuery);
+        countQuery.bindValue(":sellerID", sellerID);
+        *totalCount = (countQuery.exec() && countQuery.next()) ? countQuery.value(0).toInt() : 0;
+    }
+
+    QSqlQuery& query = statement(Statement::SELECT_SELLER_PRODUCT_PAGE);
+    const StatementGuard queryGuard(query);
+    query.bindValue(":sellerID", sellerID);
+    query.bindValue(":limit", pageSize);
+    query.bindValue(":offset", static_cast<qint64>(page - 1) * pageSize);
+
+    if (!query.exec()) {
+        qDebug() << "Get products by seller failed: " << query.lastError().text();
+        return products;
+    }
+
+    std::vector<int> productIDs;
+    while (query.next()) {
+        productIDs.push_back(query.value("productID").toInt());
+    }
+    return loadProducts(productIDs);
+}
+
+bool DatabaseManager::decreaseStock(int productID, int classID, int quantity)
+{
+    const OperationTimer timer(operationLatency[static_cast<int>(DbOperation::DECREASE_STOCK)]);
+    if (!isOpen)
+        return false;
+
+    // 条件更新, 库存不足时不会修改任何行
+    QSqlQuery& query = statement(Statement::DECREASE_STOCK);
+    const StatementGuard queryGuard(query);
+    query.bindValue(":quantity", quantity);
+    query.bindValue(":classID", classID);
+    query.bindValue(":productID", productID);
+    query.bindValue(":minStock", quantity);
+
+    if (!query.exec()) {
+        qDebug() << "Decrease stock failed: " << query.lastError().text();
+        return false;
+    }
+    if (query.numRowsAffected() != 1)
+        return false;
+    notifyProductChanged(productID);
     return true;
 }
 
-bool DatabaseManager::createOrder(const Order& order)
+bool DatabaseManager::createOrder(const Order& order, int* newOrderID)
 {
+    const OperationTimer timer(operationLatency[static_cast<int>(DbOperation::CREATE_ORDER)]);
     if (!isOpen)
         return false;
 
-    QSqlQuery query(db);
-    query.prepare("INSERT INTO orders (orderID, userID, sellerID, totalAmount, status, address, createdTime) "
-        "VALUES (:orderID, :userID, :sellerID, :totalAmount, :status, :address, :createdTime)");
+    // 任一步失败时整体回滚
+    TransactionScope transaction(*this);
+    if (!transaction.isActive())
+        return false;
+
+    QSqlQuery& query = statement(Statement::INSERT_ORDER);
+    const StatementGuard queryGuard(query);
 
-    query.bindValue(":orderID", order.orderID);
+    query.bindValue(":orderID", order.orderID > 0 ? QVariant(order.orderID) : QVariant());
     query.bindValue(":userID", order.userID);
     query.bindValue(":sellerID", order.sellerID);
     query.bindValue(":totalAmount", order.totalAmount);
@@ -438,13 +1135,15 @@ bool DatabaseManager::createOrder(const Order& order)
         return false;
     }
 
+    const int orderID = order.orderID > 0 ? order.orderID : query.lastInsertId().toInt();
+    if (newOrderID)
+        *newOrderID = orderID;
+
     // 插入订单项
+    QSqlQuery& itemQuery = statement(Statement::INSERT_ORDER_ITEM);
+    const StatementGuard itemQueryGuard(itemQuery);
     for (const auto& item : order.orderItems) {
-        QSqlQuery itemQuery(db);
-        itemQuery.prepare("INSERT INTO order_items (orderID, productID, classID, quantity, price) "
-            "VALUES (:orderID, :productID, :classID, :quantity, :price)");
-
-        itemQuery.bindValue(":orderID", order.orderID);
+        itemQuery.bindValue(":orderID", orderID);
         itemQuery.bindValue(":productID", item.productID);
         itemQuery.bindValue(":classID", item.classID);
         itemQuery.bindValue(":quantity", item.quantity);
@@ -452,21 +1151,23 @@ bool DatabaseManager::createOrder(const Order& order)
 
         if (!itemQuery.exec()) {
             qDebug() << "Insert order item failed: " << itemQuery.lastError().text();
+            return false;
         }
     }
 
-    return true;
+    return transaction.commit();
 }
 
 Order DatabaseManager::getOrderById(int orderId)
 {
-    Order order;
+    const OperationTimer timer(operationLatency[static_cast<int>(DbOperation::GET_ORDER_BY_ID)]);
+    Order order{};
     if (!isOpen)
         return order;
 
     // 获取订单基本信息
-    QSqlQuery query(db);
-    query.prepare("SELECT * FROM orders WHERE orderID = :orderID");
+    QSqlQuery& query = statement(Statement::SELECT_ORDER);
+    const StatementGuard queryGuard(query);
     query.bindValue(":orderID", orderId);
 
     if (!query.exec() || !query.next()) {
@@ -483,13 +1184,13 @@ Order DatabaseManager::getOrderById(int orderId)
     order.createdTime = query.value("createdTime").toString().toStdString();
 
     // 获取订单项
-    QSqlQuery itemQuery(db);
-    itemQuery.prepare("SELECT * FROM order_items WHERE orderID = :orderID");
+    QSqlQuery& itemQuery = statement(Statement::SELECT_ORDER_ITEMS);
+    const StatementGuard itemQueryGuard(itemQuery);
     itemQuery.bindValue(":orderID", orderId);
 
     if (itemQuery.exec()) {
         while (itemQuery.next()) {
-            OrderItem item;
+            OrderItem item{};
             item.productID = itemQuery.value("productID").toInt();
             item.classID = itemQuery.value("classID").toInt();
             item.quantity = itemQuery.value("quantity").toInt();
@@ -504,11 +1205,12 @@ Order DatabaseManager::getOrderById(int orderId)
 
 bool DatabaseManager::updateOrderStatus(int orderId, int status)
 {
+    const OperationTimer timer(operationLatency[static_cast<int>(DbOperation::UPDATE_ORDER_STATUS)]);
     if (!isOpen)
         return false;
 
-    QSqlQuery query(db);
-    query.prepare("UPDATE orders SET status = :status WHERE orderID = :orderID");
+    QSqlQuery& query = statement(Statement::UPDATE_ORDER_STATUS);
+    const StatementGuard queryGuard(query);
     query.bindValue(":status", status);
     query.bindValue(":orderID", orderId);
 
@@ -521,29 +1223,106 @@ bool DatabaseManager::updateOrderStatus(int orderId, int status)
 
 bool DatabaseManager::deleteOrder(int orderId)
 {
+    const OperationTimer timer(operationLatency[static_cast<int>(DbOperation::DELETE_ORDER)]);
     if (!isOpen)
         return false;
 
+    // 任一步失败时整体回滚
+    TransactionScope transaction(*this);
+    if (!transaction.isActive())
+        return false;
+
     // 先删除订单项
-    QSqlQuery deleteItemsQuery(db);
-    deleteItemsQuery.prepare("DELETE FROM order_items WHERE orderID = :orderID");
+    QSqlQuery& deleteItemsQuery = statement(Statement::DELETE_ORDER_ITEMS);
+    const StatementGuard deleteItemsQueryGuard(deleteItemsQuery);
     deleteItemsQuery.bindValue(":orderID", orderId);
-    deleteItemsQuery.exec();
+    if (!deleteItemsQuery.exec()) {
+        qDebug() << "Delete order items failed: " << deleteItemsQuery.lastError().text();
+        return false;
+    }
 
     // 再删除订单
-    QSqlQuery query(db);
-    query.prepare("DELETE FROM orders WHERE orderID = :orderID");
+    QSqlQuery& query = statement(Statement::DELETE_ORDER);
+    const StatementGuard queryGuard(query);
     query.bindValue(":orderID", orderId);
 
     if (!query.exec()) {
         qDebug() << "Delete order failed: " << query.lastError().text();
         return false;
     }
-    return true;
+    return transaction.commit();
+}
+
+std::vector<Order> DatabaseManager::getOrdersByUserID(int userID, int page, int pageSize, int statusFilter,
+    int* totalCount)
+{
+    const OperationTimer timer(operationLatency[static_cast<int>(DbOperation::GET_ORDERS_BY_USER_ID)]);
+    std::vector<Order> orders;
+    if (!isOpen)
+        return orders;
+
+    if (page < 1)
+        page = 1;
+    if (pageSize < 1)
+        pageSize = 20;
+
+    // statusFilter 为 0 表示所有状态
+    if (totalCount) {
+        QSqlQuery& countQuery = statement(Statement::COUNT_USER_ORDERS);
+        const StatementGuard countQueryGuard(countQuery);
+        countQuery.bindValue(":userID", userID);
+        countQuery.bindValue(":status", statusFilter);
+        countQuery.bindValue(":status2", statusFilter);
+        *totalCount = (countQuery.exec() && countQuery.next()) ? countQuery.value(0).toInt() : 0;
+    }
+
+    QSqlQuery& query = statement(Statement::SELECT_USER_ORDER_PAGE);
+    const StatementGuard queryGuard(query);
+    query.bindValue(":userID", userID);
+    query.bindValue(":status", statusFilter);
+    query.bindValue(":status2", statusFilter);
+    query.bindValue(":limit", pageSize);
+    query.bindValue(":offset", static_cast<qint64>(page - 1) * pageSize);
+
+    if (!query.exec()) {
+        qDebug() << "Get orders failed: " << query.lastError().text();
+        return orders;
+    }
+
+    while (query.next()) {
+        orders.push_back(getOrderById(query.value("orderID").toInt()));
+    }
+    return orders;
+}
+
+std::vector<Order> DatabaseManager::getOrdersByStatus(int status)
+{
+    std::vector<Order> orders;
+    if (!isOpen)
+        return orders;
+
+    QSqlQuery query(database());
+    query.setForwardOnly(true);
+    query.prepare("SELECT orderID, createdTime FROM orders WHERE status = :status ORDER BY orderID");
+    query.bindValue(":status", status);
+    if (!query.exec()) {
+        qDebug() << "Get orders by status failed: " << query.lastError().text();
+        return orders;
+    }
+
+    while (query.next()) {
+        Order order{};
+        order.orderID = query.value("orderID").toInt();
+        order.status = status;
+        order.createdTime = query.value("createdTime").toString().toStdString();
+        orders.push_back(order);
+    }
+    return orders;
 }
 
 Cart DatabaseManager::getCartByUserID(int userID)
 {
+    const OperationTimer timer(operationLatency[static_cast<int>(DbOperation::GET_CART_BY_USER_ID)]);
     Cart cart;
     cart.userID = userID;
     cart.totalAmount = 0.0;
@@ -551,12 +1330,8 @@ Cart DatabaseManager::getCartByUserID(int userID)
     if (!isOpen)
         return cart;
 
-    QSqlQuery query(db);
-    query.prepare("SELECT ci.productID, ci.classID, ci.quantity, pc.price, p.productName, pc.name as className "
-        "FROM cart_items ci "
-        "JOIN product_classes pc ON ci.classID = pc.classID "
-        "JOIN products p ON ci.productID = p.productID "
-        "WHERE ci.userID = :userID");
+    QSqlQuery& query = statement(Statement::SELECT_CART);
+    const StatementGuard queryGuard(query);
     query.bindValue(":userID", userID);
 
     if (query.exec()) {
@@ -580,20 +1355,24 @@ Cart DatabaseManager::getCartByUserID(int userID)
 
 bool DatabaseManager::updateCart(const Cart& cart)
 {
+    const OperationTimer timer(operationLatency[static_cast<int>(DbOperation::UPDATE_CART)]);
     if (!isOpen)
         return false;
 
+    // 任一步失败时整体回滚
+    TransactionScope transaction(*this);
+    if (!transaction.isActive())
+        return false;
+
     // 先清空购物车
     if (!clearCart(cart.userID)) {
         return false;
     }
 
     // 再添加所有商品
+    QSqlQuery& query = statement(Statement::INSERT_CART_ITEM);
+    const StatementGuard queryGuard(query);
     for (const auto& item : cart.items) {
-        QSqlQuery query(db);
-        query.prepare("INSERT INTO cart_items (userID, productID, classID, quantity) "
-            "VALUES (:userID, :productID, :classID, :quantity)");
-
         query.bindValue(":userID", cart.userID);
         query.bindValue(":productID", item.productID);
         query.bindValue(":classID", item.classID);
@@ -605,16 +1384,17 @@ bool DatabaseManager::updateCart(const Cart& cart)
         }
     }
 
-    return true;
+    return transaction.commit();
 }
 
 bool DatabaseManager::clearCart(int userID)
 {
+    const OperationTimer timer(operationLatency[static_cast<int>(DbOperation::CLEAR_CART)]);
     if (!isOpen)
         return false;
 
-    QSqlQuery query(db);
-    query.prepare("DELETE FROM cart_items WHERE userID = :userID");
+    QSqlQuery& query = statement(Statement::DELETE_CART_ITEMS);
+    const StatementGuard queryGuard(query);
     query.bindValue(":userID", userID);
 
     if (!query.exec()) {
@@ -626,12 +1406,13 @@ bool DatabaseManager::clearCart(int userID)
 
 bool DatabaseManager::addItemToCart(int userID, const OrderItem& item)
 {
+    const OperationTimer timer(operationLatency[static_cast<int>(DbOperation::ADD_ITEM_TO_CART)]);
     if (!isOpen)
         return false;
 
     // 检查是否已存在相同商品
-    QSqlQuery checkQuery(db);
-    checkQuery.prepare("SELECT quantity FROM cart_items WHERE userID = :userID AND productID = :productID AND classID = :classID");
+    QSqlQuery& checkQuery = statement(Statement::SELECT_CART_ITEM_QUANTITY);
+    const StatementGuard checkQueryGuard(checkQuery);
     checkQuery.bindValue(":userID", userID);
     checkQuery.bindValue(":productID", item.productID);
     checkQuery.bindValue(":classID", item.classID);
@@ -639,8 +1420,8 @@ bool DatabaseManager::addItemToCart(int userID, const OrderItem& item)
     if (checkQuery.exec() && checkQuery.next()) {
         // 更新数量
         int existingQuantity = checkQuery.value("quantity").toInt();
-        QSqlQuery updateQuery(db);
-        updateQuery.prepare("UPDATE cart_items SET quantity = :quantity WHERE userID = :userID AND productID = :productID AND classID = :classID");
+        QSqlQuery& updateQuery = statement(Statement::UPDATE_CART_ITEM_QUANTITY);
+        const StatementGuard updateQueryGuard(updateQuery);
         updateQuery.bindValue(":quantity", existingQuantity + item.quantity);
         updateQuery.bindValue(":userID", userID);
         updateQuery.bindValue(":productID", item.productID);
@@ -653,9 +1434,8 @@ bool DatabaseManager::addItemToCart(int userID, const OrderItem& item)
     }
     else {
         // 插入新商品
-        QSqlQuery insertQuery(db);
-        insertQuery.prepare("INSERT INTO cart_items (userID, productID, classID, quantity) "
-            "VALUES (:userID, :productID, :classID, :quantity)");
+        QSqlQuery& insertQuery = statement(Statement::INSERT_CART_ITEM);
+        const StatementGuard insertQueryGuard(insertQuery);
 
         insertQuery.bindValue(":userID", userID);
         insertQuery.bindValue(":productID", item.productID);
@@ -671,13 +1451,38 @@ bool DatabaseManager::addItemToCart(int userID, const OrderItem& item)
     return true;
 }
 
+bool DatabaseManager::updateCartItemQuantity(int userID, int productID, int classID, int quantity)
+{
+    const OperationTimer timer(operationLatency[static_cast<int>(DbOperation::UPDATE_CART_ITEM_QUANTITY)]);
+    if (!isOpen)
+        return false;
+
+    // 数量为0视为移除
+    if (quantity <= 0)
+        return removeItemFromCart(userID, productID, classID);
+
+    QSqlQuery& query = statement(Statement::UPDATE_CART_ITEM_QUANTITY);
+    const StatementGuard queryGuard(query);
+    query.bindValue(":quantity", quantity);
+    query.bindValue(":userID", userID);
+    query.bindValue(":productID", productID);
+    query.bindValue(":classID", classID);
+
+    if (!query.exec()) {
+        qDebug() << "Update cart item failed: " << query.lastError().text();
+        return false;
+    }
+    return query.numRowsAffected() == 1;
+}
+
 bool DatabaseManager::removeItemFromCart(int userID, int productID, int classID)
 {
+    const OperationTimer timer(operationLatency[static_cast<int>(DbOperation::REMOVE_ITEM_FROM_CART)]);
     if (!isOpen)
         return false;
 
-    QSqlQuery query(db);
-    query.prepare("DELETE FROM cart_items WHERE userID = :userID AND productID = :productID AND classID = :classID");
+    QSqlQuery& query = statement(Statement::DELETE_CART_ITEM);
+    const StatementGuard queryGuard(query);
     query.bindValue(":userID", userID);
     query.bindValue(":productID", productID);
     query.bindValue(":classID", classID);
@@ -689,6 +1494,121 @@ bool DatabaseManager::removeItemFromCart(int userID, int productID, int classID)
     return true;
 }
 
+int DatabaseManager::transactionLevel() const
+{
+    return isOpen ? connection().transactionDepth : 0;
+}
+
+bool DatabaseManager::beginTransaction()
+{
+    if (!isOpen)
+        return false;
+
+    Connection& conn = connection();
+    if (conn.transactionDepth > 0) {
+        if (!executeQuery(QString("SAVEPOINT sp%1").arg(conn.transactionDepth)))
+            return false;
+    }
+    else if (!conn.db.transaction()) {
+        qDebug() << "Begin transaction failed: " << conn.db.lastError().text();
+        return false;
+    }
+    ++conn.transactionDepth;
+    return true;
+}
+
+bool DatabaseManager::commitTransaction()
+{
+    const OperationTimer timer(operationLatency[static_cast<int>(DbOperation::COMMIT_TRANSACTION)]);
+    if (!isOpen)
+        return false;
+    Connection& conn = connection();
+    if (conn.transactionDepth == 0)
+        return false;
+
+    --conn.transactionDepth;
+    if (conn.transactionDepth > 0) {
+        if (!executeQuery(QString("RELEASE SAVEPOINT sp%1").arg(conn.transactionDepth))) {
+            executeQuery(QString("ROLLBACK TO SAVEPOINT sp%1").arg(conn.transactionDepth));
+            executeQuery(QString("RELEASE SAVEPOINT sp%1").arg(conn.transactionDepth));
+            return false;
+        }
+        return true;
+    }
+
+    if (!conn.db.commit()) {
+        qDebug() << "Commit failed: " << conn.db.lastError().text();
+        conn.db.rollback();
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseManager::rollbackTransaction()
+{
+    if (!isOpen)
+        return false;
+    Connection& conn = connection();
+    if (conn.transactionDepth == 0)
+        return false;
+
+    --conn.transactionDepth;
+    if (conn.transactionDepth > 0) {
+        // ROLLBACK TO 之后保存点仍然存在, 还要 RELEASE 掉
+        return executeQuery(QString("ROLLBACK TO SAVEPOINT sp%1").arg(conn.transactionDepth))
+            && executeQuery(QString("RELEASE SAVEPOINT sp%1").arg(conn.transactionDepth));
+    }
+    return conn.db.rollback();
+}
+
+bool DatabaseManager::checkpoint(CheckpointMode mode, int* walPages, int* checkpointedPages)
+{
+    if (!isOpen)
+        return false;
+
+    OperationTimer timer(operationLatency[static_cast<int>(DbOperation::CHECKPOINT)]);
+    // 返回一行: busy (1 表示没等到读写结束), WAL 页数, 已合并的页数; 非 WAL 模式下后两项为 -1
+    QSqlQuery query(database());
+    const char* const sql = mode == CheckpointMode::TRUNCATE ? "PRAGMA wal_checkpoint(TRUNCATE);"
+                                                               : "PRAGMA wal_checkpoint(PASSIVE);";
+    if (!query.exec(sql) || !query.next()) {
+        qDebug() << "Checkpoint failed:" << query.lastError().text();
+        return false;
+    }
+    const bool busy = query.value(0).toInt() != 0;
+    if (walPages)
+        *walPages = query.value(1).toInt();
+    if (checkpointedPages)
+        *checkpointedPages = query.value(2).toInt();
+    return !busy;
+}
+
+qint64 DatabaseManager::dataVersion()
+{
+    if (!isOpen)
+        return -1;
+
+    QSqlQuery query(database());
+    if (!query.exec("PRAGMA data_version;") || !query.next()) {
+        qDebug() << "Read data version failed:" << query.lastError().text();
+        return -1;
+    }
+    return query.value(0).toLongLong();
+}
+
+bool DatabaseManager::setBusyTimeout(int timeoutMs)
+{
+    if (!isOpen)
+        return false;
+
+    QSqlQuery query(database());
+    if (!query.exec(QString("PRAGMA busy_timeout = %1;").arg(timeoutMs))) {
+        qDebug() << "Set busy timeout failed:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
 bool DatabaseManager::initializeDatabase(const QString& dbPath)
 {
     // 如果已经打开，先关闭
@@ -714,14 +1634,24 @@ bool DatabaseManager::initializeDatabase(const QString& dbPath)
 
     qDebug() << "Database path:" << databasePath;
 
-    db.setDatabaseName(databasePath);
+    // 在调用线程打开第一个连接（如果不存在会自动创建）, 其他线程第一次访问时各自打开
+    if (!database().isOpen()) {
+        qDebug() << "Error: Cannot open database:" << databasePath;
+        closeConnections();
+        return false;
+    }
 
-    // 尝试打开数据库（如果不存在会自动创建）
-    if (!db.open()) {
-        qDebug() << "Error: Cannot open database:" << db.lastError().text();
-        isOpen = false;
+    // journal_mode 会写入数据库文件, 只需设置一次; 内存数据库等不支持 WAL 时返回实际的模式
+    QSqlQuery journal(database());
+    if (!journal.exec(QString("PRAGMA journal_mode = %1;").arg(storage.journalMode)) || !journal.next()) {
+        qDebug() << "Failed to set journal mode:" << journal.lastError().text();
+        closeConnections();
         return false;
     }
+    const QString journalMode = journal.value(0).toString();
+    journal.finish();
+    if (journalMode.compare(storage.journalMode, Qt::CaseInsensitive) != 0)
+        qDebug() << "Journal mode is" << journalMode << "instead of" << storage.journalMode;
 
     isOpen = true;
     qDebug() << "Database opened successfully";
@@ -737,13 +1667,8 @@ bool DatabaseManager::createTables()
         return false;
     }
 
-    QSqlQuery query(db);
-
-    // 启用外键约束
-    if (!query.exec("PRAGMA foreign_keys = ON;")) {
-        qDebug() << "Failed to enable foreign keys:" << query.lastError().text();
-        return false;
-    }
+    // 外键约束等 pragma 在 configureConnection 中对每个连接设置
+    QSqlQuery query(database());
 
     // 创建所有表
     QStringList tables = {
@@ -828,7 +1753,11 @@ bool DatabaseManager::createTables()
         "quantity INTEGER DEFAULT 1,"
         "price REAL DEFAULT 0.0,"
         "FOREIGN KEY (orderID) REFERENCES orders(orderID) ON DELETE CASCADE"
-        ");"
+        ");",
+
+        // 按商品读图片和规格
+        "CREATE INDEX IF NOT EXISTS idx_product_images_product ON product_images(productID);",
+        "CREATE INDEX IF NOT EXISTS idx_product_classes_product ON product_classes(productID);"
     };
 
     for (const QString& tableSql : tables) {
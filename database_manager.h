@@ -9,8 +9,67 @@
 #include <QtSql/QSqlDatabase>
 #include <QtSql/QSqlError>
 #include <QtSql/QSqlQuery>
+#include <QMutex>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 #include "data_info.h"
+#include "latency_histogram.h"
 
+// 计时的数据库操作, 与同名的 DatabaseManager 方法对应
+enum class DbOperation : uint8_t {
+    CREATE_USER,
+    GET_USER_BY_ID,
+    GET_USER_BY_USERNAME,
+    UPDATE_USER,
+    UPDATE_USER_RATING,
+    DELETE_USER,
+    CREATE_PRODUCT,
+    GET_PRODUCT_BY_ID,
+    GET_PRODUCTS_BY_IDS,
+    UPDATE_PRODUCT,
+    DELETE_PRODUCT,
+    GET_PRODUCT_LIST,
+    GET_PRODUCTS_BY_SELLER,
+    DECREASE_STOCK,
+    CREATE_ORDER,
+    GET_ORDER_BY_ID,
+    GET_ORDERS_BY_USER_ID,
+    UPDATE_ORDER_STATUS,
+    DELETE_ORDER,
+    GET_CART_BY_USER_ID,
+    UPDATE_CART,
+    CLEAR_CART,
+    ADD_ITEM_TO_CART,
+    UPDATE_CART_ITEM_QUANTITY,
+    REMOVE_ITEM_FROM_CART,
+    COMMIT_TRANSACTION,
+    CHECKPOINT
+};
+const int DB_OPERATION_COUNT = static_cast<int>(DbOperation::CHECKPOINT) + 1;
+
+// SQLite 存储参数: journalMode 在 initializeDatabase 时设置一次 (写入数据库文件), 其余每个连接打开时设置
+// WAL 下读不被写阻塞, 写也不等读; 回滚日志 (DELETE) 下每次提交都要等所有读结束
+struct StorageProfile {
+    QString journalMode = "WAL";
+    QString synchronous = "NORMAL";     // WAL 下 NORMAL 不会损坏数据库, 掉电时可能丢最近几次提交
+    int cacheSizeKiB = 16384;           // 每个连接的页缓存
+    qint64 mmapSize = 256 * 1024 * 1024;    // 0 表示不用内存映射读
+    QString tempStore = "MEMORY";
+    int busyTimeoutMs = 5000;           // 其他连接持有锁时等待而不是立即返回 SQLITE_BUSY
+    int autoCheckpointPages = 1000;     // 提交时 WAL 超过该页数就在提交的线程上做检查点, 0 表示交给 WalCheckpointer
+};
+
+// WAL 检查点方式: PASSIVE 不等读写, 能合并多少算多少; TRUNCATE 等读结束 (期间挡住写), 合并全部后清空 WAL 文件
+enum class CheckpointMode : uint8_t {
+    PASSIVE,
+    TRUNCATE
+};
+
+// 每个访问数据库的线程使用自己的命名连接, 第一次访问时按相同的参数打开并设置相同的 pragma
+// 读可以在多个线程上并发; 写之间仍需调用方串行 (RequestDispatcher 的 dbMutex), 事务只属于当前线程的连接
 class DatabaseManager
 {
 public:
@@ -18,6 +77,9 @@ public:
     ~DatabaseManager();
 
     bool createTables();
+    // 存储参数在 initializeDatabase 之前设置, 之后只影响新打开的连接
+    void setStorageProfile(const StorageProfile& profile) { storage = profile; }
+    const StorageProfile& storageProfile() const { return storage; }
     bool initializeDatabase(const QString& dbPath = "");
 
     bool isDatabaseOpen() const { return isOpen; }
@@ -26,21 +88,35 @@ public:
         const QString& dbname,
         const QString& user,
         const QString& password);
+    // 关闭数据库, 调用前其他访问数据库的线程必须已经退出, 它们的连接由各自线程退出时关闭
     void disconnectFromDatabase();
 
-    bool createUser(const User& user);
+    // userID <= 0 时由数据库分配, 分配结果写入 newUserID
+    bool createUser(const User& user, int* newUserID = nullptr);
     User getUserByID(int userID);
+    User getUserByUsername(const std::string& username);
     bool updateUser(const User& user);
     bool deleteUser(int userID);
     bool updateUserRating(int userID, int newRating); // 新增用户评级更新
 
-    bool createProduct(const Product& product);
+    bool createProduct(const Product& product, int* newProductID = nullptr);
     Product getProductByID(int productID);
+    // 按 productIDs 的顺序返回, 不存在的商品 productID 为 0; 每 50 个编号查三次 (商品, 图片, 规格)
+    std::vector<Product> getProductsByIDs(const std::vector<int>& productIDs);
     bool updateProduct(const Product& product); // 修正拼写错误：updataProduct -> updateProduct
     bool deleteProduct(int productID);
+    // 分页查询, category/keyword 为空时不过滤
+    std::vector<Product> getProductList(int page, int pageSize, const std::string& category,
+        const std::string& keyword, int* totalCount = nullptr);
+    std::vector<Product> getProductsBySeller(int sellerID, int page, int pageSize, int* totalCount = nullptr);
+    bool decreaseStock(int productID, int classID, int quantity); // 库存不足时返回false
 
-    bool createOrder(const Order& order);
+    bool createOrder(const Order& order, int* newOrderID = nullptr);
     Order getOrderById(int orderId);
+    std::vector<Order> getOrdersByUserID(int userID, int page, int pageSize, int statusFilter,
+        int* totalCount = nullptr);
+    // 某个状态的全部订单, 只填 orderID 和 createdTime; 只在启动时使用, 不缓存语句, 不计入统计
+    std::vector<Order> getOrdersByStatus(int status);
     bool updateOrderStatus(int orderId, int status);
     bool deleteOrder(int orderId);
 
@@ -48,14 +124,136 @@ public:
     bool updateCart(const Cart& cart);
     bool clearCart(int userID); // 新增清空购物车
     bool addItemToCart(int userID, const OrderItem& item); // 新增添加商品到购物车
+    bool updateCartItemQuantity(int userID, int productID, int classID, int quantity);
     bool removeItemFromCart(int userID, int productID, int classID); // 新增从购物车移除商品
 
+    // 可以嵌套: 外层是真正的事务, 内层用 SAVEPOINT, 内层回滚只撤销自己的修改
+    bool beginTransaction();
+    bool commitTransaction();
+    bool rollbackTransaction();
+    // 当前线程的连接上的事务层数
+    int transactionLevel() const;
+
+    // 在当前线程的连接上做 WAL 检查点; walPages/checkpointedPages 为 WAL 中的页数和已合并回数据库的页数
+    // 返回 false 表示出错或 TRUNCATE 没等到读写结束 (SQLITE_BUSY)
+    bool checkpoint(CheckpointMode mode, int* walPages = nullptr, int* checkpointedPages = nullptr);
+    // 当前线程的连接看到的数据版本 (PRAGMA data_version), 其他连接每次提交后都会变; 出错时返回 -1
+    qint64 dataVersion();
+    // 只修改当前线程的连接, 例如检查点线程用较短的等待, 不长时间挡住写
+    bool setBusyTimeout(int timeoutMs);
+
+    // 商品信息或规格库存被修改时在修改它的线程里同步回调; 此时所在事务可能尚未提交, 随后也可能回滚
+    using ProductListener = std::function<void(int productID)>;
+    void addProductListener(ProductListener listener) { productListeners.push_back(std::move(listener)); }
+
+    // 各操作的耗时 (含等待 SQLite 锁), 可在任意线程读取
+    const LatencyHistogram& latency(DbOperation operation) const
+    {
+        return operationLatency[static_cast<int>(operation)];
+    }
+    static const char* operationName(DbOperation operation);
+
+    // 已打开的连接数, 即访问过数据库的线程数
+    int connectionCount() const;
+
 private:
-    QSqlDatabase db;
+    // 预编译语句, 每个连接各自缓存一份; SQL 见 statementSql
+    enum class Statement : uint8_t {
+        INSERT_USER,
+        SELECT_USER,
+        SELECT_USER_ID_BY_USERNAME,
+        UPDATE_USER,
+        UPDATE_USER_RATING,
+        DELETE_CART_ITEMS,
+        DELETE_USER,
+        INSERT_PRODUCT,
+        INSERT_PRODUCT_IMAGE,
+        INSERT_PRODUCT_CLASS,
+        UPSERT_PRODUCT_CLASS,
+        SELECT_PRODUCTS_BY_IDS,
+        SELECT_IMAGES_BY_PRODUCT_IDS,
+        SELECT_CLASSES_BY_PRODUCT_IDS,
+        SELECT_PRODUCT_CLASSES,
+        UPDATE_PRODUCT,
+        DELETE_PRODUCT_IMAGES,
+        DELETE_PRODUCT_CLASSES,
+        DELETE_PRODUCT_CLASS,
+        DELETE_PRODUCT,
+        COUNT_PRODUCTS,
+        SELECT_PRODUCT_PAGE,
+        COUNT_SELLER_PRODUCTS,
+        SELECT_SELLER_PRODUCT_PAGE,
+        DECREASE_STOCK,
+        INSERT_ORDER,
+        INSERT_ORDER_ITEM,
+        SELECT_ORDER,
+        SELECT_ORDER_ITEMS,
+        UPDATE_ORDER_STATUS,
+        DELETE_ORDER_ITEMS,
+        DELETE_ORDER,
+        COUNT_USER_ORDERS,
+        SELECT_USER_ORDER_PAGE,
+        SELECT_CART,
+        INSERT_CART_ITEM,
+        SELECT_CART_ITEM_QUANTITY,
+        UPDATE_CART_ITEM_QUANTITY,
+        DELETE_CART_ITEM
+    };
+    static const int STATEMENT_COUNT = static_cast<int>(Statement::DELETE_CART_ITEM) + 1;
+
+    struct Connection {
+        QSqlDatabase db;
+        int transactionDepth = 0;
+        std::unique_ptr<QSqlQuery> statements[STATEMENT_COUNT];    // 第一次用到时编译
+        // 编译失败的语句, 按语句分开存放, 别的语句编译失败时不会覆盖调用方还在用的那条
+        std::unique_ptr<QSqlQuery> unprepared[STATEMENT_COUNT];
+    };
+
+    // 线程退出时 (thread_local 析构) 归还它在各个连接池里打开的连接, 线程 id 被复用时不会拿到别人的连接
+    struct ThreadConnections {
+        std::vector<quint64> pools;
+        ~ThreadConnections();
+    };
+
+    // 当前线程的连接, 不存在时创建并打开; 打开失败时返回的连接不可用, 查询会失败
+    Connection& connection() const;
+    const QSqlDatabase& database() const { return connection().db; }
+    // 当前线程的连接上已编译的语句, 重新绑定参数后执行, 用完由 StatementGuard finish
+    // 同一条语句在结果读完之前不能再次使用 (例如在遍历结果时递归调用同一个方法)
+    QSqlQuery& statement(Statement id) const;
+    static const char* statementSql(Statement id);
+    bool openConnection(Connection& conn, const QString& name) const;
+    // 每个连接打开后都执行一遍
+    bool configureConnection(const QSqlDatabase& conn) const;
+    // 关闭当前线程的连接并换一个新的池; 其他线程必须已经退出 (连接已随线程归还)
+    void closeConnections();
+    static void closeConnection(Connection& conn);
+    // 关闭并移除某个线程的连接, 由该线程退出时调用
+    void releaseConnection(std::thread::id thread);
+    // 登记 poolID, 线程退出时据此找到连接池; 池关闭或析构前注销
+    void registerPool();
+    void unregisterPool();
+
     bool isOpen;
+    StorageProfile storage;
     QString databasePath;
+    QString hostName;
+    QString userName;
+    QString password;
+
+    // 连接池: 线程 -> 连接. poolID 在每次重新打开时换新, 线程缓存里旧池的连接随之作废
+    mutable QMutex poolMutex;
+    mutable std::unordered_map<std::thread::id, std::unique_ptr<Connection>> connections;
+    mutable int nextConnection;
+    quint64 poolID;
+
+    std::vector<ProductListener> productListeners;
+    LatencyHistogram operationLatency[DB_OPERATION_COUNT];
 
     bool executeQuery(const QString& query);
+    // getProductByID 和 getProductsByIDs 共用, 不记录耗时, 由调用方按各自的操作统计
+    std::vector<Product> loadProducts(const std::vector<int>& productIDs);
+    void notifyProductChanged(int productID);
     bool createUserCart(int userID); // 为用户创建购物车
 };
 
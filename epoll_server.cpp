@@ -0,0 +1,788 @@
+#include "epoll_server.h"
+
+#ifdef __linux__
+
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <QDebug>
+#include <QThread>
+
+#ifdef IRONDEAL_WITH_IO_URING
+#include <liburing.h>
+#endif
+
+namespace {
+
+// 单次读取的最小可写空间
+const size_t READ_CHUNK_SIZE = 64 * 1024;
+const int MAX_EVENTS = 256;
+// 单次 sendmsg 聚合的最大段数
+const int MAX_IOVECS = 64;
+
+void setNoDelay(int fd)
+{
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+} // namespace
+
+EpollServer::EpollServer(RequestDispatcher& dispatcher, int workerCount, Mode mode)
+    : dispatcher(dispatcher)
+    , mode(mode)
+    , workerCount(workerCount > 0 ? workerCount : qMax(1, QThread::idealThreadCount()))
+    , running(false)
+    , nextConnectionID(1)
+    , highWaterMark(DEFAULT_WRITE_HIGH_WATER_MARK)
+    , lowWaterMark(DEFAULT_WRITE_LOW_WATER_MARK)
+    , idleTimeout(DEFAULT_IDLE_TIMEOUT_MS)
+{
+    if (mode == Mode::IO_URING && !ioUringAvailable()) {
+        qDebug() << "io_uring support not compiled in, falling back to epoll";
+        this->mode = Mode::EPOLL;
+    }
+}
+
+EpollServer::~EpollServer()
+{
+    stop();
+}
+
+void EpollServer::setWriteWaterMarks(size_t high, size_t low)
+{
+    highWaterMark = high;
+    lowWaterMark = low;
+}
+
+void EpollServer::setIdleTimeout(int timeoutMs)
+{
+    idleTimeout = timeoutMs;
+}
+
+bool EpollServer::ioUringAvailable()
+{
+#ifdef IRONDEAL_WITH_IO_URING
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool EpollServer::start(const QHostAddress& address, quint16 port)
+{
+    if (running.load())
+        return true;
+
+    for (int i = 0; i < workerCount; ++i) {
+        auto reactor = std::make_unique<Reactor>();
+        if (!openReactor(*reactor, address, port)) {
+            closeReactor(*reactor);
+            for (auto& opened : reactors) {
+                closeReactor(*opened);
+            }
+            reactors.clear();
+            return false;
+        }
+        reactors.push_back(std::move(reactor));
+    }
+
+    running.store(true);
+    for (auto& reactor : reactors) {
+        Reactor* r = reactor.get();
+#ifdef IRONDEAL_WITH_IO_URING
+        if (mode == Mode::IO_URING) {
+            r->thread = std::thread([this, r]() { runIoUring(*r); });
+            continue;
+        }
+#endif
+        r->thread = std::thread([this, r]() { runEpoll(*r); });
+    }
+
+    qDebug() << "Server listening on port" << port << "with" << workerCount << name() << "reactors";
+    return true;
+}
+
+void EpollServer::stop()
+{
+    if (!running.exchange(false))
+        return;
+
+    for (auto& reactor : reactors) {
+        const uint64_t one = 1;
+        if (write(reactor->wakeFd, &one, sizeof(one)) < 0) {
+            qDebug() << "Failed to wake reactor: " << strerror(errno);
+        }
+    }
+    for (auto& reactor : reactors) {
+        if (reactor->thread.joinable())
+            reactor->thread.join();
+        closeReactor(*reactor);
+    }
+    reactors.clear();
+}
+
+bool EpollServer::openReactor(Reactor& reactor, const QHostAddress& address, quint16 port)
+{
+    reactor.listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (reactor.listenFd < 0) {
+        qDebug() << "socket() failed: " << strerror(errno);
+        return false;
+    }
+
+    // 每个线程各自监听同一端口, 由内核做负载均衡
+    int one = 1;
+    setsockopt(reactor.listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    setsockopt(reactor.listenFd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+
+    // 目前只支持 IPv4, 非 IPv4 地址按 INADDR_ANY 处理
+    bool isIPv4 = false;
+    const quint32 ip = address.toIPv4Address(&isIPv4);
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = isIPv4 ? htonl(ip) : htonl(INADDR_ANY);
+
+    if (bind(reactor.listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        qDebug() << "bind() failed: " << strerror(errno);
+        return false;
+    }
+    if (listen(reactor.listenFd, SOMAXCONN) < 0) {
+        qDebug() << "listen() failed: " << strerror(errno);
+        return false;
+    }
+
+    reactor.wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (reactor.wakeFd < 0) {
+        qDebug() << "eventfd() failed: " << strerror(errno);
+        return false;
+    }
+
+    if (mode == Mode::IO_URING)
+        return true;
+
+    reactor.epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (reactor.epollFd < 0) {
+        qDebug() << "epoll_create1() failed: " << strerror(errno);
+        return false;
+    }
+
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.fd = reactor.listenFd;
+    epoll_ctl(reactor.epollFd, EPOLL_CTL_ADD, reactor.listenFd, &ev);
+
+    ev.events = EPOLLIN;
+    ev.data.fd = reactor.wakeFd;
+    epoll_ctl(reactor.epollFd, EPOLL_CTL_ADD, reactor.wakeFd, &ev);
+    return true;
+}
+
+void EpollServer::closeReactor(Reactor& reactor)
+{
+    for (auto& connection : reactor.connections) {
+        if (connection) {
+            dispatcher.closeSession(connection->session);
+            close(connection->fd);
+            connection.reset();
+        }
+    }
+    reactor.connections.clear();
+    reactor.retired.clear();
+
+    for (int* fd : { &reactor.listenFd, &reactor.epollFd, &reactor.wakeFd }) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+void EpollServer::runEpoll(Reactor& reactor)
+{
+    epoll_event events[MAX_EVENTS];
+
+    while (running.load(std::memory_order_relaxed)) {
+        const int n = epoll_wait(reactor.epollFd, events, MAX_EVENTS, reactor.timers.nextTimeout());
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            qDebug() << "epoll_wait() failed: " << strerror(errno);
+            break;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            const int fd = events[i].data.fd;
+            const uint32_t flags = events[i].events;
+
+            if (fd == reactor.listenFd) {
+                acceptAll(reactor);
+                continue;
+            }
+            if (fd == reactor.wakeFd) {
+                uint64_t value = 0;
+                if (read(reactor.wakeFd, &value, sizeof(value)) < 0 && errno != EAGAIN)
+                    qDebug() << "Failed to read wake event: " << strerror(errno);
+                if (!running.load())
+                    return;
+                deliverPushes(reactor);
+                continue;
+            }
+
+            if (fd < 0 || static_cast<size_t>(fd) >= reactor.connections.size() || !reactor.connections[fd])
+                continue;
+            Connection& connection = *reactor.connections[fd];
+
+            // 边缘触发: 读到 EAGAIN 为止, 再把积攒的响应一次写出; EPOLLOUT 也走同一路径
+            bool alive = (flags & EPOLLERR) == 0;
+            if (alive && (flags & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) && !connection.closing && !connection.readPaused
+                && !connection.session.write_pending)
+                alive = readConnection(connection);
+            if (alive && !connection.out.isEmpty())
+                alive = flushConnection(connection);
+
+            // 积压降到低水位后恢复读取; 边缘触发不会再通知已在内核缓冲区中的数据, 需要主动读一次
+            if (alive && connection.readPaused && connection.out.belowLowWater()) {
+                connection.readPaused = false;
+                alive = readConnection(connection);
+                if (alive && !connection.out.isEmpty())
+                    alive = flushConnection(connection);
+            }
+
+            if (!alive || (connection.closing && connection.out.isEmpty()))
+                closeConnection(reactor, fd);
+        }
+
+        reactor.timers.advance();
+    }
+}
+
+void EpollServer::acceptAll(Reactor& reactor)
+{
+    for (;;) {
+        const int fd = accept4(reactor.listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                qDebug() << "accept4() failed: " << strerror(errno);
+            return;
+        }
+
+        setNoDelay(fd);
+
+        if (static_cast<size_t>(fd) >= reactor.connections.size())
+            reactor.connections.resize(static_cast<size_t>(fd) + 1);
+
+        auto connection = std::make_unique<Connection>();
+        initConnection(reactor, *connection, fd);
+
+        epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.fd = fd;
+        if (epoll_ctl(reactor.epollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            qDebug() << "epoll_ctl() failed: " << strerror(errno);
+            close(fd);
+            continue;
+        }
+        armIdleTimer(reactor, *connection, idleTimeout);
+        reactor.connections[fd] = std::move(connection);
+    }
+}
+
+bool EpollServer::readConnection(Connection& connection)
+{
+    for (;;) {
+        // 先处理解码缓冲区中已有的请求; 写请求交给提交线程后暂停, 剩下的请求和内核中的数据等它完成再处理
+        FrameView frame;
+        FrameDecoder::Status status = FrameDecoder::Status::NEED_MORE;
+        while (!connection.session.write_pending
+            && (status = connection.decoder.next(frame)) == FrameDecoder::Status::FRAME_READY) {
+            dispatcher.dispatch(frame, connection.session, connection.out.tail());
+        }
+        if (status == FrameDecoder::Status::BAD_HEADER) {
+            connection.out.tail().append(ProtocolHelper::createErrorResponse(ErrorCode::INVALID_REQUEST,
+                "协议头非法", 0, connection.session.codec));
+            connection.closing = true;
+            return true;
+        }
+        if (connection.session.write_pending)
+            return true;
+
+        // 客户端收得慢: 先尽量写出, 仍然积压就不再读它的请求, 让 TCP 窗口把压力传回客户端
+        if (connection.out.aboveHighWater()) {
+            if (!flushConnection(connection))
+                return false;
+            if (connection.out.aboveHighWater()) {
+                connection.readPaused = true;
+                return true;
+            }
+        }
+
+        char* buffer = connection.decoder.prepareWrite(READ_CHUNK_SIZE);
+        const ssize_t n = recv(connection.fd, buffer, connection.decoder.writableBytes(), 0);
+        if (n == 0)
+            return false;   // 对端关闭
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        connection.decoder.commitWrite(static_cast<size_t>(n));
+        connection.lastActive = connection.session.timers->now();
+        connection.session.received_at = connection.lastActive;
+    }
+}
+
+bool EpollServer::flushConnection(Connection& connection)
+{
+    iovec iov[MAX_IOVECS];
+    while (!connection.out.isEmpty()) {
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = static_cast<size_t>(connection.out.gather(iov, MAX_IOVECS));
+
+        const ssize_t n = sendmsg(connection.fd, &msg, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            // 内核发送缓冲区满, 等下一次 EPOLLOUT
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        connection.out.consume(static_cast<size_t>(n));
+    }
+    return true;
+}
+
+void EpollServer::initConnection(Reactor& reactor, Connection& connection, int fd)
+{
+    connection.fd = fd;
+    connection.session.connection_id = nextConnectionID.fetch_add(1, std::memory_order_relaxed);
+    connection.session.timers = &reactor.timers;
+    connection.session.push = &connection.pushTarget;
+    connection.pushTarget.reactor = &reactor;
+    connection.pushTarget.fd = fd;
+    connection.pushTarget.connectionID = connection.session.connection_id;
+    connection.out.setWaterMarks(highWaterMark, lowWaterMark);
+    connection.lastActive = reactor.timers.now();
+}
+
+void EpollServer::ConnectionPush::push(const QByteArray& message)
+{
+    post(message, false);
+}
+
+void EpollServer::ConnectionPush::completeWrite(const QByteArray& response)
+{
+    post(response, true);
+}
+
+void EpollServer::ConnectionPush::post(const QByteArray& message, bool writeDone)
+{
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> locker(reactor->mailboxMutex);
+        // 信箱非空说明已经唤醒过, reactor 会一次取走全部
+        wake = reactor->mailbox.empty();
+        reactor->mailbox.push_back(PushMessage{ fd, connectionID, message, writeDone });
+    }
+    const uint64_t one = 1;
+    if (wake && write(reactor->wakeFd, &one, sizeof(one)) < 0)
+        qDebug() << "Failed to wake reactor: " << strerror(errno);
+}
+
+void EpollServer::deliverPushes(Reactor& reactor)
+{
+    std::vector<PushMessage> messages;
+    {
+        std::lock_guard<std::mutex> locker(reactor.mailboxMutex);
+        messages.swap(reactor.mailbox);
+    }
+
+    // 先全部追加, 每个连接只写一次
+    std::vector<int> touched;
+    for (PushMessage& message : messages) {
+        if (message.writeDone) {
+            finishWrite(reactor, message);
+            continue;
+        }
+        const int fd = message.fd;
+        if (static_cast<size_t>(fd) >= reactor.connections.size() || !reactor.connections[fd])
+            continue;
+        Connection& connection = *reactor.connections[fd];
+        if (connection.session.connection_id != message.connectionID || connection.closing)
+            continue;
+        if (connection.out.aboveHighWater()) {
+            qDebug() << "Closing slow subscriber" << connection.session.connection_id;
+            closeConnection(reactor, fd);
+            continue;
+        }
+        if (connection.out.isEmpty())
+            touched.push_back(fd);
+        connection.out.tail().append(message.message);
+    }
+    for (int fd : touched) {
+        // 后面的推送可能已经把它断开
+        if (reactor.connections[fd] && !flushConnection(*reactor.connections[fd]))
+            closeConnection(reactor, fd);
+    }
+}
+
+void EpollServer::finishWrite(Reactor& reactor, const PushMessage& message)
+{
+    // 连接已经关闭, 会话只等这个写请求完成
+    auto retired = reactor.retired.find(message.connectionID);
+    if (retired != reactor.retired.end()) {
+        dispatcher.finishWrite(retired->second->session);
+        reactor.retired.erase(retired);
+        return;
+    }
+
+    const int fd = message.fd;
+    if (static_cast<size_t>(fd) >= reactor.connections.size() || !reactor.connections[fd])
+        return;
+    Connection& connection = *reactor.connections[fd];
+    if (connection.session.connection_id != message.connectionID)
+        return;
+    dispatcher.finishWrite(connection.session);
+    connection.out.tail().append(message.message);
+
+    // 暂停期间到达的数据没有读, 边缘触发不会再通知, 这里接着读
+    bool alive = true;
+    if (!connection.closing && !connection.readPaused)
+        alive = readConnection(connection);
+    if (alive && !connection.out.isEmpty())
+        alive = flushConnection(connection);
+    if (!alive || (connection.closing && connection.out.isEmpty()))
+        closeConnection(reactor, fd);
+}
+
+void EpollServer::closeConnection(Reactor& reactor, int fd)
+{
+    Connection& connection = *reactor.connections[fd];
+    dispatcher.closeSession(connection.session);
+    reactor.timers.cancel(connection.idleTimer);
+    epoll_ctl(reactor.epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    // 写请求还在提交线程上, 会话留到它的响应送回
+    if (connection.session.write_pending)
+        reactor.retired[connection.session.connection_id] = std::move(reactor.connections[fd]);
+    else
+        reactor.connections[fd].reset();
+}
+
+void EpollServer::armIdleTimer(Reactor& reactor, Connection& connection, qint64 delayMs)
+{
+    if (idleTimeout <= 0)
+        return;
+    const int fd = connection.fd;
+    connection.idleTimer = reactor.timers.schedule(delayMs, [this, &reactor, fd]() {
+        onIdleTimer(reactor, fd);
+    });
+}
+
+void EpollServer::onIdleTimer(Reactor& reactor, int fd)
+{
+    // 连接关闭时会取消定时器, 触发时连接一定还在
+    Connection& connection = *reactor.connections[fd];
+    connection.idleTimer = 0;
+
+    // 收到数据时只记录时间, 不重排定时器; 到期时再按最近活动时间决定断开还是顺延
+    const qint64 idle = reactor.timers.now() - connection.lastActive;
+    if (idle < idleTimeout) {
+        armIdleTimer(reactor, connection, idleTimeout - idle);
+        return;
+    }
+    qDebug() << "Closing idle connection" << connection.session.connection_id;
+    closeConnection(reactor, fd);
+}
+
+#ifdef IRONDEAL_WITH_IO_URING
+
+namespace {
+
+// user_data 低 3 位是操作类型, 其余位是 Connection 指针 (8 字节对齐)
+enum UringOp : uint64_t {
+    URING_ACCEPT = 1,
+    URING_RECV = 2,
+    URING_SEND = 3,
+    URING_WAKE = 4
+};
+
+const uint64_t URING_OP_MASK = 0x7;
+
+io_uring_sqe* acquireSqe(io_uring* ring)
+{
+    io_uring_sqe* sqe = io_uring_get_sqe(ring);
+    if (!sqe) {
+        io_uring_submit(ring);
+        sqe = io_uring_get_sqe(ring);
+    }
+    return sqe;
+}
+
+} // namespace
+
+void EpollServer::runIoUring(Reactor& reactor)
+{
+    // io_uring 模式下每个连接额外需要: 在途 sendmsg 的参数和未完成操作标记
+    struct UringConnection : Connection {
+        msghdr sendMsg;
+        iovec sendIov[MAX_IOVECS];
+        bool recvPending = false;
+        bool sendPending = false;
+        bool retired = false;   // 会话已关闭、定时器已取消、已 shutdown, 等在途操作返回后 close
+    };
+    std::vector<std::unique_ptr<UringConnection>> connections;
+    // 已关闭但写请求还在提交线程上的连接, 以 connection_id 为键, 收到它的响应后释放
+    std::unordered_map<quint64, std::unique_ptr<UringConnection>> finishing;
+
+    io_uring ring;
+    const int ret = io_uring_queue_init(4096, &ring, 0);
+    if (ret < 0) {
+        qDebug() << "io_uring_queue_init() failed: " << strerror(-ret);
+        return;
+    }
+
+    uint64_t wakeValue = 0;
+    auto submitWake = [&]() {
+        io_uring_sqe* sqe = acquireSqe(&ring);
+        io_uring_prep_read(sqe, reactor.wakeFd, &wakeValue, sizeof(wakeValue), 0);
+        io_uring_sqe_set_data64(sqe, URING_WAKE);
+    };
+    auto submitAccept = [&]() {
+        io_uring_sqe* sqe = acquireSqe(&ring);
+        io_uring_prep_accept(sqe, reactor.listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        io_uring_sqe_set_data64(sqe, URING_ACCEPT);
+    };
+    auto submitRecv = [&](UringConnection& c) {
+        char* buffer = c.decoder.prepareWrite(READ_CHUNK_SIZE);
+        io_uring_sqe* sqe = acquireSqe(&ring);
+        io_uring_prep_recv(sqe, c.fd, buffer, c.decoder.writableBytes(), 0);
+        io_uring_sqe_set_data64(sqe, reinterpret_cast<uint64_t>(&c) | URING_RECV);
+        c.recvPending = true;
+    };
+    auto submitSend = [&](UringConnection& c) {
+        // gather 之后这些块不再被追加, 新响应写入新块, 不影响内核正在读的内存
+        if (c.sendPending || c.out.isEmpty())
+            return;
+        memset(&c.sendMsg, 0, sizeof(c.sendMsg));
+        c.sendMsg.msg_iov = c.sendIov;
+        c.sendMsg.msg_iovlen = static_cast<size_t>(c.out.gather(c.sendIov, MAX_IOVECS));
+        io_uring_sqe* sqe = acquireSqe(&ring);
+        io_uring_prep_sendmsg(sqe, c.fd, &c.sendMsg, MSG_NOSIGNAL);
+        io_uring_sqe_set_data64(sqe, reinterpret_cast<uint64_t>(&c) | URING_SEND);
+        c.sendPending = true;
+    };
+    // 关闭时先 shutdown 让未完成的操作尽快返回, 全部返回后才真正 close, 防止 fd 被复用
+    // closing 只表示发完剩余数据后关闭, 是否已做过清理看 retired
+    auto retire = [&](UringConnection& c) {
+        if (!c.retired) {
+            c.retired = true;
+            c.closing = true;
+            dispatcher.closeSession(c.session);
+            reactor.timers.cancel(c.idleTimer);
+            shutdown(c.fd, SHUT_RDWR);
+        }
+        if (!c.recvPending && !c.sendPending) {
+            const int fd = c.fd;
+            close(fd);
+            if (c.session.write_pending)
+                finishing[c.session.connection_id] = std::move(connections[fd]);
+            else
+                connections[fd].reset();
+        }
+    };
+    // 处理解码缓冲区中的请求并发出响应; 写请求交给提交线程后暂停, 不再投递 recv, 等它的响应送回再继续
+    auto processFrames = [&](UringConnection& c) {
+        FrameView frame;
+        FrameDecoder::Status status = FrameDecoder::Status::NEED_MORE;
+        while (!c.session.write_pending && (status = c.decoder.next(frame)) == FrameDecoder::Status::FRAME_READY) {
+            dispatcher.dispatch(frame, c.session, c.out.tail());
+        }
+        if (status == FrameDecoder::Status::BAD_HEADER) {
+            c.out.tail().append(ProtocolHelper::createErrorResponse(ErrorCode::INVALID_REQUEST,
+                "协议头非法", 0, c.session.codec));
+            submitSend(c);
+            c.closing = true;
+            return;
+        }
+        submitSend(c);
+        if (c.session.write_pending)
+            return;
+        // 积压超过高水位时不再投递 recv, 等发送完成后再恢复
+        if (c.out.aboveHighWater())
+            c.readPaused = true;
+        else if (!c.readPaused)
+            submitRecv(c);
+    };
+
+    // 空闲检测, 规则同 onIdleTimer
+    std::function<void(UringConnection&, qint64)> armIdle = [&](UringConnection& c, qint64 delayMs) {
+        if (idleTimeout <= 0)
+            return;
+        UringConnection* connection = &c;
+        c.idleTimer = reactor.timers.schedule(delayMs, [&, connection]() {
+            connection->idleTimer = 0;
+            const qint64 idle = reactor.timers.now() - connection->lastActive;
+            if (idle < idleTimeout) {
+                armIdle(*connection, idleTimeout - idle);
+                return;
+            }
+            qDebug() << "Closing idle connection" << connection->session.connection_id;
+            retire(*connection);
+        });
+    };
+
+    submitWake();
+    submitAccept();
+
+    bool stopping = false;
+    while (!stopping) {
+        const int timeout = reactor.timers.nextTimeout();
+        if (timeout < 0) {
+            io_uring_submit_and_wait(&ring, 1);
+        }
+        else {
+            __kernel_timespec ts;
+            ts.tv_sec = timeout / 1000;
+            ts.tv_nsec = (timeout % 1000) * 1000000LL;
+            io_uring_cqe* ready = nullptr;
+            io_uring_submit_and_wait_timeout(&ring, &ready, 1, &ts, nullptr);
+        }
+
+        io_uring_cqe* cqe = nullptr;
+        unsigned head = 0;
+        unsigned handled = 0;
+        io_uring_for_each_cqe(&ring, head, cqe) {
+            ++handled;
+            const uint64_t data = io_uring_cqe_get_data64(cqe);
+            const uint64_t op = data & URING_OP_MASK;
+            const int res = cqe->res;
+
+            if (op == URING_WAKE) {
+                if (!running.load()) {
+                    stopping = true;
+                    continue;
+                }
+                std::vector<PushMessage> messages;
+                {
+                    std::lock_guard<std::mutex> locker(reactor.mailboxMutex);
+                    messages.swap(reactor.mailbox);
+                }
+                for (PushMessage& message : messages) {
+                    if (message.writeDone) {
+                        auto retired = finishing.find(message.connectionID);
+                        if (retired != finishing.end()) {
+                            dispatcher.finishWrite(retired->second->session);
+                            finishing.erase(retired);
+                            continue;
+                        }
+                    }
+                    const int fd = message.fd;
+                    if (static_cast<size_t>(fd) >= connections.size() || !connections[fd])
+                        continue;
+                    UringConnection& c = *connections[fd];
+                    if (c.session.connection_id != message.connectionID)
+                        continue;
+                    if (message.writeDone) {
+                        dispatcher.finishWrite(c.session);
+                        if (!c.closing) {
+                            c.out.tail().append(message.message);
+                            processFrames(c);
+                        }
+                        continue;
+                    }
+                    if (c.closing)
+                        continue;
+                    if (c.out.aboveHighWater()) {
+                        qDebug() << "Closing slow subscriber" << c.session.connection_id;
+                        retire(c);
+                        continue;
+                    }
+                    c.out.tail().append(message.message);
+                    submitSend(c);
+                }
+                submitWake();
+                continue;
+            }
+
+            if (op == URING_ACCEPT) {
+                if (res >= 0) {
+                    setNoDelay(res);
+                    if (static_cast<size_t>(res) >= connections.size())
+                        connections.resize(static_cast<size_t>(res) + 1);
+                    auto connection = std::make_unique<UringConnection>();
+                    initConnection(reactor, *connection, res);
+                    armIdle(*connection, idleTimeout);
+                    submitRecv(*connection);
+                    connections[res] = std::move(connection);
+                }
+                else if (res != -EAGAIN && res != -EINTR) {
+                    qDebug() << "io_uring accept failed: " << strerror(-res);
+                }
+                submitAccept();
+                continue;
+            }
+
+            auto* c = reinterpret_cast<UringConnection*>(data & ~URING_OP_MASK);
+            if (op == URING_RECV) {
+                c->recvPending = false;
+                if (res <= 0 || c->closing) {
+                    retire(*c);
+                    continue;
+                }
+                c->decoder.commitWrite(static_cast<size_t>(res));
+                c->lastActive = reactor.timers.now();
+                c->session.received_at = c->lastActive;
+                processFrames(*c);
+            }
+            else if (op == URING_SEND) {
+                c->sendPending = false;
+                if (res < 0) {
+                    retire(*c);
+                    continue;
+                }
+                c->out.consume(static_cast<size_t>(res));
+                if (c->closing && c->out.isEmpty()) {
+                    retire(*c);
+                    continue;
+                }
+                if (c->readPaused && !c->closing && c->out.belowLowWater()) {
+                    c->readPaused = false;
+                    if (!c->session.write_pending)
+                        submitRecv(*c);
+                }
+                submitSend(*c);
+            }
+        }
+        io_uring_cq_advance(&ring, handled);
+        reactor.timers.advance();
+    }
+
+    for (auto& connection : connections) {
+        if (connection) {
+            if (!connection->retired)
+                dispatcher.closeSession(connection->session);
+            close(connection->fd);
+        }
+    }
+    io_uring_queue_exit(&ring);
+}
+
+#endif // IRONDEAL_WITH_IO_URING
+
+#endif // __linux__
@@ -0,0 +1,125 @@
+#ifndef EPOLL_SERVER_H
+#define EPOLL_SERVER_H
+
+#ifdef __linux__
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <QByteArray>
+#include "frame_decoder.h"
+#include "outbound_queue.h"
+#include "request_dispatcher.h"
+#include "timer_wheel.h"
+#include "transport.h"
+
+// Linux 原生网络后端, 不经过 Qt 事件循环和信号槽
+// 每个线程一个 epoll 实例 (边缘触发) 和一个 SO_REUSEPORT 监听 socket, 由内核在线程间分配连接;
+// 编译时启用 IRONDEAL_WITH_IO_URING 后可切换为 io_uring 模式
+class EpollServer : public Transport
+{
+public:
+    enum class Mode {
+        EPOLL,
+        IO_URING
+    };
+
+    // workerCount <= 0 时取 CPU 核数
+    explicit EpollServer(RequestDispatcher& dispatcher, int workerCount = 0, Mode mode = Mode::EPOLL);
+    ~EpollServer() override;
+
+    bool start(const QHostAddress& address, quint16 port) override;
+    void stop() override;
+    const char* name() const override { return mode == Mode::IO_URING ? "io_uring" : "epoll"; }
+    void setWriteWaterMarks(size_t high, size_t low) override;
+    void setIdleTimeout(int timeoutMs) override;
+
+    // 当前构建是否支持 io_uring
+    static bool ioUringAvailable();
+
+private:
+    struct Reactor;
+
+    // 连接的推送出口: 消息放进所属 reactor 的信箱, 由 reactor 线程写出
+    struct ConnectionPush : PushTarget {
+        Reactor* reactor = nullptr;
+        int fd = -1;
+        quint64 connectionID = 0;  // fd 会被复用, 投递时核对
+
+        void push(const QByteArray& message) override;
+        void completeWrite(const QByteArray& response) override;
+
+    private:
+        void post(const QByteArray& message, bool writeDone);
+    };
+
+    // 单个连接, 只由所属线程访问
+    struct Connection {
+        int fd = -1;
+        FrameDecoder decoder;
+        Session session;
+        OutboundQueue out;      // 待发送数据
+        bool readPaused = false;// 发送积压超过高水位, 暂停读取
+        bool closing = false;   // 发送完剩余数据后关闭
+        qint64 lastActive = 0;  // 最近一次收到数据的时间 (时间轮时钟)
+        TimerWheel::TimerId idleTimer = 0;
+        ConnectionPush pushTarget;
+    };
+
+    // 其他线程投递给连接的推送消息
+    struct PushMessage {
+        int fd;
+        quint64 connectionID;
+        QByteArray message;
+        bool writeDone;         // 交给提交线程的写请求的响应, 之后继续处理该连接暂停的请求
+    };
+
+    // 单个 reactor 线程
+    struct Reactor {
+        int listenFd = -1;
+        int epollFd = -1;
+        int wakeFd = -1;        // eventfd, 用于通知线程退出和有新的推送消息
+        std::thread thread;
+        std::vector<std::unique_ptr<Connection>> connections; // 以 fd 为下标
+        TimerWheel timers;      // 空闲检测和订单超时等定时任务
+        std::mutex mailboxMutex;
+        std::vector<PushMessage> mailbox;
+        // 已关闭但写请求还在提交线程上的连接, 以 connection_id 为键, 收到它的响应后释放
+        std::unordered_map<quint64, std::unique_ptr<Connection>> retired;
+    };
+
+    bool openReactor(Reactor& reactor, const QHostAddress& address, quint16 port);
+    void closeReactor(Reactor& reactor);
+
+    void runEpoll(Reactor& reactor);
+    void acceptAll(Reactor& reactor);
+    bool readConnection(Connection& connection);
+    bool flushConnection(Connection& connection);
+    void closeConnection(Reactor& reactor, int fd);
+    void initConnection(Reactor& reactor, Connection& connection, int fd);
+    void deliverPushes(Reactor& reactor);
+    void finishWrite(Reactor& reactor, const PushMessage& message);
+    void armIdleTimer(Reactor& reactor, Connection& connection, qint64 delayMs);
+    void onIdleTimer(Reactor& reactor, int fd);
+
+#ifdef IRONDEAL_WITH_IO_URING
+    void runIoUring(Reactor& reactor);
+#endif
+
+    RequestDispatcher& dispatcher;
+    Mode mode;
+    int workerCount;
+    std::vector<std::unique_ptr<Reactor>> reactors;
+    std::atomic<bool> running;
+    std::atomic<quint64> nextConnectionID;
+    size_t highWaterMark;
+    size_t lowWaterMark;
+    int idleTimeout;
+};
+
+#endif // __linux__
+
+#endif // EPOLL_SERVER_H
@@ -0,0 +1,118 @@
+#include "frame_decoder.h"
+#include <cstring>
+
+FrameDecoder::FrameDecoder(uint32_t maxBodyLength, size_t initialCapacity)
+    : buffer(initialCapacity < PROTOCOL_HEADER_SIZE ? PROTOCOL_HEADER_SIZE : initialCapacity)
+    , readPos(0)
+    , writePos(0)
+    , pendingFrameSize(0)
+    , maxBodyLen(maxBodyLength)
+    , lastError(FrameError::NONE)
+{
+}
+
+void FrameDecoder::ensureWritable(size_t minSize)
+{
+    // 已知下一帧长度时一次预留整帧, 避免大包分多次扩容
+    size_t needed = minSize;
+    if (pendingFrameSize > bufferedBytes() && pendingFrameSize - bufferedBytes() > needed) {
+        needed = pendingFrameSize - bufferedBytes();
+    }
+
+    if (buffer.size() - writePos >= needed)
+        return;
+
+    // 先把未消费的数据搬到头部
+    if (readPos > 0) {
+        const size_t pending = bufferedBytes();
+        if (pending > 0) {
+            memmove(buffer.data(), buffer.data() + readPos, pending);
+        }
+        readPos = 0;
+        writePos = pending;
+    }
+
+    // 仍然不够才扩容, 缓冲区只增不减
+    if (buffer.size() - writePos < needed) {
+        size_t newSize = buffer.size() * 2;
+        while (newSize - writePos < needed) {
+            newSize *= 2;
+        }
+        buffer.resize(newSize);
+    }
+}
+
+char *FrameDecoder::prepareWrite(size_t minSize)
+{
+    ensureWritable(minSize == 0 ? 1 : minSize);
+    return buffer.data() + writePos;
+}
+
+void FrameDecoder::commitWrite(size_t size)
+{
+    writePos += size;
+    if (writePos > buffer.size()) {
+        writePos = buffer.size();
+    }
+}
+
+void FrameDecoder::append(const char *data, size_t size)
+{
+    if (size == 0)
+        return;
+    memcpy(prepareWrite(size), data, size);
+    commitWrite(size);
+}
+
+FrameDecoder::Status FrameDecoder::next(FrameView &frame)
+{
+    if (lastError != FrameError::NONE)
+        return Status::BAD_HEADER;
+
+    // 上一帧已全部消费时直接归零, 省掉后续的搬移
+    if (readPos == writePos) {
+        readPos = 0;
+        writePos = 0;
+        return Status::NEED_MORE;
+    }
+
+    const size_t available = bufferedBytes();
+    if (available < PROTOCOL_HEADER_SIZE)
+        return Status::NEED_MORE;
+
+    const char *start = buffer.data() + readPos;
+    ProtocolHelper::decodeHeader(start, frame.header);
+
+    if (frame.header.magic != PROTOCOL_MAGIC) {
+        lastError = FrameError::BAD_MAGIC;
+        return Status::BAD_HEADER;
+    }
+    if (!ProtocolHelper::isSupportedVersion(frame.header.version)) {
+        lastError = FrameError::BAD_VERSION;
+        return Status::BAD_HEADER;
+    }
+    if (frame.header.body_length > maxBodyLen) {
+        lastError = FrameError::BODY_TOO_LARGE;
+        return Status::BAD_HEADER;
+    }
+
+    const size_t frameSize = PROTOCOL_HEADER_SIZE + frame.header.body_length;
+    if (available < frameSize) {
+        pendingFrameSize = frameSize;
+        return Status::NEED_MORE;
+    }
+
+    frame.body = start + PROTOCOL_HEADER_SIZE;
+    frame.body_length = frame.header.body_length;
+    readPos += frameSize;
+    pendingFrameSize = 0;
+    return Status::FRAME_READY;
+}
+
+void FrameDecoder::reset()
+{
+    readPos = 0;
+    writePos = 0;
+    pendingFrameSize = 0;
+    lastError = FrameError::NONE;
+}
@@ -0,0 +1,76 @@
+#ifndef FRAME_DECODER_H
+#define FRAME_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "com_protocol.h"
+
+// 解码出的一帧
+// body 直接指向解码器内部缓冲区, 在下一次调用 next/prepareWrite/append 之前有效
+struct FrameView {
+    ProtocolHeader header;
+    const char *body;
+    uint32_t body_length;
+
+    MessageType type() const { return static_cast<MessageType>(header.type); }
+
+    // 不拷贝数据的 QByteArray 视图, 生命周期同 body
+    QByteArray bodyBytes() const { return QByteArray::fromRawData(body, static_cast<qsizetype>(body_length)); }
+};
+
+// 帧校验失败的原因
+enum class FrameError : uint8_t {
+    NONE = 0,
+    BAD_MAGIC,
+    BAD_VERSION,
+    BODY_TOO_LARGE
+};
+
+// 每个连接一个的增量帧解码器
+// 内部是一块只增不减的缓冲区, 读指针追上写指针时归零, 空间不足时把未消费的数据搬到头部,
+// 因此稳态下 (缓冲区已能容纳最大帧后) 不再分配内存, 也不为每条消息拷贝出新的 QByteArray
+class FrameDecoder
+{
+public:
+    enum class Status {
+        NEED_MORE,      // 数据不足一帧
+        FRAME_READY,    // 已输出一帧
+        BAD_HEADER      // 协议头非法, 连接应被关闭
+    };
+
+    explicit FrameDecoder(uint32_t maxBodyLength = DEFAULT_MAX_BODY_LENGTH,
+        size_t initialCapacity = 16 * 1024);
+
+    void setMaxBodyLength(uint32_t length) { maxBodyLen = length; }
+    uint32_t maxBodyLength() const { return maxBodyLen; }
+
+    // 零拷贝写入: 取得至少 minSize 字节的可写区域, 直接交给 socket 读取, 然后 commitWrite 实际写入量
+    char *prepareWrite(size_t minSize);
+    void commitWrite(size_t size);
+
+    // 拷贝写入, 供无法直接读入缓冲区的调用方使用
+    void append(const char *data, size_t size);
+
+    // 取下一帧, 返回 FRAME_READY 时 frame 有效
+    Status next(FrameView &frame);
+
+    FrameError error() const { return lastError; }
+    size_t bufferedBytes() const { return writePos - readPos; }
+    size_t capacity() const { return buffer.size(); }
+    size_t writableBytes() const { return buffer.size() - writePos; }
+
+    void reset();
+
+private:
+    void ensureWritable(size_t minSize);
+
+    std::vector<char> buffer;
+    size_t readPos;
+    size_t writePos;
+    size_t pendingFrameSize;    // 已解析出头部的未完整帧总长度, 0 表示未知
+    uint32_t maxBodyLen;
+    FrameError lastError;
+};
+
+#endif // FRAME_DECODER_H
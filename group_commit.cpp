@@ -0,0 +1,146 @@
+#include "group_commit.h"
+
+GroupCommit::GroupCommit(DatabaseManager& db, QRecursiveMutex& writeLock)
+    : db(db)
+    , writeLock(writeLock)
+    , window(0)
+    , maxWrites(DEFAULT_GROUP_COMMIT_MAX_WRITES)
+    , stopping(false)
+{
+}
+
+GroupCommit::~GroupCommit()
+{
+    stop();
+}
+
+void GroupCommit::setWindow(int windowMicros, int maxWrites)
+{
+    window = std::chrono::microseconds(windowMicros > 0 ? windowMicros : 0);
+    this->maxWrites = maxWrites > 0 ? maxWrites : 1;
+    if (enabled() && !thread.joinable()) {
+        stopping = false;
+        thread = std::thread([this]() { run(); });
+    }
+}
+
+void GroupCommit::stop()
+{
+    {
+        std::lock_guard<std::mutex> locker(mutex);
+        stopping = true;
+    }
+    queued.notify_all();
+    if (thread.joinable())
+        thread.join();
+}
+
+bool GroupCommit::post(Work work, Done done, bool urgent)
+{
+    Job job;
+    job.work = std::move(work);
+    job.done = std::move(done);
+    job.urgent = urgent;
+    {
+        std::lock_guard<std::mutex> locker(mutex);
+        if (stopping)
+            return false;
+        if (urgent)
+            queue.push_front(std::move(job));
+        else
+            queue.push_back(std::move(job));
+    }
+    queued.notify_one();
+    return true;
+}
+
+bool GroupCommit::execute(const Work& work)
+{
+    bool done = false;
+    bool ok = false;
+    const bool posted = post([&work]() { work(); }, [this, &done, &ok](bool committed) {
+        std::lock_guard<std::mutex> locker(mutex);
+        ok = committed;
+        done = true;
+        finished.notify_all();
+    });
+    if (!posted)
+        return false;
+
+    std::unique_lock<std::mutex> locker(mutex);
+    finished.wait(locker, [&done]() { return done; });
+    return ok;
+}
+
+void GroupCommit::finish(std::vector<Job>& jobs, bool ok)
+{
+    for (Job& job : jobs) {
+        if (job.done)
+            job.done(ok);
+    }
+    jobs.clear();
+}
+
+void GroupCommit::run()
+{
+    // 本线程在 DatabaseManager 中有自己的连接, 组事务只在这个连接上
+    std::vector<Job> group;
+    std::unique_lock<std::mutex> locker(mutex);
+    for (;;) {
+        queued.wait(locker, [this]() { return stopping || !queue.empty(); });
+        if (queue.empty())
+            return;
+
+        locker.unlock();
+        bool began = false;
+        {
+            QMutexLocker lock(&writeLock);
+            began = db.beginTransaction();
+        }
+        locker.lock();
+        if (!began) {
+            qDebug() << "Group commit failed to begin a transaction";
+            for (Job& job : queue) {
+                group.push_back(std::move(job));
+            }
+            queue.clear();
+            locker.unlock();
+            finish(group, false);
+            locker.lock();
+            continue;
+        }
+
+        // 窗口从第一个写操作开始计时, 窗口内陆续到达的都进这一组; 紧急的写排在队首, 执行完就提交
+        const auto deadline = std::chrono::steady_clock::now() + window;
+        bool urgent = false;
+        while (!urgent && static_cast<int>(group.size()) < maxWrites) {
+            if (queue.empty() && !queued.wait_until(locker, deadline, [this]() { return stopping || !queue.empty(); }))
+                break;
+            if (queue.empty())
+                break;
+            group.push_back(std::move(queue.front()));
+            queue.pop_front();
+            urgent = group.back().urgent;
+            locker.unlock();
+            {
+                QMutexLocker lock(&writeLock);
+                group.back().work();
+            }
+            locker.lock();
+        }
+        locker.unlock();
+
+        // 提交失败时 commitTransaction 已回滚整组
+        bool ok = false;
+        {
+            QMutexLocker lock(&writeLock);
+            ok = db.commitTransaction();
+            if (commitHook)
+                commitHook();
+        }
+        if (!ok)
+            qDebug() << "Group commit of" << group.size() << "writes failed";
+        finish(group, ok);
+        locker.lock();
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef GROUP_COMMIT_H
+#define GROUP_COMMIT_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <QMutex>
+#include "database_manager.h"
+
+// 默认每组最多的写请求数
+const int DEFAULT_GROUP_COMMIT_MAX_WRITES = 64;
+
+// 组提交: 写请求交给一个专门的提交线程执行, 一个时间窗口内到达的写在提交线程自己的连接上进入同一个事务,
+// 窗口结束或写满时一次提交. 连接只在打开它的提交线程上使用; 组内后面的写能读到前面未提交的修改,
+// 提交失败时整组回滚, 组内请求都回复失败
+// 调用方用 post 交出写操作后不必等待, 一组的大小不受调用线程数限制
+class GroupCommit
+{
+public:
+    using Work = std::function<void()>;
+    using Done = std::function<void(bool committed)>;
+
+    // writeLock 为调用方串行写操作的锁, 提交线程执行每个写操作和提交时持有它
+    GroupCommit(DatabaseManager& db, QRecursiveMutex& writeLock);
+    ~GroupCommit();
+
+    // 在服务启动前配置; windowMicros 为 0 时关闭, 每个写请求各自提交; 开启时启动提交线程
+    void setWindow(int windowMicros, int maxWrites = DEFAULT_GROUP_COMMIT_MAX_WRITES);
+    bool enabled() const { return window.count() > 0; }
+    // 每组提交之后在提交线程上调用, 此时持有 writeLock
+    void setCommitHook(Work hook) { commitHook = std::move(hook); }
+
+    // 把 work 交给提交线程后立即返回, 所在的组提交 (或回滚) 之后在提交线程上调用 done, 此时不持有 writeLock
+    // work 可能在组事务中执行, 自己的事务成为保存点; 组事务开始失败时 work 不执行, done 收到 false
+    // urgent 的写排到队首, 执行完立即提交当前组, 不等窗口结束; 已经停止时返回 false, work 和 done 都不调用
+    bool post(Work work, Done done, bool urgent = false);
+    // 同 post, 但在调用线程上阻塞到组提交完成, 返回是否提交成功; 用于没有网络层回调的会话
+    bool execute(const Work& work);
+
+    // 执行完已经排队的写操作后退出提交线程
+    void stop();
+
+private:
+    struct Job {
+        Work work;
+        Done done;
+        bool urgent = false;    // 执行完后立即提交所在的组
+    };
+
+    void run();
+    // 在提交线程上通知一组写操作的结果
+    static void finish(std::vector<Job>& jobs, bool ok);
+
+    DatabaseManager& db;
+    QRecursiveMutex& writeLock;
+    std::chrono::microseconds window;
+    int maxWrites;
+    Work commitHook;
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable queued;     // 有新的写操作或要求退出
+    std::condition_variable finished;   // execute 等待的写操作已完成
+    std::deque<Job> queue;
+    bool stopping;
+};
+
+#endif // GROUP_COMMIT_H
@@ -0,0 +1,636 @@
+#ifndef JSON_CODEC_H
+#define JSON_CODEC_H
+
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "protocol_fields.h"
+
+// 浮点数的 to_chars/from_chars 需要 GCC 11 以上, 较旧的 libc++ (包括 Apple) 没有;
+// 此时用 snprintf/strtod, 二者受当前 locale 影响 (Qt 会按环境设置 locale), 小数点按 locale 替换
+#ifndef __cpp_lib_to_chars
+#include <cerrno>
+#include <clocale>
+#include <cstdio>
+#include <cstdlib>
+
+inline char localeDecimalPoint()
+{
+    const char* point = std::localeconv()->decimal_point;
+    return point && point[0] ? point[0] : '.';
+}
+#endif
+
+// 写出可往返的最短 (或接近最短) 表示, 调用方保证 value 有限
+template<typename T>
+inline void appendJsonFloat(std::string& out, T value)
+{
+#ifdef __cpp_lib_to_chars
+    char buffer[32];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+#else
+    // 先用 digits10 位, 读回来不相等时再用 max_digits10 位
+    char buffer[40];
+    int length = std::snprintf(buffer, sizeof(buffer), "%.*g", std::numeric_limits<T>::digits10,
+        static_cast<double>(value));
+    if (static_cast<T>(std::strtod(buffer, nullptr)) != value) {
+        length = std::snprintf(buffer, sizeof(buffer), "%.*g", std::numeric_limits<T>::max_digits10,
+            static_cast<double>(value));
+    }
+    const char point = localeDecimalPoint();
+    for (int i = 0; i < length; ++i) {
+        if (buffer[i] == point)
+            buffer[i] = '.';
+    }
+    out.append(buffer, static_cast<size_t>(length));
+#endif
+}
+
+// [start, stop) 必须整段是一个数字, 溢出时失败
+inline bool parseJsonDouble(const char* start, const char* stop, double& value)
+{
+#ifdef __cpp_lib_to_chars
+    const auto result = std::from_chars(start, stop, value);
+    return result.ec == std::errc() && result.ptr == stop;
+#else
+    std::string text(start, stop);
+    const char point = localeDecimalPoint();
+    for (char& c : text) {
+        if (c == '.')
+            c = point;
+    }
+    char* parsed = nullptr;
+    errno = 0;
+    value = std::strtod(text.c_str(), &parsed);
+    return errno != ERANGE && parsed == text.c_str() + text.size();
+#endif
+}
+
+// JSON 消息体编解码, 由 Fields<T> 生成, 不经过 nlohmann::json 中间对象
+// 编码直接追加到输出字符串; 枚举写成整数, 非有限浮点数写成 null, 与 nlohmann 的输出一致
+// 解码边扫描边写入结构体字段: 未知字段跳过, 缺失字段和 null 保持默认值
+
+template<typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+inline void encodeJson(std::string& out, T value)
+{
+    char buffer[24];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+template<typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+inline void encodeJson(std::string& out, T value)
+{
+    if (!std::isfinite(value)) {
+        out += "null";
+        return;
+    }
+    appendJsonFloat(out, value);
+}
+
+template<typename T, typename std::enable_if<std::is_enum<T>::value, int>::type = 0>
+inline void encodeJson(std::string& out, T value)
+{
+    encodeJson(out, static_cast<typename std::underlying_type<T>::type>(value));
+}
+
+// UTF-8 原样写出, 只转义引号, 反斜杠和控制字符
+inline void encodeJson(std::string& out, const std::string& value)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    out.push_back('"');
+    size_t runStart = 0;
+    for (size_t i = 0; i < value.size(); ++i) {
+        const unsigned char c = static_cast<unsigned char>(value[i]);
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+
+        out.append(value, runStart, i - runStart);
+        runStart = i + 1;
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            out += "\\u00";
+            out.push_back(hex[c >> 4]);
+            out.push_back(hex[c & 0x0F]);
+            break;
+        }
+    }
+    out.append(value, runStart, std::string::npos);
+    out.push_back('"');
+}
+
+template<typename T>
+inline void encodeJson(std::string& out, const std::vector<T>& values)
+{
+    out.push_back('[');
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (i > 0)
+            out.push_back(',');
+        encodeJson(out, values[i]);
+    }
+    out.push_back(']');
+}
+
+template<typename T, typename std::enable_if<hasFields<T>, int>::type = 0>
+inline void encodeJson(std::string& out, const T& value)
+{
+    char separator = '{';
+    Fields<T>::forEach([&](const char* name, auto member) {
+        out.push_back(separator);
+        out.push_back('"');
+        out += name;
+        out += "\":";
+        encodeJson(out, value.*member);
+        separator = ',';
+    });
+    if (separator == '{')
+        out.push_back('{');
+    out.push_back('}');
+}
+
+// 流式 JSON 扫描器, 只向前读一遍输入
+// 出错后 ok() 变为 false, 之后的读取全部失败, error()/errorOffset() 给出第一处错误
+class JsonReader
+{
+public:
+    JsonReader(const char* data, size_t size)
+        : begin(data)
+        , cur(data)
+        , end(data + size)
+        , errorMessage(nullptr)
+    {
+    }
+
+    bool ok() const { return errorMessage == nullptr; }
+    const char* error() const { return errorMessage ? errorMessage : ""; }
+    size_t errorOffset() const { return static_cast<size_t>(cur - begin); }
+
+    bool fail(const char* message)
+    {
+        if (!errorMessage)
+            errorMessage = message;
+        return false;
+    }
+
+    // 读完顶层值后只允许剩下空白
+    bool finish()
+    {
+        skipWhitespace();
+        return ok() && (cur == end || fail("多余的内容"));
+    }
+
+    // 下一个值是 null 时消费掉并返回 true
+    bool readNull()
+    {
+        skipWhitespace();
+        if (!ok() || cur == end || *cur != 'n')
+            return false;
+        return literal("null");
+    }
+
+    // 整数字段也接受带小数或指数的数字, 按 nlohmann 的行为截断
+    template<typename T>
+    bool readInteger(T& value)
+    {
+        const char* start = nullptr;
+        const char* stop = nullptr;
+        bool isFloat = false;
+        if (!scanNumber(start, stop, isFloat))
+            return false;
+        if (isFloat) {
+            double d = 0;
+            if (!parseDouble(start, stop, d))
+                return false;
+            // 截断后超出 T 的范围 (含 NaN、无穷) 时转换是未定义行为, 按越界处理
+            const double truncated = std::trunc(d);
+            const double upper = std::ldexp(1.0, std::numeric_limits<T>::digits);
+            const double lower = std::numeric_limits<T>::is_signed ? -upper : 0.0;
+            if (!(truncated >= lower && truncated < upper))
+                return fail("整数越界");
+            value = static_cast<T>(truncated);
+            return true;
+        }
+        const auto result = std::from_chars(start, stop, value);
+        if (result.ec != std::errc() || result.ptr != stop)
+            return fail("整数越界");
+        return true;
+    }
+
+    template<typename T>
+    bool readFloat(T& value)
+    {
+        const char* start = nullptr;
+        const char* stop = nullptr;
+        bool isFloat = false;
+        if (!scanNumber(start, stop, isFloat))
+            return false;
+        double d = 0;
+        if (!parseDouble(start, stop, d))
+            return false;
+        value = static_cast<T>(d);
+        return true;
+    }
+
+    bool readString(std::string& value)
+    {
+        skipWhitespace();
+        if (!ok() || cur == end || *cur != '"')
+            return fail("应为字符串");
+        ++cur;
+        value.clear();
+        return readStringBody(value);
+    }
+
+    // 对象: 依次调用 nextMember 取键, 返回 false 表示对象结束或出错
+    bool beginObject()
+    {
+        skipWhitespace();
+        if (!ok() || cur == end || *cur != '{')
+            return fail("应为对象");
+        ++cur;
+        return true;
+    }
+
+    // 键没有转义时直接指向输入缓冲区, 否则指向内部缓冲区, 在读下一个键之前有效
+    bool nextMember(bool& first, std::string_view& key)
+    {
+        if (!separator(first, '}'))
+            return false;
+        skipWhitespace();
+        if (cur == end || *cur != '"')
+            return fail("应为字段名");
+        ++cur;
+
+        const char* start = cur;
+        while (cur != end && *cur != '"' && *cur != '\\' && static_cast<unsigned char>(*cur) >= 0x20) {
+            ++cur;
+        }
+        if (cur != end && *cur == '"') {
+            key = std::string_view(start, static_cast<size_t>(cur - start));
+            ++cur;
+        }
+        else {
+            keyBuffer.assign(start, cur);
+            if (!readStringBody(keyBuffer))
+                return false;
+            key = keyBuffer;
+        }
+
+        skipWhitespace();
+        if (cur == end || *cur != ':')
+            return fail("应为冒号");
+        ++cur;
+        return true;
+    }
+
+    bool beginArray()
+    {
+        skipWhitespace();
+        if (!ok() || cur == end || *cur != '[')
+            return fail("应为数组");
+        ++cur;
+        return true;
+    }
+
+    bool nextElement(bool& first)
+    {
+        return separator(first, ']');
+    }
+
+    // 跳过一个任意类型的值 (未知字段)
+    bool skipValue(int depth = 0)
+    {
+        if (depth > MAX_DEPTH)
+            return fail("嵌套过深");
+        skipWhitespace();
+        if (!ok() || cur == end)
+            return fail("输入不完整");
+
+        switch (*cur) {
+        case '{': {
+            ++cur;
+            bool first = true;
+            std::string_view key;
+            while (nextMember(first, key)) {
+                if (!skipValue(depth + 1))
+                    return false;
+            }
+            return ok();
+        }
+        case '[': {
+            ++cur;
+            bool first = true;
+            while (nextElement(first)) {
+                if (!skipValue(depth + 1))
+                    return false;
+            }
+            return ok();
+        }
+        case '"':
+            ++cur;
+            keyBuffer.clear();
+            return readStringBody(keyBuffer);
+        case 't':
+            return literal("true");
+        case 'f':
+            return literal("false");
+        case 'n':
+            return literal("null");
+        default: {
+            const char* start = nullptr;
+            const char* stop = nullptr;
+            bool isFloat = false;
+            return scanNumber(start, stop, isFloat);
+        }
+        }
+    }
+
+private:
+    static const int MAX_DEPTH = 64;
+
+    void skipWhitespace()
+    {
+        while (cur != end && (*cur == ' ' || *cur == '\n' || *cur == '\r' || *cur == '\t')) {
+            ++cur;
+        }
+    }
+
+    bool literal(const char* text)
+    {
+        const size_t length = strlen(text);
+        if (static_cast<size_t>(end - cur) < length || memcmp(cur, text, length) != 0)
+            return fail("非法的字面量");
+        cur += length;
+        return true;
+    }
+
+    // 处理容器元素之间的逗号, 遇到结束符时消费并返回 false
+    bool separator(bool& first, char close)
+    {
+        skipWhitespace();
+        if (!ok() || cur == end)
+            return fail("输入不完整");
+        if (*cur == close) {
+            ++cur;
+            return false;
+        }
+        if (!first) {
+            if (*cur != ',')
+                return fail("应为逗号");
+            ++cur;
+        }
+        first = false;
+        return true;
+    }
+
+    // 按 JSON 数字语法扫描, 不做转换
+    bool scanNumber(const char*& start, const char*& stop, bool& isFloat)
+    {
+        skipWhitespace();
+        if (!ok())
+            return false;
+        start = cur;
+        if (cur != end && *cur == '-')
+            ++cur;
+        if (cur == end || !isDigit(*cur))
+            return fail("应为数字");
+        if (*cur == '0') {
+            ++cur;
+        }
+        else {
+            while (cur != end && isDigit(*cur)) {
+                ++cur;
+            }
+        }
+        isFloat = false;
+        if (cur != end && *cur == '.') {
+            isFloat = true;
+            ++cur;
+            if (cur == end || !isDigit(*cur))
+                return fail("非法的数字");
+            while (cur != end && isDigit(*cur)) {
+                ++cur;
+            }
+        }
+        if (cur != end && (*cur == 'e' || *cur == 'E')) {
+            isFloat = true;
+            ++cur;
+            if (cur != end && (*cur == '+' || *cur == '-'))
+                ++cur;
+            if (cur == end || !isDigit(*cur))
+                return fail("非法的数字");
+            while (cur != end && isDigit(*cur)) {
+                ++cur;
+            }
+        }
+        stop = cur;
+        return true;
+    }
+
+    bool parseDouble(const char* start, const char* stop, double& value)
+    {
+        if (!parseJsonDouble(start, stop, value))
+            return fail("非法的数字");
+        return true;
+    }
+
+    static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+    // 起始引号已消费; 没有转义的片段整段追加
+    bool readStringBody(std::string& out)
+    {
+        for (;;) {
+            const char* start = cur;
+            while (cur != end && *cur != '"' && *cur != '\\' && static_cast<unsigned char>(*cur) >= 0x20) {
+                ++cur;
+            }
+            out.append(start, cur);
+            if (cur == end)
+                return fail("字符串未结束");
+            if (*cur == '"') {
+                ++cur;
+                return true;
+            }
+            if (*cur != '\\')
+                return fail("字符串中有控制字符");
+
+            ++cur;
+            if (cur == end)
+                return fail("字符串未结束");
+            switch (*cur++) {
+            case '"': out.push_back('"'); break;
+            case '\\': out.push_back('\\'); break;
+            case '/': out.push_back('/'); break;
+            case 'b': out.push_back('\b'); break;
+            case 'f': out.push_back('\f'); break;
+            case 'n': out.push_back('\n'); break;
+            case 'r': out.push_back('\r'); break;
+            case 't': out.push_back('\t'); break;
+            case 'u':
+                if (!readUnicodeEscape(out))
+                    return false;
+                break;
+            default:
+                return fail("非法的转义字符");
+            }
+        }
+    }
+
+    bool readHex4(uint32_t& value)
+    {
+        if (end - cur < 4)
+            return fail("非法的 \\u 转义");
+        value = 0;
+        for (int i = 0; i < 4; ++i) {
+            const char c = *cur++;
+            value <<= 4;
+            if (c >= '0' && c <= '9')
+                value |= static_cast<uint32_t>(c - '0');
+            else if (c >= 'a' && c <= 'f')
+                value |= static_cast<uint32_t>(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F')
+                value |= static_cast<uint32_t>(c - 'A' + 10);
+            else
+                return fail("非法的 \\u 转义");
+        }
+        return true;
+    }
+
+    // \uXXXX 转成 UTF-8, 代理对合并为一个码点
+    bool readUnicodeEscape(std::string& out)
+    {
+        uint32_t code = 0;
+        if (!readHex4(code))
+            return false;
+        if (code >= 0xD800 && code <= 0xDBFF) {
+            uint32_t low = 0;
+            if (end - cur < 2 || cur[0] != '\\' || cur[1] != 'u')
+                return fail("缺少低位代理");
+            cur += 2;
+            if (!readHex4(low))
+                return false;
+            if (low < 0xDC00 || low > 0xDFFF)
+                return fail("非法的低位代理");
+            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+        }
+        else if (code >= 0xDC00 && code <= 0xDFFF) {
+            return fail("非法的低位代理");
+        }
+
+        if (code < 0x80) {
+            out.push_back(static_cast<char>(code));
+        }
+        else if (code < 0x800) {
+            out.push_back(static_cast<char>(0xC0 | (code >> 6)));
+            out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+        else if (code < 0x10000) {
+            out.push_back(static_cast<char>(0xE0 | (code >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+        else {
+            out.push_back(static_cast<char>(0xF0 | (code >> 18)));
+            out.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+        return true;
+    }
+
+    const char* begin;
+    const char* cur;
+    const char* end;
+    const char* errorMessage;
+    std::string keyBuffer;
+};
+
+// 解码: null 一律保持原值
+
+template<typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+inline bool decodeJson(JsonReader& r, T& value)
+{
+    return r.readNull() || r.readInteger(value);
+}
+
+template<typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+inline bool decodeJson(JsonReader& r, T& value)
+{
+    return r.readNull() || r.readFloat(value);
+}
+
+template<typename T, typename std::enable_if<std::is_enum<T>::value, int>::type = 0>
+inline bool decodeJson(JsonReader& r, T& value)
+{
+    typename std::underlying_type<T>::type raw{};
+    if (r.readNull())
+        return true;
+    if (!r.readInteger(raw))
+        return false;
+    value = static_cast<T>(raw);
+    return true;
+}
+
+inline bool decodeJson(JsonReader& r, std::string& value)
+{
+    return r.readNull() || r.readString(value);
+}
+
+template<typename T>
+inline bool decodeJson(JsonReader& r, std::vector<T>& values)
+{
+    if (r.readNull())
+        return true;
+    if (!r.beginArray())
+        return false;
+    values.clear();
+    bool first = true;
+    while (r.nextElement(first)) {
+        values.emplace_back();
+        if (!decodeJson(r, values.back()))
+            return false;
+    }
+    return r.ok();
+}
+
+template<typename T, typename std::enable_if<hasFields<T>, int>::type = 0>
+inline bool decodeJson(JsonReader& r, T& value)
+{
+    if (r.readNull())
+        return true;
+    if (!r.beginObject())
+        return false;
+
+    bool first = true;
+    std::string_view key;
+    while (r.nextMember(first, key)) {
+        bool matched = false;
+        Fields<T>::forEach([&](const char* name, auto member) {
+            if (!matched && key == name) {
+                matched = true;
+                decodeJson(r, value.*member);
+            }
+        });
+        if (!matched)
+            r.skipValue();
+        if (!r.ok())
+            return false;
+    }
+    return r.ok();
+}
+
+#endif // JSON_CODEC_H
@@ -0,0 +1,79 @@
+#include "latency_histogram.h"
+
+LatencyHistogram::LatencyHistogram()
+    : total(0)
+    , sum(0)
+    , maximum(0)
+{
+    for (std::atomic<uint64_t>& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+// 小于 2 * SUB_BUCKETS 的值每个数一格; 更大的值按最高位所在的区间 e 右移 e 位, 落在 [SUB_BUCKETS, 2 * SUB_BUCKETS)
+int LatencyHistogram::indexOf(uint64_t value)
+{
+    if (value < 2 * SUB_BUCKETS)
+        return static_cast<int>(value);
+    int highestBit = 63;
+    while (!(value >> highestBit)) {
+        --highestBit;
+    }
+    const int shift = highestBit - SUB_BUCKET_BITS;
+    const int index = (shift + 1) * SUB_BUCKETS + static_cast<int>((value >> shift) - SUB_BUCKETS);
+    return index < BUCKET_COUNT ? index : BUCKET_COUNT - 1;
+}
+
+uint64_t LatencyHistogram::upperBound(int index)
+{
+    if (index < 2 * SUB_BUCKETS)
+        return static_cast<uint64_t>(index);
+    const int shift = index / SUB_BUCKETS - 1;
+    const uint64_t subBucket = static_cast<uint64_t>(index % SUB_BUCKETS + SUB_BUCKETS);
+    return ((subBucket + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(int64_t micros)
+{
+    const uint64_t value = micros > 0 ? static_cast<uint64_t>(micros) : 0;
+    buckets[indexOf(value)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(value, std::memory_order_relaxed);
+    uint64_t current = maximum.load(std::memory_order_relaxed);
+    while (value > current && !maximum.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const
+{
+    Snapshot result;
+    result.buckets.resize(BUCKET_COUNT);
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        result.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+        result.count += result.buckets[i];
+    }
+    result.sum = sum.load(std::memory_order_relaxed);
+    result.max = maximum.load(std::memory_order_relaxed);
+    return result;
+}
+
+uint64_t LatencyHistogram::Snapshot::valueAt(double q) const
+{
+    if (count == 0)
+        return 0;
+    // 第 rank 个样本所在的格, rank 从 1 开始
+    uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count) + 0.5);
+    if (rank < 1)
+        rank = 1;
+    if (rank > count)
+        rank = count;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            const uint64_t bound = upperBound(static_cast<int>(i));
+            return bound < max ? bound : max;
+        }
+    }
+    return max;
+}
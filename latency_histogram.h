@@ -0,0 +1,48 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// HDR 风格的对数线性直方图, 单位微秒: 每个 2 的幂区间再等分 64 格, 相对误差不超过 1/64;
+// 覆盖 0 到 2^32 微秒 (约 71 分钟), 更大的值计入最后一格. 记录只做几次 relaxed 原子加, 可在任意线程并发调用
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void record(int64_t micros);
+
+    // 读出时各格不是同一时刻的值, 总数以各格之和为准
+    struct Snapshot {
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t max = 0;
+        std::vector<uint64_t> buckets;
+
+        // q 取 0-1, 返回该分位所在格的上界 (微秒)
+        uint64_t valueAt(double q) const;
+        double mean() const { return count ? static_cast<double>(sum) / static_cast<double>(count) : 0.0; }
+    };
+    Snapshot snapshot() const;
+
+    uint64_t count() const { return total.load(std::memory_order_relaxed); }
+
+private:
+    static const int SUB_BUCKET_BITS = 6;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int MAX_VALUE_BITS = 32;
+    static const int BUCKET_COUNT = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    static int indexOf(uint64_t value);
+    static uint64_t upperBound(int index);
+
+    std::atomic<uint64_t> buckets[BUCKET_COUNT];
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> maximum;
+};
+
+#endif // LATENCY_HISTOGRAM_H
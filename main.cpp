@@ -1,12 +1,16 @@
 #include <QApplication>
 #include "data_info.h"
 #include "database_manager.h"
+#ifdef Q_OS_WIN
 #include <Windows.h>
+#endif
 #include "mainwindow.h"
 #include "login.h"
 int main(int argc, char *argv[])
 {
+#ifdef Q_OS_WIN
     ::SetEnvironmentVariableA("NT_SYMBOL_PATH", "");
+#endif
     QApplication a(argc, argv);
     MainWindow w;
 
@@ -14,9 +18,11 @@ int main(int argc, char *argv[])
     /*login li;
     li.show();*/
 
-    // 初始化数据库
+    // 初始化数据库, 路径可由第一个命令行参数指定, 默认为工作目录下的 data/data.db
+    const QStringList arguments = QCoreApplication::arguments();
+    const QString dbPath = arguments.size() > 1 ? arguments.at(1) : QStringLiteral("data/data.db");
     DatabaseManager dbManager;
-    if (!dbManager.initializeDatabase("E:/IronDeal/IronDeal/data/data.db")) {
+    if (!dbManager.initializeDatabase(dbPath)) {
         qDebug() << "Failed to initialize database";
         return -1;
     }
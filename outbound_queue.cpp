@@ -0,0 +1,91 @@
+#include "outbound_queue.h"
+
+namespace {
+
+// 单块合并上限, 超过后新开一块, 避免大块反复扩容搬移
+const qsizetype COALESCE_LIMIT = 64 * 1024;
+
+} // namespace
+
+OutboundQueue::OutboundQueue()
+    : frontOffset(0)
+    , sealedCount(0)
+    , highWaterMark(DEFAULT_WRITE_HIGH_WATER_MARK)
+    , lowWaterMark(DEFAULT_WRITE_LOW_WATER_MARK)
+{
+}
+
+void OutboundQueue::setWaterMarks(size_t high, size_t low)
+{
+    highWaterMark = high;
+    lowWaterMark = low < high ? low : high;
+}
+
+QByteArray& OutboundQueue::tail()
+{
+    if (chunks.empty() || sealedCount >= chunks.size() || chunks.back().size() >= COALESCE_LIMIT) {
+        chunks.emplace_back();
+        chunks.back().swap(spare);
+    }
+    return chunks.back();
+}
+
+size_t OutboundQueue::pendingBytes() const
+{
+    size_t bytes = 0;
+    for (const QByteArray& chunk : chunks) {
+        bytes += static_cast<size_t>(chunk.size());
+    }
+    return bytes - static_cast<size_t>(frontOffset);
+}
+
+#ifdef __linux__
+int OutboundQueue::gather(iovec* iov, int maxCount)
+{
+    int count = 0;
+    size_t index = 0;
+    for (; index < chunks.size() && count < maxCount; ++index) {
+        const QByteArray& chunk = chunks[index];
+        const qsizetype offset = index == 0 ? frontOffset : 0;
+        if (chunk.size() <= offset)
+            continue;
+        iov[count].iov_base = const_cast<char*>(chunk.constData() + offset);
+        iov[count].iov_len = static_cast<size_t>(chunk.size() - offset);
+        ++count;
+    }
+    if (index > sealedCount)
+        sealedCount = index;
+    return count;
+}
+#endif
+
+void OutboundQueue::consume(size_t bytes)
+{
+    while (!chunks.empty()) {
+        QByteArray& front = chunks.front();
+        const size_t remaining = static_cast<size_t>(front.size() - frontOffset);
+        if (bytes < remaining) {
+            frontOffset += static_cast<qsizetype>(bytes);
+            return;
+        }
+        // 已发完的块: 空块也在这里一并移除
+        bytes -= remaining;
+        if (front.capacity() > spare.capacity()) {
+            front.resize(0);
+            spare.swap(front);
+        }
+        chunks.pop_front();
+        frontOffset = 0;
+        if (sealedCount > 0)
+            --sealedCount;
+        if (bytes == 0 && (chunks.empty() || chunks.front().size() > 0))
+            return;
+    }
+}
+
+void OutboundQueue::clear()
+{
+    chunks.clear();
+    frontOffset = 0;
+    sealedCount = 0;
+}
@@ -0,0 +1,54 @@
+#ifndef OUTBOUND_QUEUE_H
+#define OUTBOUND_QUEUE_H
+
+#include <cstddef>
+#include <deque>
+#include <QByteArray>
+
+#ifdef __linux__
+#include <sys/uio.h>
+#endif
+
+// 默认水位: 待发送数据超过高水位后停止读取该连接, 降到低水位以下再恢复
+const size_t DEFAULT_WRITE_HIGH_WATER_MARK = 1024 * 1024;
+const size_t DEFAULT_WRITE_LOW_WATER_MARK = 256 * 1024;
+
+// 连接的发送队列, 只由连接所属线程访问
+// 响应追加到末尾的块中, 多个小响应合并为一块; 发送时把多块聚合成一次 writev/sendmsg
+class OutboundQueue
+{
+public:
+    OutboundQueue();
+
+    void setWaterMarks(size_t high, size_t low);
+    size_t highWater() const { return highWaterMark; }
+    size_t lowWater() const { return lowWaterMark; }
+
+    // 响应写入的缓冲区, 末尾块未交给内核且不超过合并上限时继续追加到该块
+    QByteArray& tail();
+
+    size_t pendingBytes() const;
+    bool isEmpty() const { return pendingBytes() == 0; }
+    bool aboveHighWater() const { return pendingBytes() >= highWaterMark; }
+    bool belowLowWater() const { return pendingBytes() <= lowWaterMark; }
+
+#ifdef __linux__
+    // 填充最多 maxCount 段待发送数据, 返回段数
+    // 返回的块在 consume 之前不会再被追加, 内存保持有效, 可用于异步发送
+    int gather(iovec* iov, int maxCount);
+#endif
+
+    // 已发送 bytes 字节
+    void consume(size_t bytes);
+    void clear();
+
+private:
+    std::deque<QByteArray> chunks;
+    qsizetype frontOffset;  // 首块中已发送的字节数
+    size_t sealedCount;     // 前 sealedCount 块已交给内核, 不能再追加
+    QByteArray spare;       // 发送完的块, 保留容量供下次复用
+    size_t highWaterMark;
+    size_t lowWaterMark;
+};
+
+#endif // OUTBOUND_QUEUE_H
@@ -0,0 +1,153 @@
+#ifndef PROTOCOL_FIELDS_H
+#define PROTOCOL_FIELDS_H
+
+#include "com_protocol.h"
+#include "data_info.h"
+
+// 协议结构体的字段表, 编译期展开, JSON 和二进制编解码都由它生成
+// 增删字段只改这里; 二进制格式依赖字段顺序, 只能在末尾追加
+
+// Fields<T>::forEach(visitor) 按声明顺序对每个字段调用 visitor(字段名, 成员指针)
+template<typename T>
+struct Fields {
+    static constexpr bool defined = false;
+};
+
+template<typename T>
+constexpr bool hasFields = Fields<T>::defined;
+
+// 最多支持 16 个字段; EXPAND 兼容 MSVC 的传统预处理器
+#define IRONDEAL_EXPAND(x) x
+#define IRONDEAL_GET_MACRO(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, NAME, ...) NAME
+#define IRONDEAL_FOR_EACH(m, ...) IRONDEAL_EXPAND(IRONDEAL_GET_MACRO(__VA_ARGS__, \
+    IRONDEAL_FE16, IRONDEAL_FE15, IRONDEAL_FE14, IRONDEAL_FE13, IRONDEAL_FE12, IRONDEAL_FE11, IRONDEAL_FE10, \
+    IRONDEAL_FE9, IRONDEAL_FE8, IRONDEAL_FE7, IRONDEAL_FE6, IRONDEAL_FE5, IRONDEAL_FE4, IRONDEAL_FE3, \
+    IRONDEAL_FE2, IRONDEAL_FE1)(m, __VA_ARGS__))
+#define IRONDEAL_FE1(m, a) m(a)
+#define IRONDEAL_FE2(m, a, ...) m(a) IRONDEAL_EXPAND(IRONDEAL_FE1(m, __VA_ARGS__))
+#define IRONDEAL_FE3(m, a, ...) m(a) IRONDEAL_EXPAND(IRONDEAL_FE2(m, __VA_ARGS__))
+#define IRONDEAL_FE4(m, a, ...) m(a) IRONDEAL_EXPAND(IRONDEAL_FE3(m, __VA_ARGS__))
+#define IRONDEAL_FE5(m, a, ...) m(a) IRONDEAL_EXPAND(IRONDEAL_FE4(m, __VA_ARGS__))
+#define IRONDEAL_FE6(m, a, ...) m(a) IRONDEAL_EXPAND(IRONDEAL_FE5(m, __VA_ARGS__))
+#define IRONDEAL_FE7(m, a, ...) m(a) IRONDEAL_EXPAND(IRONDEAL_FE6(m, __VA_ARGS__))
+#define IRONDEAL_FE8(m, a, ...) m(a) IRONDEAL_EXPAND(IRONDEAL_FE7(m, __VA_ARGS__))
+#define IRONDEAL_FE9(m, a, ...) m(a) IRONDEAL_EXPAND(IRONDEAL_FE8(m, __VA_ARGS__))
+#define IRONDEAL_FE10(m, a, ...) m(a) IRONDEAL_EXPAND(IRONDEAL_FE9(m, __VA_ARGS__))
+#define IRONDEAL_FE11(m, a, ...) m(a) IRONDEAL_EXPAND(IRONDEAL_FE10(m, __VA_ARGS__))
+#define IRONDEAL_FE12(m, a, ...) m(a) IRONDEAL_EXPAND(IRONDEAL_FE11(m, __VA_ARGS__))
+#define IRONDEAL_FE13(m, a, ...) m(a) IRONDEAL_EXPAND(IRONDEAL_FE12(m, __VA_ARGS__))
+#define IRONDEAL_FE14(m, a, ...) m(a) IRONDEAL_EXPAND(IRONDEAL_FE13(m, __VA_ARGS__))
+#define IRONDEAL_FE15(m, a, ...) m(a) IRONDEAL_EXPAND(IRONDEAL_FE14(m, __VA_ARGS__))
+#define IRONDEAL_FE16(m, a, ...) m(a) IRONDEAL_EXPAND(IRONDEAL_FE15(m, __VA_ARGS__))
+
+#define IRONDEAL_FIELD_VISIT(field) visitor(#field, &Self::field);
+
+#define IRONDEAL_FIELDS(Type, ...) \
+    template<> \
+    struct Fields<Type> { \
+        using Self = Type; \
+        static constexpr bool defined = true; \
+        template<typename Visitor> \
+        static constexpr void forEach(Visitor&& visitor) \
+        { \
+            IRONDEAL_FOR_EACH(IRONDEAL_FIELD_VISIT, __VA_ARGS__) \
+        } \
+    };
+
+// data_info.h
+IRONDEAL_FIELDS(ProductClass, classID, stock, small_imageURL, name, price)
+IRONDEAL_FIELDS(Product, productID, description, brief_description, description_imageURLs, specification,
+    brand, product_class, productName, category, sellerID, salesCount)
+IRONDEAL_FIELDS(User, userID, username, password, nickname, avatarURL, phone, default_address, rating,
+    numsofRate, balance, registerTime, userLevel)
+IRONDEAL_FIELDS(OrderItem, productID, classID, quantity, price)
+IRONDEAL_FIELDS(Cart, userID, items, totalAmount)
+IRONDEAL_FIELDS(Order, orderID, userID, sellerID, totalAmount, status, address, orderItems, createdTime)
+
+// 认证
+IRONDEAL_FIELDS(BaseResponse, error_code, error_msg)
+IRONDEAL_FIELDS(LoginRequest, username, password)
+IRONDEAL_FIELDS(LoginResponse, error_code, error_msg, user_id, nickname, avatar_url, balance)
+IRONDEAL_FIELDS(RegisterRequest, username, password, nickname, phone)
+IRONDEAL_FIELDS(RegisterResponse, error_code, error_msg, user_id)
+
+// 用户
+IRONDEAL_FIELDS(UserInfoRequest, user_id)
+IRONDEAL_FIELDS(UserInfoResponse, error_code, error_msg, user_info)
+IRONDEAL_FIELDS(UpdateUserInfoRequest, user_id, nickname, phone, default_address)
+IRONDEAL_FIELDS(UpdateUserInfoResponse, error_code, error_msg)
+
+// 商品
+IRONDEAL_FIELDS(ProductListRequest, page, page_size, category, keyword)
+IRONDEAL_FIELDS(ProductListResponse, error_code, error_msg, products, total_count, total_pages)
+IRONDEAL_FIELDS(ProductDetailRequest, product_id)
+IRONDEAL_FIELDS(ProductDetailResponse, error_code, error_msg, product)
+IRONDEAL_FIELDS(CreateProductRequest, product)
+IRONDEAL_FIELDS(CreateProductResponse, error_code, error_msg, product_id)
+IRONDEAL_FIELDS(UpdateProductRequest, product)
+IRONDEAL_FIELDS(UpdateProductResponse, error_code, error_msg)
+IRONDEAL_FIELDS(DeleteProductRequest, product_id)
+IRONDEAL_FIELDS(DeleteProductResponse, error_code, error_msg)
+IRONDEAL_FIELDS(MyProductsRequest, user_id, page, page_size)
+IRONDEAL_FIELDS(MyProductsResponse, error_code, error_msg, products, total_count)
+
+// 购物车
+IRONDEAL_FIELDS(GetCartRequest, user_id)
+IRONDEAL_FIELDS(GetCartResponse, error_code, error_msg, cart)
+IRONDEAL_FIELDS(AddToCartRequest, user_id, item)
+IRONDEAL_FIELDS(AddToCartResponse, error_code, error_msg)
+IRONDEAL_FIELDS(UpdateCartItemRequest, user_id, product_id, class_id, quantity)
+IRONDEAL_FIELDS(UpdateCartItemResponse, error_code, error_msg)
+IRONDEAL_FIELDS(RemoveCartItemRequest, user_id, product_id, class_id)
+IRONDEAL_FIELDS(RemoveCartItemResponse, error_code, error_msg)
+IRONDEAL_FIELDS(ClearCartRequest, user_id)
+IRONDEAL_FIELDS(ClearCartResponse, error_code, error_msg)
+
+// 订单
+IRONDEAL_FIELDS(CreateOrderRequest, user_id, address, discount, coupon_code)
+IRONDEAL_FIELDS(CreateOrderResponse, error_code, error_msg, order_id, final_amount)
+IRONDEAL_FIELDS(OrderListRequest, user_id, page, page_size, status_filter)
+IRONDEAL_FIELDS(OrderListResponse, error_code, error_msg, orders, total_count)
+IRONDEAL_FIELDS(OrderDetailRequest, order_id)
+IRONDEAL_FIELDS(OrderDetailResponse, error_code, error_msg, order)
+IRONDEAL_FIELDS(UpdateOrderStatusRequest, order_id, new_status)
+IRONDEAL_FIELDS(UpdateOrderStatusResponse, error_code, error_msg)
+IRONDEAL_FIELDS(CancelOrderRequest, order_id)
+IRONDEAL_FIELDS(CancelOrderResponse, error_code, error_msg)
+
+// 图片; ImageChunk 带原始字节, 只走二进制编码
+IRONDEAL_FIELDS(ImageMeta, type, filename, format, file_size, related_id)
+IRONDEAL_FIELDS(UploadImageRequestHeader, meta, total_chunks, chunk_size)
+IRONDEAL_FIELDS(ImageChunk, chunk_index, chunk_size, chunk_data)
+IRONDEAL_FIELDS(UploadImageResponse, error_code, error_msg, image_url, image_id)
+IRONDEAL_FIELDS(DownloadImageRequest, image_id, type, related_id)
+IRONDEAL_FIELDS(DownloadImageResponseHeader, error_code, error_msg, meta, total_chunks, chunk_size)
+
+// 促销
+IRONDEAL_FIELDS(ApplyDiscountRequest, order_id, discount_rate)
+IRONDEAL_FIELDS(ApplyDiscountResponse, error_code, error_msg, new_total)
+IRONDEAL_FIELDS(ApplyCouponRequest, user_id, coupon_code)
+IRONDEAL_FIELDS(ApplyCouponResponse, error_code, error_msg, discount_amount, description)
+
+// 主题
+IRONDEAL_FIELDS(ChangeThemeRequest, user_id, theme_name)
+IRONDEAL_FIELDS(ChangeThemeResponse, error_code, error_msg, current_theme)
+
+// 订阅
+IRONDEAL_FIELDS(SubscribeRequest, product_ids)
+IRONDEAL_FIELDS(SubscribeResponse, error_code, error_msg, subscription_count)
+IRONDEAL_FIELDS(UnsubscribeRequest, product_ids)
+IRONDEAL_FIELDS(UnsubscribeResponse, error_code, error_msg, subscription_count)
+IRONDEAL_FIELDS(ClassUpdate, class_id, stock, price)
+IRONDEAL_FIELDS(ProductUpdatePush, product_id, classes)
+
+// 运行统计
+IRONDEAL_FIELDS(StatsRequest, min_count)
+IRONDEAL_FIELDS(LatencyStats, message_type, name, count, errors, mean_ms, p50_ms, p90_ms, p99_ms, p999_ms, max_ms)
+IRONDEAL_FIELDS(StatsResponse, error_code, error_msg, uptime_ms, requests, db_operations)
+
+// 系统消息
+IRONDEAL_FIELDS(ErrorResponse, error_code, error_message, original_sequence_id, retry_after_ms)
+IRONDEAL_FIELDS(Heartbeat, timestamp)
+
+#endif // PROTOCOL_FIELDS_H
@@ -0,0 +1,29 @@
+#ifndef PROTOCOL_JSON_H
+#define PROTOCOL_JSON_H
+
+#include "json.hpp"
+#include "protocol_fields.h"
+
+// 数据结构与 nlohmann::json 之间的转换, 由 Fields<T> 生成, 缺失的字段保持默认值
+// 消息体的编码走 json_codec.h, 这里只负责解码和调试输出
+
+template<typename T, typename std::enable_if<hasFields<T>, int>::type = 0>
+void to_json(nlohmann::json& j, const T& value)
+{
+    j = nlohmann::json::object();
+    Fields<T>::forEach([&](const char* name, auto member) {
+        j[name] = value.*member;
+    });
+}
+
+template<typename T, typename std::enable_if<hasFields<T>, int>::type = 0>
+void from_json(const nlohmann::json& j, T& value)
+{
+    Fields<T>::forEach([&](const char* name, auto member) {
+        const auto it = j.find(name);
+        if (it != j.end())
+            it->get_to(value.*member);
+    });
+}
+
+#endif // PROTOCOL_JSON_H
@@ -0,0 +1,155 @@
+#include "rate_limiter.h"
+#include <QMutexLocker>
+
+namespace {
+
+// 规则表覆盖的 MessageType 取值范围, 超出的类型不限流
+const size_t MESSAGE_TYPE_COUNT = 256;
+
+} // namespace
+
+RateLimiter::RateLimiter()
+    : connectionRules(MESSAGE_TYPE_COUNT)
+    , userRules(MESSAGE_TYPE_COUNT)
+    , hasUserRules(false)
+{
+}
+
+void RateLimiter::setLimit(MessageType type, Scope scope, double ratePerSecond, int burst)
+{
+    const size_t index = typeIndex(type);
+    if (index >= MESSAGE_TYPE_COUNT)
+        return;
+
+    Rule rule;
+    rule.ratePerMs = ratePerSecond / 1000.0;
+    rule.burst = burst;
+    if (scope == Scope::CONNECTION) {
+        connectionRules[index] = rule;
+    }
+    else {
+        userRules[index] = rule;
+        hasUserRules = false;
+        for (const Rule& userRule : userRules) {
+            hasUserRules = hasUserRules || userRule.enabled();
+        }
+    }
+}
+
+void RateLimiter::setConnectionLimit(double ratePerSecond, int burst)
+{
+    connectionTotal.ratePerMs = ratePerSecond / 1000.0;
+    connectionTotal.burst = burst;
+}
+
+void RateLimiter::useDefaultLimits()
+{
+    setConnectionLimit(1000, 2000);
+    setLimit(MessageType::LOGIN_REQUEST, Scope::CONNECTION, 1, 5);
+    setLimit(MessageType::REGISTER_REQUEST, Scope::CONNECTION, 1, 3);
+    setLimit(MessageType::CREATE_ORDER_REQUEST, Scope::USER, 5, 10);
+    setLimit(MessageType::ADD_TO_CART_REQUEST, Scope::USER, 20, 40);
+}
+
+void RateLimiter::clear()
+{
+    connectionTotal = Rule();
+    connectionRules.assign(MESSAGE_TYPE_COUNT, Rule());
+    userRules.assign(MESSAGE_TYPE_COUNT, Rule());
+    hasUserRules = false;
+}
+
+bool RateLimiter::refill(TokenBucket& bucket, const Rule& rule, qint64 nowMs)
+{
+    if (bucket.tokens < 0.0) {
+        bucket.tokens = rule.burst;
+    }
+    else if (nowMs > bucket.lastRefill) {
+        bucket.tokens = qMin(rule.burst, bucket.tokens + static_cast<double>(nowMs - bucket.lastRefill) * rule.ratePerMs);
+    }
+    bucket.lastRefill = nowMs;
+    return bucket.tokens >= 1.0;
+}
+
+TokenBucket* RateLimiter::userBucket(Shard& shard, quint64 key, qint64 nowMs)
+{
+    const auto found = shard.index.constFind(key);
+    if (found != shard.index.constEnd()) {
+        Slot& slot = shard.entries[found.value()];
+        slot.referenced = true;
+        return &slot.bucket;
+    }
+
+    int victim = -1;
+    if (static_cast<int>(shard.entries.size()) < MAX_BUCKETS_PER_SHARD) {
+        shard.entries.emplace_back();
+        victim = static_cast<int>(shard.entries.size()) - 1;
+    }
+    else {
+        // CLOCK: 最近用过的桶清掉访问位再给一次机会, 令牌已用完 (正在被限流) 的桶不淘汰
+        for (int i = 0; i < EVICTION_SCAN && victim < 0; ++i) {
+            Slot& slot = shard.entries[shard.hand];
+            const int current = shard.hand;
+            shard.hand = (shard.hand + 1) % MAX_BUCKETS_PER_SHARD;
+            if (slot.referenced) {
+                slot.referenced = false;
+                continue;
+            }
+            const Rule& rule = userRules[slot.key & 0xFFFF];
+            const double tokens = slot.bucket.tokens
+                + static_cast<double>(nowMs - slot.bucket.lastRefill) * rule.ratePerMs;
+            if (slot.bucket.tokens < 0.0 || tokens >= 1.0)
+                victim = current;
+        }
+        if (victim < 0)
+            return nullptr;
+        shard.index.remove(shard.entries[victim].key);
+    }
+
+    Slot& slot = shard.entries[victim];
+    slot.key = key;
+    slot.bucket = TokenBucket();
+    // 只用过一次的桶 (如轮换 userID 刷进来的) 下一圈就能淘汰, 再次访问才设访问位
+    slot.referenced = false;
+    shard.index.insert(key, victim);
+    return &slot.bucket;
+}
+
+bool RateLimiter::allow(MessageType type, int userID, ConnectionBuckets& buckets, qint64 nowMs)
+{
+    const size_t index = typeIndex(type);
+    if (index >= MESSAGE_TYPE_COUNT)
+        return true;
+
+    // 先检查所有的桶再扣令牌, 被任一规则拒绝的请求不占用其他桶的令牌
+    // 连接维度的桶只有本线程访问, 检查到扣除之间不会被改动
+    TokenBucket* typeBucket = nullptr;
+    const Rule& connectionRule = connectionRules[index];
+    if (connectionRule.enabled()) {
+        if (buckets.byType.size() < MESSAGE_TYPE_COUNT)
+            buckets.byType.resize(MESSAGE_TYPE_COUNT);
+        typeBucket = &buckets.byType[index];
+        if (!refill(*typeBucket, connectionRule, nowMs))
+            return false;
+    }
+    if (connectionTotal.enabled() && !refill(buckets.total, connectionTotal, nowMs))
+        return false;
+
+    const Rule& userRule = userRules[index];
+    if (hasUserRules && userID != 0 && userRule.enabled()) {
+        const quint64 key = (static_cast<quint64>(static_cast<quint32>(userID)) << 16) | index;
+        Shard& shard = shards[static_cast<quint32>(userID) % SHARD_COUNT];
+        QMutexLocker locker(&shard.mutex);
+        // 分片里全是正在限流或刚用过的桶时拒绝新用户, 不能为了它重置别人的桶
+        TokenBucket* bucket = userBucket(shard, key, nowMs);
+        if (!bucket || !refill(*bucket, userRule, nowMs))
+            return false;
+        bucket->tokens -= 1.0;
+    }
+
+    if (typeBucket)
+        typeBucket->tokens -= 1.0;
+    if (connectionTotal.enabled())
+        buckets.total.tokens -= 1.0;
+    return true;
+}
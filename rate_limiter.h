@@ -0,0 +1,82 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <vector>
+#include <QHash>
+#include <QMutex>
+#include "com_protocol.h"
+
+// 令牌桶, 按毫秒补充
+struct TokenBucket {
+    double tokens = -1.0;   // 小于 0 表示还没用过, 第一次取用时装满
+    qint64 lastRefill = 0;
+};
+
+// 令牌桶限流, 在分发请求前按连接和用户两个维度检查, 超限的请求直接回复 RATE_LIMITED
+// 规则按 MessageType 配置, 另有一条对连接上所有请求生效的总量规则;
+// 连接维度的桶放在 Session 里, 只由连接所属线程访问, 不加锁; 用户维度的桶跨连接共享, 分片加锁
+class RateLimiter
+{
+public:
+    enum class Scope : uint8_t {
+        CONNECTION,
+        USER        // 未登录的连接不受用户维度的规则限制
+    };
+
+    struct Rule {
+        double ratePerMs = 0.0;
+        double burst = 0.0;
+        bool enabled() const { return burst > 0.0; }
+    };
+
+    // 连接维度的令牌桶, 作为 Session 的成员
+    struct ConnectionBuckets {
+        TokenBucket total;
+        std::vector<TokenBucket> byType;
+    };
+
+    RateLimiter();
+
+    // ratePerSecond 为每秒补充的令牌数, burst 为桶容量; burst <= 0 表示取消该规则
+    // 在服务启动前配置, 运行期间只读
+    void setLimit(MessageType type, Scope scope, double ratePerSecond, int burst);
+    void setConnectionLimit(double ratePerSecond, int burst);
+    // 载入默认规则: 连接总量, 登录注册防暴力尝试, 下单防脚本刷单
+    void useDefaultLimits();
+    void clear();
+
+    // 从每个适用的桶各取一个令牌, 任一桶超限时返回 false 且不扣任何桶; nowMs 为单调时钟毫秒
+    bool allow(MessageType type, int userID, ConnectionBuckets& buckets, qint64 nowMs);
+
+private:
+    static const int SHARD_COUNT = 16;
+    static const int MAX_BUCKETS_PER_SHARD = 4096;
+    static const int EVICTION_SCAN = 16;    // 分片满时每次最多检查的桶数
+
+    struct Slot {
+        quint64 key = 0;            // (userID << 16) | MessageType
+        TokenBucket bucket;
+        bool referenced = false;    // CLOCK 的访问位
+    };
+
+    struct Shard {
+        QMutex mutex;
+        QHash<quint64, int> index;  // key -> entries 下标
+        std::vector<Slot> entries;  // 满之前只追加, 满之后按 CLOCK 顺序替换
+        int hand = 0;
+    };
+
+    // 补充令牌, 返回桶里是否还有一个令牌; 不扣除, 所有桶都有令牌时由 allow 统一扣
+    static bool refill(TokenBucket& bucket, const Rule& rule, qint64 nowMs);
+    // 用户维度的桶, 调用方持有 shard.mutex; 分片满且找不到可淘汰的桶时返回空
+    TokenBucket* userBucket(Shard& shard, quint64 key, qint64 nowMs);
+    static size_t typeIndex(MessageType type) { return static_cast<size_t>(type); }
+
+    Rule connectionTotal;
+    std::vector<Rule> connectionRules;   // 以 MessageType 为下标
+    std::vector<Rule> userRules;
+    bool hasUserRules;
+    Shard shards[SHARD_COUNT];
+};
+
+#endif // RATE_LIMITER_H
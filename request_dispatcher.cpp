@@ -0,0 +1,1153 @@
+#include "request_dispatcher.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <memory>
+#include <QDateTime>
+#include <QDebug>
+#include <QMutexLocker>
+#include "body_codec.h"
+
+namespace {
+
+template<typename Response>
+Response& setError(Response& response, ErrorCode code, const char* message)
+{
+    response.error_code = code;
+    response.error_msg = message;
+    return response;
+}
+
+// 需要登录且只能操作自己的数据
+bool isCurrentUser(const Session& session, int userID)
+{
+    return session.user_id != 0 && session.user_id == userID;
+}
+
+// 分页大小不合法时用默认值, 超过上限时截断; 页码从 1 开始, 偏移量不能超出 int
+const int DEFAULT_PAGE_SIZE = 20;
+const int MAX_PAGE_SIZE = 100;
+
+bool normalizePage(int page, int& pageSize)
+{
+    if (pageSize < 1)
+        pageSize = DEFAULT_PAGE_SIZE;
+    pageSize = std::min(pageSize, MAX_PAGE_SIZE);
+    return page >= 1 && page <= INT_MAX / pageSize;
+}
+
+template<typename T>
+void appendBody(QByteArray& out, MessageType type, BodyCodec codec, const T& value, uint32_t sequenceID)
+{
+    // 每个线程复用一块编码缓冲区
+    thread_local std::string body;
+    body.clear();
+    encodeBody(codec, value, body);
+    ProtocolHelper::appendMessage(out, type, body.data(), static_cast<uint32_t>(body.size()), sequenceID,
+        ProtocolHelper::versionForCodec(codec));
+}
+
+// UPDATE_ORDER_STATUS 允许的状态变化; 支付不走这个接口, 取消走 CANCEL_ORDER
+struct OrderTransition {
+    OrderStatus from;
+    OrderStatus to;
+    bool bySeller;      // false 为买家
+};
+
+const OrderTransition ORDER_TRANSITIONS[] = {
+    { OrderStatus::collecting, OrderStatus::shipping, true },   // 卖家发货
+    { OrderStatus::shipping, OrderStatus::finished, false },    // 买家确认收货
+};
+
+const OrderTransition* findOrderTransition(int from, OrderStatus to)
+{
+    for (const OrderTransition& transition : ORDER_TRANSITIONS) {
+        if (static_cast<int>(transition.from) == from && transition.to == to)
+            return &transition;
+    }
+    return nullptr;
+}
+
+// 会修改数据库的请求, 批量请求中出现时整批放进一个事务
+bool isWriteRequest(MessageType type)
+{
+    switch (type) {
+    case MessageType::REGISTER_REQUEST:
+    case MessageType::UPDATE_USER_INFO_REQUEST:
+    case MessageType::CREATE_PRODUCT_REQUEST:
+    case MessageType::UPDATE_PRODUCT_REQUEST:
+    case MessageType::DELETE_PRODUCT_REQUEST:
+    case MessageType::ADD_TO_CART_REQUEST:
+    case MessageType::UPDATE_CART_ITEM_REQUEST:
+    case MessageType::REMOVE_CART_ITEM_REQUEST:
+    case MessageType::CLEAR_CART_REQUEST:
+    case MessageType::CREATE_ORDER_REQUEST:
+    case MessageType::UPDATE_ORDER_STATUS_REQUEST:
+    case MessageType::CANCEL_ORDER_REQUEST:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// out 中 offset 处的帧是否为 ERROR_RESPONSE
+bool isErrorFrame(const QByteArray& out, qsizetype offset)
+{
+    if (out.size() < offset + static_cast<qsizetype>(PROTOCOL_HEADER_SIZE))
+        return false;
+    ProtocolHeader header;
+    ProtocolHelper::decodeHeader(out.constData() + offset, header);
+    return header.type == static_cast<uint16_t>(MessageType::ERROR_RESPONSE);
+}
+
+int64_t elapsedMicros(std::chrono::steady_clock::time_point started)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count();
+}
+
+// 统计一次分发的耗时, 析构时看追加到 out 的第一帧是否为 ERROR_RESPONSE
+// 这次分发交给了提交线程的写请求不在这里统计, 由 postWrite 在完成时统计
+class RequestTimer
+{
+public:
+    RequestTimer(ServerStats& stats, MessageType type, const Session& session, const QByteArray& out)
+        : stats(stats)
+        , type(type)
+        , session(session)
+        , pendingBefore(session.write_pending)
+        , out(out)
+        , offset(out.size())
+        , started(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~RequestTimer()
+    {
+        if (!pendingBefore && session.write_pending)
+            return;
+        stats.record(type, elapsedMicros(started), isErrorFrame(out, offset));
+    }
+
+private:
+    ServerStats& stats;
+    MessageType type;
+    const Session& session;
+    bool pendingBefore;
+    const QByteArray& out;
+    qsizetype offset;
+    std::chrono::steady_clock::time_point started;
+};
+
+} // namespace
+
+RequestDispatcher::RequestDispatcher(DatabaseManager& dbManager)
+    : db(dbManager)
+    , orderPaymentTimeout(DEFAULT_ORDER_PAYMENT_TIMEOUT_MS)
+    , statsEndpoint(false)
+    , stats(dbManager)
+    , groupCommit(dbManager, dbMutex)
+{
+    limiter.useDefaultLimits();
+
+    // 修改商品和库存的操作都在 dbMutex 内; 读不持锁, 事务提交前读到旧数据的请求
+    // 由 publishProductChanges 在提交后再失效一次, 它们写回缓存时 token 已过期
+    db.addProductListener([this](int productID) {
+        productCache.invalidate(productID);
+        changedProducts.push_back(productID);
+    });
+    // 组提交时商品的修改在组提交之后推送
+    groupCommit.setCommitHook([this]() { publishProductChanges(); });
+}
+
+RequestDispatcher::DbTurn::DbTurn(RequestDispatcher& dispatcher, const Session& session, bool write)
+    : dispatcher(dispatcher)
+    , session(session)
+    , requestClass(session.request_class)
+    , scheduled(!session.db_locked)
+    , write(write)
+{
+}
+
+void RequestDispatcher::DbTurn::lock()
+{
+    if (scheduled)
+        dispatcher.scheduler.acquire(requestClass);
+    if (write)
+        dispatcher.dbMutex.lock();
+    if (scheduled && session.timers)
+        dispatcher.admission.recordSojourn(session.timers->now() - session.received_at);
+}
+
+void RequestDispatcher::DbTurn::unlock()
+{
+    if (write)
+        dispatcher.dbMutex.unlock();
+    if (scheduled)
+        dispatcher.scheduler.release();
+}
+
+void RequestDispatcher::closeSession(Session& session)
+{
+    if (session.push)
+        subscriptions.unsubscribeAll(session.push);
+}
+
+void RequestDispatcher::finishWrite(Session& session)
+{
+    session.write_pending = false;
+    scheduleOrderExpiry(session);
+}
+
+bool RequestDispatcher::postWrite(Session& session, MessageType type, GroupCommit::Work work,
+    std::function<void(bool committed, QByteArray& out)> reply)
+{
+    // 耗时从交出写操作算到响应生成, 包括等待组提交的时间
+    const auto started = std::chrono::steady_clock::now();
+    Session* target = &session;
+    session.write_pending = true;
+    const bool posted = groupCommit.post(std::move(work), [this, target, type, started, reply](bool committed) {
+        QByteArray out;
+        reply(committed, out);
+        stats.record(type, elapsedMicros(started), isErrorFrame(out, 0));
+        target->push->completeWrite(out);
+    });
+    if (!posted)
+        session.write_pending = false;
+    return posted;
+}
+
+template<typename Request, typename Response>
+void RequestDispatcher::invoke(const FrameView& frame, Session& session, QByteArray& out, MessageType responseType,
+    Response (RequestDispatcher::*handler)(const Request&, Session&), bool lockDb)
+{
+    Request request{};
+    std::string error;
+    if (frame.body_length > 0 && !decodeBody(session.codec, frame.body, frame.body_length, request, &error)) {
+        out.append(ProtocolHelper::createErrorResponse(ErrorCode::INVALID_REQUEST, error,
+            frame.header.sequence_id, session.codec));
+        return;
+    }
+
+    if (!lockDb) {
+        appendBody(out, responseType, session.codec, (this->*handler)(request, session), frame.header.sequence_id);
+        return;
+    }
+
+    // 抢购时请求在锁上排队, 拿到锁后再检查一次, 已过期的不再做数据库操作
+    const bool write = isWriteRequest(frame.type());
+    if (write && groupCommit.enabled() && !session.db_locked) {
+        invokeGrouped(frame, session, out, responseType, handler, request);
+        return;
+    }
+
+    Response response{};
+    {
+        DbTurn turn(*this, session, write);
+        QMutexLocker locker(&turn);
+        if (isExpired(session)) {
+            locker.unlock();
+            out.append(ProtocolHelper::createErrorResponse(ErrorCode::OPERATION_TIMEOUT, "请求已超时",
+                frame.header.sequence_id, session.codec));
+            return;
+        }
+        response = (this->*handler)(request, session);
+        if (write)
+            publishProductChanges();
+    }
+    // 写批量内的子请求由批量在提交之后统一安排
+    if (!session.db_locked)
+        scheduleOrderExpiry(session);
+    appendBody(out, responseType, session.codec, response, frame.header.sequence_id);
+}
+
+template<typename Request, typename Response>
+void RequestDispatcher::invokeGrouped(const FrameView& frame, Session& session, QByteArray& out,
+    MessageType responseType, Response (RequestDispatcher::*handler)(const Request&, Session&), const Request& request)
+{
+    // 写请求在提交线程上执行, 写只有提交线程一个, 不再经调度器排队
+    // 请求和结果放在共享的状态里, 本线程不等提交就可能返回
+    struct State {
+        Request request;
+        Response response{};
+        bool expired = false;
+    };
+    auto state = std::make_shared<State>();
+    state->request = request;
+    Session* target = &session;
+    const int userBefore = session.user_id;
+    const uint32_t sequenceID = frame.header.sequence_id;
+
+    auto work = [this, target, state, handler]() {
+        state->expired = isExpired(*target);
+        if (!state->expired)
+            state->response = (this->*handler)(state->request, *target);
+    };
+    auto reply = [target, state, userBefore, sequenceID, responseType](bool committed, QByteArray& message) {
+        if (state->expired) {
+            message.append(ProtocolHelper::createErrorResponse(ErrorCode::OPERATION_TIMEOUT, "请求已超时",
+                sequenceID, target->codec));
+            return;
+        }
+        if (!committed) {
+            // 整组已回滚, 注册成功时设置的登录状态和新订单的超时也撤销
+            target->user_id = userBefore;
+            target->expiring_orders.clear();
+            message.append(ProtocolHelper::createErrorResponse(ErrorCode::DATABASE_ERROR, "提交失败",
+                sequenceID, target->codec));
+            return;
+        }
+        appendBody(message, responseType, target->codec, state->response, sequenceID);
+    };
+
+    // 经网络层的连接不等提交, 响应由 completeWrite 交回; 其他会话在本线程等待
+    if (session.push) {
+        if (!postWrite(session, frame.type(), work, reply))
+            reply(false, out);
+        return;
+    }
+    reply(groupCommit.execute(work), out);
+    scheduleOrderExpiry(session);
+}
+
+template<typename Key, typename Value, typename Fn>
+bool RequestDispatcher::coalesce(SingleFlight<Key, Value>& flight, const Key& key, const Session& session,
+    Value& value, Fn&& fn)
+{
+    if (session.db_locked) {
+        value = fn();
+        return true;
+    }
+    DbTurn turn(*this, session, false);
+    return flight.run(key, turn, [&session]() { return isExpired(session); }, std::forward<Fn>(fn), value);
+}
+
+void RequestDispatcher::handleBatch(const FrameView& frame, Session& session, QByteArray& out)
+{
+    // 先完整解析一遍, 格式错误时整批拒绝, 不执行任何子请求
+    std::vector<FrameView> items;
+    bool hasWrite = false;
+    RequestClass batchClass = RequestClass::BROWSE;
+    const char* cursor = frame.body;
+    const char* end = frame.body + frame.body_length;
+    while (cursor < end) {
+        FrameView item{};
+        MessageType type = MessageType::UNKNOWN;
+        if (static_cast<int>(items.size()) >= MAX_BATCH_ITEMS
+            || !ProtocolHelper::readBatchItem(cursor, end, type, item.body, item.body_length)) {
+            out.append(ProtocolHelper::createErrorResponse(ErrorCode::INVALID_REQUEST, "批量请求格式错误",
+                frame.header.sequence_id, session.codec));
+            return;
+        }
+        // 子请求沿用批量消息的版本和截止时间, sequence_id 为它在批量中的位置
+        item.header = frame.header;
+        item.header.type = static_cast<uint16_t>(type);
+        item.header.sequence_id = static_cast<uint32_t>(items.size());
+        item.header.body_length = item.body_length;
+        hasWrite = hasWrite || isWriteRequest(type);
+        batchClass = qMin(batchClass, RequestScheduler::classify(type));
+        items.push_back(item);
+    }
+
+    const uint32_t sequenceID = frame.header.sequence_id;
+    const int userBefore = session.user_id;
+    auto reply = [sequenceID, userBefore](Session& session, bool began, bool committed, const QByteArray& body,
+                     QByteArray& out) {
+        if (!began || !committed) {
+            session.user_id = userBefore;
+            session.expiring_orders.clear();
+            out.append(ProtocolHelper::createErrorResponse(ErrorCode::DATABASE_ERROR,
+                began ? "批量请求提交失败" : "开始事务失败", sequenceID, session.codec));
+            return;
+        }
+        ProtocolHelper::appendMessage(out, MessageType::BATCH_RESPONSE, body.constData(),
+            static_cast<uint32_t>(body.size()), sequenceID, ProtocolHelper::versionForCodec(session.codec));
+    };
+
+    // 含写操作时整批持锁并放进一个事务, 其他写请求不会插进来; 只读的批量不占名额, 子请求各自排队, 读请求照常合并
+    // 组提交时整批在提交线程上执行, 批量的事务成为组事务中的保存点
+    QByteArray body;
+    bool began = true;
+    bool committed = true;
+    if (!hasWrite) {
+        runBatchItems(items, session, body);
+    }
+    else if (groupCommit.enabled() && session.push) {
+        // 不等提交; 子请求引用的消息体在解码缓冲区里, 之后会被覆盖, 先复制一份
+        struct State {
+            QByteArray frameBody;
+            std::vector<FrameView> items;
+            QByteArray body;
+            bool began = true;
+            bool committed = true;
+        };
+        auto state = std::make_shared<State>();
+        state->frameBody = QByteArray(frame.body, static_cast<qsizetype>(frame.body_length));
+        state->items = std::move(items);
+        for (FrameView& item : state->items) {
+            item.body = state->frameBody.constData() + (item.body - frame.body);
+        }
+        Session* target = &session;
+        auto work = [this, target, state]() {
+            runBatchTransaction(state->items, *target, state->body, state->began, state->committed);
+        };
+        const bool posted = postWrite(session, frame.type(), work, [target, state, reply](bool ok, QByteArray& out) {
+            reply(*target, state->began, state->committed && ok, state->body, out);
+        });
+        if (!posted)
+            reply(session, true, false, body, out);
+        return;
+    }
+    else if (groupCommit.enabled()) {
+        committed = groupCommit.execute([&]() { runBatchTransaction(items, session, body, began, committed); })
+            && committed;
+    }
+    else {
+        // 写批量按其中最优先的子请求排队
+        session.request_class = batchClass;
+        DbTurn turn(*this, session, true);
+        QMutexLocker locker(&turn);
+        runBatchTransaction(items, session, body, began, committed);
+        publishProductChanges();
+    }
+    reply(session, began, committed, body, out);
+    scheduleOrderExpiry(session);
+}
+
+void RequestDispatcher::runBatchItems(const std::vector<FrameView>& items, Session& session, QByteArray& body)
+{
+    QByteArray itemOut;
+    for (const FrameView& item : items) {
+        itemOut.resize(0);
+        if (item.type() == MessageType::BATCH_REQUEST) {
+            itemOut.append(ProtocolHelper::createErrorResponse(ErrorCode::INVALID_REQUEST, "批量请求不能嵌套",
+                item.header.sequence_id, session.codec));
+        }
+        else {
+            dispatch(item, session, itemOut);
+        }
+
+        // 每个子请求恰好产生一帧响应, 去掉协议头后放进批量响应
+        ProtocolHeader header;
+        ProtocolHelper::decodeHeader(itemOut.constData(), header);
+        ProtocolHelper::appendBatchItem(body, static_cast<MessageType>(header.type),
+            itemOut.constData() + PROTOCOL_HEADER_SIZE, header.body_length);
+    }
+}
+
+void RequestDispatcher::runBatchTransaction(const std::vector<FrameView>& items, Session& session, QByteArray& body,
+    bool& began, bool& committed)
+{
+    began = db.beginTransaction();
+    if (!began)
+        return;
+    session.db_locked = true;
+    runBatchItems(items, session, body);
+    session.db_locked = false;
+    committed = db.commitTransaction();
+}
+
+bool RequestDispatcher::isExpired(const Session& session)
+{
+    if (session.deadline_ms == NO_DEADLINE || !session.timers)
+        return false;
+    return session.timers->now() - session.received_at >= session.deadline_ms;
+}
+
+void RequestDispatcher::dispatch(const FrameView& frame, Session& session, QByteArray& out)
+{
+    // 客户端用请求的协议版本选择编码, 响应沿用同一编码
+    session.codec = ProtocolHelper::codecForVersion(frame.header.version);
+    session.deadline_ms = frame.header.deadline_ms;
+    // 被限流和拒绝的请求也计入, 批量请求的子请求各自再计一次
+    const RequestTimer timer(stats, frame.type(), session, out);
+    // 心跳和运行统计不限流也不拒绝, 过载时仍能探活和查看状态
+    const bool control = frame.type() == MessageType::HEARTBEAT || frame.type() == MessageType::STATS_REQUEST;
+
+    // 限流放在解码消息体和访问数据库之前, 超限的请求只花一次取令牌的开销
+    // 没有时间轮的会话 (不经网络层) 不限流
+    if (session.timers && !control
+        && !limiter.allow(frame.type(), session.user_id, session.rate_buckets, session.received_at)) {
+        ProtocolHelper::appendErrorResponse(out, ErrorCode::RATE_LIMITED, "请求过于频繁",
+            frame.header.sequence_id, session.codec);
+        return;
+    }
+
+    // 同一批读入的请求排在前面的处理太久, 后面的可能已经过期
+    if (isExpired(session)) {
+        out.append(ProtocolHelper::createErrorResponse(ErrorCode::OPERATION_TIMEOUT, "请求已超时",
+            frame.header.sequence_id, session.codec));
+        return;
+    }
+
+    // 过载时拒绝排队已满或排队时间持续超标的类别, 写批量持锁期间的子请求已经拿到了数据库, 不拒绝
+    session.request_class = RequestScheduler::classify(frame.type());
+    if (!session.db_locked && !control
+        && (scheduler.shouldShed(session.request_class) || admission.shouldShed(session.request_class))) {
+        ProtocolHelper::appendErrorResponse(out, ErrorCode::SERVER_OVERLOADED, "服务器繁忙, 请稍后重试",
+            frame.header.sequence_id, session.codec, admission.retryAfter());
+        return;
+    }
+
+    switch (frame.type()) {
+    // 认证
+    case MessageType::LOGIN_REQUEST:
+        invoke(frame, session, out, MessageType::LOGIN_RESPONSE, &RequestDispatcher::handleLogin);
+        break;
+    case MessageType::REGISTER_REQUEST:
+        invoke(frame, session, out, MessageType::REGISTER_RESPONSE, &RequestDispatcher::handleRegister);
+        break;
+    case MessageType::LOGOUT_REQUEST: {
+        session.user_id = 0;
+        appendBody(out, MessageType::LOGOUT_RESPONSE, session.codec, BaseResponse{ ErrorCode::SUCCESS, "" },
+            frame.header.sequence_id);
+        break;
+    }
+
+    // 用户
+    case MessageType::GET_USER_INFO_REQUEST:
+        invoke(frame, session, out, MessageType::GET_USER_INFO_RESPONSE, &RequestDispatcher::handleGetUserInfo,
+            false);
+        break;
+    case MessageType::UPDATE_USER_INFO_REQUEST:
+        invoke(frame, session, out, MessageType::UPDATE_USER_INFO_RESPONSE, &RequestDispatcher::handleUpdateUserInfo);
+        break;
+
+    // 商品
+    case MessageType::GET_PRODUCT_LIST_REQUEST:
+        invoke(frame, session, out, MessageType::GET_PRODUCT_LIST_RESPONSE, &RequestDispatcher::handleGetProductList);
+        break;
+    case MessageType::GET_PRODUCT_DETAIL_REQUEST:
+        handleGetProductDetail(frame, session, out);
+        break;
+    case MessageType::CREATE_PRODUCT_REQUEST:
+        invoke(frame, session, out, MessageType::CREATE_PRODUCT_RESPONSE, &RequestDispatcher::handleCreateProduct);
+        break;
+    case MessageType::UPDATE_PRODUCT_REQUEST:
+        invoke(frame, session, out, MessageType::UPDATE_PRODUCT_RESPONSE, &RequestDispatcher::handleUpdateProduct);
+        break;
+    case MessageType::DELETE_PRODUCT_REQUEST:
+        invoke(frame, session, out, MessageType::DELETE_PRODUCT_RESPONSE, &RequestDispatcher::handleDeleteProduct);
+        break;
+    case MessageType::GET_MY_PRODUCTS_REQUEST:
+        invoke(frame, session, out, MessageType::GET_MY_PRODUCTS_RESPONSE, &RequestDispatcher::handleGetMyProducts);
+        break;
+
+    // 购物车
+    case MessageType::GET_CART_REQUEST:
+        invoke(frame, session, out, MessageType::GET_CART_RESPONSE, &RequestDispatcher::handleGetCart, false);
+        break;
+    case MessageType::ADD_TO_CART_REQUEST:
+        invoke(frame, session, out, MessageType::ADD_TO_CART_RESPONSE, &RequestDispatcher::handleAddToCart);
+        break;
+    case MessageType::UPDATE_CART_ITEM_REQUEST:
+        invoke(frame, session, out, MessageType::UPDATE_CART_ITEM_RESPONSE, &RequestDispatcher::handleUpdateCartItem);
+        break;
+    case MessageType::REMOVE_CART_ITEM_REQUEST:
+        invoke(frame, session, out, MessageType::REMOVE_CART_ITEM_RESPONSE, &RequestDispatcher::handleRemoveCartItem);
+        break;
+    case MessageType::CLEAR_CART_REQUEST:
+        invoke(frame, session, out, MessageType::CLEAR_CART_RESPONSE, &RequestDispatcher::handleClearCart);
+        break;
+
+    // 订单
+    case MessageType::CREATE_ORDER_REQUEST:
+        invoke(frame, session, out, MessageType::CREATE_ORDER_RESPONSE, &RequestDispatcher::handleCreateOrder);
+        break;
+    case MessageType::GET_ORDER_LIST_REQUEST:
+        invoke(frame, session, out, MessageType::GET_ORDER_LIST_RESPONSE, &RequestDispatcher::handleGetOrderList);
+        break;
+    case MessageType::GET_ORDER_DETAIL_REQUEST:
+        invoke(frame, session, out, MessageType::GET_ORDER_DETAIL_RESPONSE, &RequestDispatcher::handleGetOrderDetail);
+        break;
+    case MessageType::UPDATE_ORDER_STATUS_REQUEST:
+        invoke(frame, session, out, MessageType::UPDATE_ORDER_STATUS_RESPONSE, &RequestDispatcher::handleUpdateOrderStatus);
+        break;
+    case MessageType::CANCEL_ORDER_REQUEST:
+        invoke(frame, session, out, MessageType::CANCEL_ORDER_RESPONSE, &RequestDispatcher::handleCancelOrder);
+        break;
+
+    // 批量请求
+    case MessageType::BATCH_REQUEST:
+        handleBatch(frame, session, out);
+        break;
+
+    // 订阅, 不访问数据库
+    case MessageType::SUBSCRIBE_REQUEST:
+        invoke(frame, session, out, MessageType::SUBSCRIBE_RESPONSE, &RequestDispatcher::handleSubscribe, false);
+        break;
+    case MessageType::UNSUBSCRIBE_REQUEST:
+        invoke(frame, session, out, MessageType::UNSUBSCRIBE_RESPONSE, &RequestDispatcher::handleUnsubscribe, false);
+        break;
+
+    // 主题
+    case MessageType::CHANGE_THEME_REQUEST:
+        invoke(frame, session, out, MessageType::CHANGE_THEME_RESPONSE, &RequestDispatcher::handleChangeTheme);
+        break;
+
+    // 运行统计, 不访问数据库
+    case MessageType::STATS_REQUEST:
+        invoke(frame, session, out, MessageType::STATS_RESPONSE, &RequestDispatcher::handleGetStats, false);
+        break;
+
+    // 系统消息: 心跳原样回显
+    case MessageType::HEARTBEAT:
+        ProtocolHelper::appendMessage(out, MessageType::HEARTBEAT, frame.body, frame.body_length,
+            frame.header.sequence_id, frame.header.version);
+        break;
+
+    // 图片和促销功能服务端尚未实现
+    case MessageType::UPLOAD_IMAGE_REQUEST:
+    case MessageType::DOWNLOAD_IMAGE_REQUEST:
+    case MessageType::DELETE_IMAGE_REQUEST:
+    case MessageType::APPLY_DISCOUNT_REQUEST:
+    case MessageType::APPLY_COUPON_REQUEST:
+        out.append(ProtocolHelper::createErrorResponse(ErrorCode::INVALID_REQUEST, "暂不支持该功能",
+            frame.header.sequence_id, session.codec));
+        break;
+
+    default:
+        out.append(ProtocolHelper::createErrorResponse(ErrorCode::INVALID_REQUEST, "未知的消息类型",
+            frame.header.sequence_id, session.codec));
+        break;
+    }
+}
+
+LoginResponse RequestDispatcher::handleLogin(const LoginRequest& request, Session& session)
+{
+    LoginResponse response{};
+    const User user = db.getUserByUsername(request.username);
+    if (user.userID == 0 || user.password != request.password)
+        return setError(response, ErrorCode::AUTHENTICATION_FAILED, "用户名或密码错误");
+
+    session.user_id = user.userID;
+    response.user_id = user.userID;
+    response.nickname = user.nickname;
+    response.avatar_url = user.avatarURL;
+    response.balance = user.balance;
+    return response;
+}
+
+RegisterResponse RequestDispatcher::handleRegister(const RegisterRequest& request, Session& session)
+{
+    RegisterResponse response{};
+    if (request.username.empty() || request.password.empty())
+        return setError(response, ErrorCode::INVALID_REQUEST, "用户名和密码不能为空");
+
+    User user{};
+    user.username = request.username;
+    user.password = request.password;
+    user.nickname = request.nickname;
+    user.phone = request.phone;
+    user.rating = 5.0f;
+    user.userLevel = 1;
+    user.registerTime = QDateTime::currentDateTime().toString(Qt::ISODate).toStdString();
+
+    int userID = 0;
+    if (!db.createUser(user, &userID))
+        return setError(response, ErrorCode::INVALID_REQUEST, "注册失败, 用户名可能已存在");
+
+    session.user_id = userID;
+    response.user_id = userID;
+    return response;
+}
+
+UserInfoResponse RequestDispatcher::handleGetUserInfo(const UserInfoRequest& request, Session& session)
+{
+    UserInfoResponse response{};
+    const bool read = coalesce(userFlight, request.user_id, session, response.user_info, [this, &request]() {
+        return db.getUserByID(request.user_id);
+    });
+    if (!read)
+        return setError(response, ErrorCode::OPERATION_TIMEOUT, "请求已超时");
+    if (response.user_info.userID == 0)
+        return setError(response, ErrorCode::RESOURCE_NOT_FOUND, "用户不存在");
+
+    // 密码永不下发, 他人的联系方式和余额也不下发
+    response.user_info.password.clear();
+    if (!isCurrentUser(session, request.user_id)) {
+        response.user_info.phone.clear();
+        response.user_info.default_address.clear();
+        response.user_info.balance = 0.0;
+    }
+    return response;
+}
+
+UpdateUserInfoResponse RequestDispatcher::handleUpdateUserInfo(const UpdateUserInfoRequest& request, Session& session)
+{
+    UpdateUserInfoResponse response{};
+    if (!isCurrentUser(session, request.user_id))
+        return setError(response, ErrorCode::PERMISSION_DENIED, "无权修改该用户");
+
+    User user = db.getUserByID(request.user_id);
+    if (user.userID == 0)
+        return setError(response, ErrorCode::RESOURCE_NOT_FOUND, "用户不存在");
+
+    user.nickname = request.nickname;
+    user.phone = request.phone;
+    user.default_address = request.default_address;
+    if (!db.updateUser(user))
+        return setError(response, ErrorCode::DATABASE_ERROR, "更新用户信息失败");
+    return response;
+}
+
+ProductListResponse RequestDispatcher::handleGetProductList(const ProductListRequest& request, Session&)
+{
+    ProductListResponse response{};
+    int pageSize = request.page_size;
+    if (!normalizePage(request.page, pageSize))
+        return setError(response, ErrorCode::INVALID_REQUEST, "页码无效");
+    response.products = db.getProductList(request.page, pageSize, request.category, request.keyword,
+        &response.total_count);
+    response.total_pages = (response.total_count + pageSize - 1) / pageSize;
+    return response;
+}
+
+void RequestDispatcher::handleGetProductDetail(const FrameView& frame, Session& session, QByteArray& out)
+{
+    ProductDetailRequest request{};
+    std::string error;
+    if (frame.body_length > 0 && !decodeBody(session.codec, frame.body, frame.body_length, request, &error)) {
+        out.append(ProtocolHelper::createErrorResponse(ErrorCode::INVALID_REQUEST, error,
+            frame.header.sequence_id, session.codec));
+        return;
+    }
+
+    QByteArray body;
+    if (!productCache.find(request.product_id, session.codec, body)) {
+        // 只有真正读了数据库的调用方填缓存, 先取 token 再读库
+        bool fetched = false;
+        quint64 token = 0;
+        ProductDetailResponse response{};
+        const bool read = coalesce(productFlight, request.product_id, session, response.product, [&]() {
+            fetched = true;
+            token = productCache.token(request.product_id);
+            return db.getProductByID(request.product_id);
+        });
+        if (!read) {
+            out.append(ProtocolHelper::createErrorResponse(ErrorCode::OPERATION_TIMEOUT, "请求已超时",
+                frame.header.sequence_id, session.codec));
+            return;
+        }
+        if (response.product.productID == 0)
+            setError(response, ErrorCode::RESOURCE_NOT_FOUND, "商品不存在");
+
+        thread_local std::string encoded;
+        encoded.clear();
+        encodeBody(session.codec, response, encoded);
+        body = QByteArray(encoded.data(), static_cast<qsizetype>(encoded.size()));
+        if (fetched && response.error_code == ErrorCode::SUCCESS)
+            productCache.insert(request.product_id, session.codec, token, body);
+    }
+    ProtocolHelper::appendMessage(out, MessageType::GET_PRODUCT_DETAIL_RESPONSE, body.constData(),
+        static_cast<uint32_t>(body.size()), frame.header.sequence_id, ProtocolHelper::versionForCodec(session.codec));
+}
+
+CreateProductResponse RequestDispatcher::handleCreateProduct(const CreateProductRequest& request, Session& session)
+{
+    CreateProductResponse response{};
+    if (session.user_id == 0)
+        return setError(response, ErrorCode::PERMISSION_DENIED, "请先登录");
+
+    // 商品编号由数据库分配, 卖家固定为当前用户
+    Product product = request.product;
+    product.productID = 0;
+    product.sellerID = session.user_id;
+
+    if (!db.createProduct(product, &response.product_id))
+        return setError(response, ErrorCode::DATABASE_ERROR, "创建商品失败");
+    return response;
+}
+
+UpdateProductResponse RequestDispatcher::handleUpdateProduct(const UpdateProductRequest& request, Session& session)
+{
+    UpdateProductResponse response{};
+    const Product existing = db.getProductByID(request.product.productID);
+    if (existing.productID == 0)
+        return setError(response, ErrorCode::RESOURCE_NOT_FOUND, "商品不存在");
+    if (!isCurrentUser(session, existing.sellerID))
+        return setError(response, ErrorCode::PERMISSION_DENIED, "无权修改该商品");
+
+    Product product = request.product;
+    product.sellerID = existing.sellerID;
+    if (!db.updateProduct(product))
+        return setError(response, ErrorCode::DATABASE_ERROR, "更新商品失败");
+    return response;
+}
+
+DeleteProductResponse RequestDispatcher::handleDeleteProduct(const DeleteProductRequest& request, Session& session)
+{
+    DeleteProductResponse response{};
+    const Product existing = db.getProductByID(request.product_id);
+    if (existing.productID == 0)
+        return setError(response, ErrorCode::RESOURCE_NOT_FOUND, "商品不存在");
+    if (!isCurrentUser(session, existing.sellerID))
+        return setError(response, ErrorCode::PERMISSION_DENIED, "无权删除该商品");
+
+    if (!db.deleteProduct(request.product_id))
+        return setError(response, ErrorCode::DATABASE_ERROR, "删除商品失败");
+    return response;
+}
+
+MyProductsResponse RequestDispatcher::handleGetMyProducts(const MyProductsRequest& request, Session& session)
+{
+    MyProductsResponse response{};
+    if (!isCurrentUser(session, request.user_id))
+        return setError(response, ErrorCode::PERMISSION_DENIED, "请先登录");
+    int pageSize = request.page_size;
+    if (!normalizePage(request.page, pageSize))
+        return setError(response, ErrorCode::INVALID_REQUEST, "页码无效");
+
+    response.products = db.getProductsBySeller(request.user_id, request.page, pageSize,
+        &response.total_count);
+    return response;
+}
+
+GetCartResponse RequestDispatcher::handleGetCart(const GetCartRequest& request, Session& session)
+{
+    GetCartResponse response{};
+    if (!isCurrentUser(session, request.user_id))
+        return setError(response, ErrorCode::PERMISSION_DENIED, "请先登录");
+
+    const bool read = coalesce(cartFlight, request.user_id, session, response.cart, [this, &request]() {
+        return db.getCartByUserID(request.user_id);
+    });
+    if (!read)
+        return setError(response, ErrorCode::OPERATION_TIMEOUT, "请求已超时");
+    return response;
+}
+
+AddToCartResponse RequestDispatcher::handleAddToCart(const AddToCartRequest& request, Session& session)
+{
+    AddToCartResponse response{};
+    if (!isCurrentUser(session, request.user_id))
+        return setError(response, ErrorCode::PERMISSION_DENIED, "请先登录");
+    if (request.item.quantity <= 0)
+        return setError(response, ErrorCode::INVALID_REQUEST, "数量必须大于0");
+
+    // 规格必须属于该商品, 否则下单时才失败
+    const Product product = db.getProductByID(request.item.productID);
+    const bool classFound = std::any_of(product.product_class.begin(), product.product_class.end(),
+        [&request](const ProductClass& productClass) { return productClass.classID == request.item.classID; });
+    if (product.productID == 0 || !classFound)
+        return setError(response, ErrorCode::RESOURCE_NOT_FOUND, "商品或规格不存在");
+
+    if (!db.addItemToCart(request.user_id, request.item))
+        return setError(response, ErrorCode::DATABASE_ERROR, "加入购物车失败");
+    return response;
+}
+
+UpdateCartItemResponse RequestDispatcher::handleUpdateCartItem(const UpdateCartItemRequest& request, Session& session)
+{
+    UpdateCartItemResponse response{};
+    if (!isCurrentUser(session, request.user_id))
+        return setError(response, ErrorCode::PERMISSION_DENIED, "请先登录");
+
+    if (!db.updateCartItemQuantity(request.user_id, request.product_id, request.class_id, request.quantity))
+        return setError(response, ErrorCode::RESOURCE_NOT_FOUND, "购物车中没有该商品");
+    return response;
+}
+
+RemoveCartItemResponse RequestDispatcher::handleRemoveCartItem(const RemoveCartItemRequest& request, Session& session)
+{
+    RemoveCartItemResponse response{};
+    if (!isCurrentUser(session, request.user_id))
+        return setError(response, ErrorCode::PERMISSION_DENIED, "请先登录");
+
+    if (!db.removeItemFromCart(request.user_id, request.product_id, request.class_id))
+        return setError(response, ErrorCode::DATABASE_ERROR, "移除购物车商品失败");
+    return response;
+}
+
+ClearCartResponse RequestDispatcher::handleClearCart(const ClearCartRequest& request, Session& session)
+{
+    ClearCartResponse response{};
+    if (!isCurrentUser(session, request.user_id))
+        return setError(response, ErrorCode::PERMISSION_DENIED, "请先登录");
+
+    if (!db.clearCart(request.user_id))
+        return setError(response, ErrorCode::DATABASE_ERROR, "清空购物车失败");
+    return response;
+}
+
+CreateOrderResponse RequestDispatcher::handleCreateOrder(const CreateOrderRequest& request, Session& session)
+{
+    CreateOrderResponse response{};
+    if (!isCurrentUser(session, request.user_id))
+        return setError(response, ErrorCode::PERMISSION_DENIED, "请先登录");
+    if (!request.coupon_code.empty())
+        return setError(response, ErrorCode::INVALID_REQUEST, "优惠券不存在");
+
+    const Cart cart = db.getCartByUserID(request.user_id);
+    if (cart.items.empty())
+        return setError(response, ErrorCode::INVALID_REQUEST, "购物车为空");
+
+    // 订单只有一个卖家, 不同卖家的商品需分别下单
+    std::vector<int> productIDs;
+    for (const auto& item : cart.items) {
+        productIDs.push_back(item.productID);
+    }
+    const std::vector<Product> products = db.getProductsByIDs(productIDs);
+    for (const auto& product : products) {
+        if (product.productID == 0)
+            return setError(response, ErrorCode::RESOURCE_NOT_FOUND, "商品不存在");
+        if (product.sellerID != products.front().sellerID)
+            return setError(response, ErrorCode::INVALID_REQUEST, "购物车中的商品属于不同卖家, 请分别下单");
+    }
+
+    Order order{};
+    order.userID = request.user_id;
+    order.sellerID = products.front().sellerID;
+    // 金额只按购物车计算; discount 由客户端填写, 服务端没有折扣表可以核对, 不采用
+    order.totalAmount = cart.totalAmount;
+    order.status = static_cast<int>(OrderStatus::wait_to_pay);
+    order.address = request.address;
+    order.orderItems = cart.items;
+    order.createdTime = QDateTime::currentDateTime().toString(Qt::ISODate).toStdString();
+
+    // 扣库存、写订单、清购物车在同一事务中完成
+    if (!db.beginTransaction())
+        return setError(response, ErrorCode::DATABASE_ERROR, "创建订单失败");
+
+    for (const auto& item : cart.items) {
+        if (!db.decreaseStock(item.productID, item.classID, item.quantity)) {
+            db.rollbackTransaction();
+            return setError(response, ErrorCode::INSUFFICIENT_STOCK, "库存不足");
+        }
+    }
+
+    int orderID = 0;
+    if (!db.createOrder(order, &orderID) || !db.clearCart(request.user_id)) {
+        db.rollbackTransaction();
+        return setError(response, ErrorCode::DATABASE_ERROR, "创建订单失败");
+    }
+    // 提交失败时 DatabaseManager 已经回滚
+    if (!db.commitTransaction())
+        return setError(response, ErrorCode::DATABASE_ERROR, "创建订单失败");
+
+    response.order_id = orderID;
+    response.final_amount = order.totalAmount;
+
+    // 时间轮只能在连接所属线程上操作, 由 invoke 提交之后安排
+    session.expiring_orders.push_back(orderID);
+    return response;
+}
+
+OrderListResponse RequestDispatcher::handleGetOrderList(const OrderListRequest& request, Session& session)
+{
+    OrderListResponse response{};
+    if (!isCurrentUser(session, request.user_id))
+        return setError(response, ErrorCode::PERMISSION_DENIED, "请先登录");
+    int pageSize = request.page_size;
+    if (!normalizePage(request.page, pageSize))
+        return setError(response, ErrorCode::INVALID_REQUEST, "页码无效");
+
+    response.orders = db.getOrdersByUserID(request.user_id, request.page, pageSize,
+        request.status_filter, &response.total_count);
+    return response;
+}
+
+OrderDetailResponse RequestDispatcher::handleGetOrderDetail(const OrderDetailRequest& request, Session& session)
+{
+    OrderDetailResponse response{};
+    response.order = db.getOrderById(request.order_id);
+    if (response.order.orderID == 0)
+        return setError(response, ErrorCode::RESOURCE_NOT_FOUND, "订单不存在");
+
+    // 买家和卖家都可以查看
+    if (!isCurrentUser(session, response.order.userID) && !isCurrentUser(session, response.order.sellerID)) {
+        response.order = Order{};
+        return setError(response, ErrorCode::PERMISSION_DENIED, "无权查看该订单");
+    }
+    return response;
+}
+
+UpdateOrderStatusResponse RequestDispatcher::handleUpdateOrderStatus(const UpdateOrderStatusRequest& request,
+    Session& session)
+{
+    UpdateOrderStatusResponse response{};
+    const Order order = db.getOrderById(request.order_id);
+    if (order.orderID == 0)
+        return setError(response, ErrorCode::RESOURCE_NOT_FOUND, "订单不存在");
+    if (!isCurrentUser(session, order.userID) && !isCurrentUser(session, order.sellerID))
+        return setError(response, ErrorCode::PERMISSION_DENIED, "无权修改该订单");
+    // 取消订单需要归还库存, 走 CANCEL_ORDER
+    if (request.new_status == OrderStatus::canceled)
+        return setError(response, ErrorCode::INVALID_REQUEST, "请使用取消订单接口");
+    const OrderTransition* transition = findOrderTransition(order.status, request.new_status);
+    if (!transition)
+        return setError(response, ErrorCode::INVALID_REQUEST, "订单当前状态不能改为该状态");
+    if (!isCurrentUser(session, transition->bySeller ? order.sellerID : order.userID))
+        return setError(response, ErrorCode::PERMISSION_DENIED, "无权修改该订单");
+
+    if (!db.updateOrderStatus(request.order_id, static_cast<int>(request.new_status)))
+        return setError(response, ErrorCode::DATABASE_ERROR, "更新订单状态失败");
+    return response;
+}
+
+CancelOrderResponse RequestDispatcher::handleCancelOrder(const CancelOrderRequest& request, Session& session)
+{
+    CancelOrderResponse response{};
+    const Order order = db.getOrderById(request.order_id);
+    if (order.orderID == 0)
+        return setError(response, ErrorCode::RESOURCE_NOT_FOUND, "订单不存在");
+    if (!isCurrentUser(session, order.userID))
+        return setError(response, ErrorCode::PERMISSION_DENIED, "无权取消该订单");
+    if (order.status != static_cast<int>(OrderStatus::wait_to_pay))
+        return setError(response, ErrorCode::INVALID_REQUEST, "订单已支付, 无法取消");
+
+    if (!cancelUnpaidOrder(order))
+        return setError(response, ErrorCode::DATABASE_ERROR, "取消订单失败");
+    return response;
+}
+
+bool RequestDispatcher::cancelUnpaidOrder(const Order& order)
+{
+    if (!db.beginTransaction())
+        return false;
+
+    // 负数即归还库存
+    bool ok = db.updateOrderStatus(order.orderID, static_cast<int>(OrderStatus::canceled));
+    for (const auto& item : order.orderItems) {
+        ok = ok && db.decreaseStock(item.productID, item.classID, -item.quantity);
+    }
+    if (!ok) {
+        db.rollbackTransaction();
+        return false;
+    }
+    return db.commitTransaction();
+}
+
+void RequestDispatcher::expireOrder(int orderID)
+{
+    auto unpaid = std::make_shared<bool>(false);
+    auto canceled = std::make_shared<bool>(false);
+    auto expire = [this, orderID, unpaid, canceled]() {
+        const Order order = db.getOrderById(orderID);
+        // 已支付或已被用户取消
+        *unpaid = order.orderID != 0 && order.status == static_cast<int>(OrderStatus::wait_to_pay);
+        *canceled = *unpaid && cancelUnpaidOrder(order);
+    };
+    auto report = [orderID, unpaid, canceled](bool committed) {
+        if (!*unpaid)
+            return;
+        if (*canceled && committed)
+            qDebug() << "Order" << orderID << "expired without payment";
+        else
+            qDebug() << "Failed to expire order" << orderID;
+    };
+    // 组提交时交给提交线程后立即返回, 插到队首并在执行后立即提交, 不等窗口结束
+    if (groupCommit.enabled()) {
+        if (!groupCommit.post(expire, report, true))
+            qDebug() << "Failed to expire order" << orderID;
+        return;
+    }
+    QMutexLocker locker(&dbMutex);
+    expire();
+    publishProductChanges();
+    report(true);
+}
+
+std::vector<std::pair<int, qint64>> RequestDispatcher::recoverUnpaidOrders()
+{
+    std::vector<std::pair<int, qint64>> pending;
+    if (orderPaymentTimeout <= 0)
+        return pending;
+
+    // createdTime 为创建订单时的本地时间; 无法解析的按刚创建处理, 至少再等一个完整的时限
+    const QDateTime now = QDateTime::currentDateTime();
+    int expired = 0;
+    for (const Order& order : db.getOrdersByStatus(static_cast<int>(OrderStatus::wait_to_pay))) {
+        const QDateTime created = QDateTime::fromString(QString::fromStdString(order.createdTime), Qt::ISODate);
+        const qint64 age = created.isValid() ? qMax<qint64>(0, created.msecsTo(now)) : 0;
+        if (age >= orderPaymentTimeout) {
+            expireOrder(order.orderID);
+            ++expired;
+        }
+        else {
+            pending.emplace_back(order.orderID, orderPaymentTimeout - age);
+        }
+    }
+    if (expired > 0 || !pending.empty())
+        qDebug() << "Recovered unpaid orders:" << expired << "expired," << pending.size() << "rescheduled";
+    return pending;
+}
+
+void RequestDispatcher::scheduleOrderExpiry(Session& session)
+{
+    if (session.timers && orderPaymentTimeout > 0) {
+        for (int orderID : session.expiring_orders) {
+            session.timers->schedule(orderPaymentTimeout, [this, orderID]() {
+                expireOrder(orderID);
+            });
+        }
+    }
+    session.expiring_orders.clear();
+}
+
+void RequestDispatcher::publishProductChanges()
+{
+    if (changedProducts.empty() || db.transactionLevel() > 0)
+        return;
+
+    // 事务回滚时重新读到的状态与上次推送相同, 不会推送
+    std::vector<int> changed;
+    changed.swap(changedProducts);
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+    // 有订阅者的商品一次读出, 组提交后可能有很多个
+    std::vector<int> subscribed;
+    for (int productID : changed) {
+        productCache.invalidate(productID);
+        if (subscriptions.hasSubscribers(productID))
+            subscribed.push_back(productID);
+    }
+    if (subscribed.empty())
+        return;
+    const std::vector<Product> products = db.getProductsByIDs(subscribed);
+    for (size_t i = 0; i < subscribed.size(); ++i) {
+        subscriptions.publish(subscribed[i], products[i]);
+    }
+}
+
+SubscribeResponse RequestDispatcher::handleSubscribe(const SubscribeRequest& request, Session& session)
+{
+    SubscribeResponse response{};
+    if (!session.push)
+        return setError(response, ErrorCode::INVALID_REQUEST, "当前连接不支持推送");
+    for (int productID : request.product_ids) {
+        if (productID <= 0)
+            return setError(response, ErrorCode::INVALID_REQUEST, "商品编号无效");
+    }
+    if (!subscriptions.subscribe(session.push, session.codec, request.product_ids, &response.subscription_count))
+        return setError(response, ErrorCode::INVALID_REQUEST, "订阅的商品过多");
+    return response;
+}
+
+UnsubscribeResponse RequestDispatcher::handleUnsubscribe(const UnsubscribeRequest& request, Session& session)
+{
+    UnsubscribeResponse response{};
+    if (session.push)
+        response.subscription_count = subscriptions.unsubscribe(session.push, request.product_ids);
+    return response;
+}
+
+ChangeThemeResponse RequestDispatcher::handleChangeTheme(const ChangeThemeRequest& request, Session& session)
+{
+    ChangeThemeResponse response{};
+    if (!isCurrentUser(session, request.user_id))
+        return setError(response, ErrorCode::PERMISSION_DENIED, "请先登录");
+
+    // 主题只在客户端生效, 服务端确认即可
+    response.current_theme = request.theme_name;
+    return response;
+}
+
+StatsResponse RequestDispatcher::handleGetStats(const StatsRequest& request, Session& session)
+{
+    StatsResponse response{};
+    if (!statsEndpoint)
+        return setError(response, ErrorCode::PERMISSION_DENIED, "统计接口未开启");
+    if (session.user_id == 0)
+        return setError(response, ErrorCode::PERMISSION_DENIED, "请先登录");
+    return stats.collect(request.min_count);
+}
@@ -0,0 +1,194 @@
+#ifndef REQUEST_DISPATCHER_H
+#define REQUEST_DISPATCHER_H
+
+#include <functional>
+#include <utility>
+#include <vector>
+#include <QByteArray>
+#include <QMutex>
+#include "admission_controller.h"
+#include "com_protocol.h"
+#include "database_manager.h"
+#include "frame_decoder.h"
+#include "group_commit.h"
+#include "rate_limiter.h"
+#include "request_scheduler.h"
+#include "response_cache.h"
+#include "server_stats.h"
+#include "single_flight.h"
+#include "subscription_hub.h"
+#include "timer_wheel.h"
+
+// 每个连接的会话状态, 由网络层持有, 分发器读写
+struct Session {
+    quint64 connection_id = 0;
+    int user_id = 0;            // 0 表示未登录
+    BodyCodec codec = BodyCodec::JSON;  // 由最近一次请求的协议版本决定
+    TimerWheel* timers = nullptr;       // 连接所属 reactor 线程的时间轮
+    qint64 received_at = 0;             // 当前这批请求读入的时间 (timers 时钟), 截止时间预算从这里起算
+    uint16_t deadline_ms = NO_DEADLINE; // 当前请求的截止时间预算, 由 dispatch 从协议头取出
+    bool db_locked = false;             // 正在执行含写操作的批量请求, 本线程已持有 dbMutex
+    PushTarget* push = nullptr;         // 服务端推送出口, 由网络层设置, 为空时不能订阅
+    RateLimiter::ConnectionBuckets rate_buckets;   // 连接维度的限流令牌桶
+    RequestClass request_class = RequestClass::GENERAL; // 当前请求的调度类别
+    std::vector<int> expiring_orders;   // 本次请求创建的待支付订单, 提交之后在连接所属线程上安排支付超时
+    // 写请求已交给组提交线程, 由提交线程读写本会话: 网络层在 push->completeWrite 之前不再分发该连接的请求,
+    // 连接关闭时也要把会话留到那时
+    bool write_pending = false;
+};
+
+// 按 MessageType 把请求帧交给对应的处理函数, 响应帧追加到调用方的发送缓冲区
+// 与具体的网络实现无关, 所有工作线程共享同一个实例
+class RequestDispatcher
+{
+public:
+    explicit RequestDispatcher(DatabaseManager& dbManager);
+
+    void dispatch(const FrameView& frame, Session& session, QByteArray& out);
+
+    // 连接关闭时由网络层调用, 返回后不会再向 session.push 推送
+    void closeSession(Session& session);
+    // 网络层在连接所属线程上收到 completeWrite 后调用, 之后才能继续分发该连接的请求或释放会话
+    void finishWrite(Session& session);
+    // 限流规则在服务启动前配置, 构造时已载入默认规则
+    RateLimiter& rateLimiter() { return limiter; }
+    RequestScheduler& requestScheduler() { return scheduler; }
+    AdmissionController& admissionController() { return admission; }
+    GroupCommit& groupCommitter() { return groupCommit; }
+    const ServerStats& serverStats() const { return stats; }
+
+    // 待支付订单超过 timeoutMs 自动取消, 0 表示不自动取消
+    void setOrderPaymentTimeout(int timeoutMs) { orderPaymentTimeout = timeoutMs; }
+    // STATS_REQUEST 默认关闭, 统计数据由服务端定期写入文件
+    void setStatsEndpointEnabled(bool enabled) { statsEndpoint = enabled; }
+    // 支付超时: 订单仍未支付时取消并归还库存, 在创建订单的 reactor 线程 (或启动恢复时的主线程) 中调用
+    // 组提交时取消在提交线程上执行, 调用方不等它完成
+    void expireOrder(int orderID);
+    // 启动时调用, 支付超时只保存在各连接线程的时间轮里, 重启后需要重新安排:
+    // 已超过支付时限的待支付订单立即取消, 其余返回 (订单编号, 剩余毫秒数), 由调用方到时调用 expireOrder
+    std::vector<std::pair<int, qint64>> recoverUnpaidOrders();
+
+private:
+    // 经调度器排队拿到访问数据库的名额, 写请求再加 dbMutex; 供 QMutexLocker 和 SingleFlight 使用
+    // 写批量持锁期间子请求重入 dbMutex, 不再排队
+    class DbTurn
+    {
+    public:
+        DbTurn(RequestDispatcher& dispatcher, const Session& session, bool write);
+        void lock();
+        void unlock();
+
+    private:
+        RequestDispatcher& dispatcher;
+        const Session& session;
+        RequestClass requestClass;
+        bool scheduled;
+        bool write;
+    };
+
+    // lockDb 为 false 时处理函数自己加锁, 用于经 SingleFlight 合并的读请求
+    template<typename Request, typename Response>
+    void invoke(const FrameView& frame, Session& session, QByteArray& out, MessageType responseType,
+        Response (RequestDispatcher::*handler)(const Request&, Session&), bool lockDb = true);
+
+    // 组提交开启时的写请求: 交给提交线程执行, 组提交之后回复
+    template<typename Request, typename Response>
+    void invokeGrouped(const FrameView& frame, Session& session, QByteArray& out, MessageType responseType,
+        Response (RequestDispatcher::*handler)(const Request&, Session&), const Request& request);
+
+    // 合并相同 key 的并发读; 本线程已持有数据库锁时 (写批量请求) 直接读, 不能去等别的线程
+    // 排队拿到数据库时请求已过期则不读, 返回 false, 调用方回复 OPERATION_TIMEOUT
+    template<typename Key, typename Value, typename Fn>
+    bool coalesce(SingleFlight<Key, Value>& flight, const Key& key, const Session& session, Value& value, Fn&& fn);
+
+    // 认证
+    LoginResponse handleLogin(const LoginRequest& request, Session& session);
+    RegisterResponse handleRegister(const RegisterRequest& request, Session& session);
+
+    // 用户
+    UserInfoResponse handleGetUserInfo(const UserInfoRequest& request, Session& session);
+    UpdateUserInfoResponse handleUpdateUserInfo(const UpdateUserInfoRequest& request, Session& session);
+
+    // 商品
+    ProductListResponse handleGetProductList(const ProductListRequest& request, Session& session);
+    // 商品详情走 productCache, 命中时直接发送缓存的消息体, 不经过 invoke
+    void handleGetProductDetail(const FrameView& frame, Session& session, QByteArray& out);
+    CreateProductResponse handleCreateProduct(const CreateProductRequest& request, Session& session);
+    UpdateProductResponse handleUpdateProduct(const UpdateProductRequest& request, Session& session);
+    DeleteProductResponse handleDeleteProduct(const DeleteProductRequest& request, Session& session);
+    MyProductsResponse handleGetMyProducts(const MyProductsRequest& request, Session& session);
+
+    // 购物车
+    GetCartResponse handleGetCart(const GetCartRequest& request, Session& session);
+    AddToCartResponse handleAddToCart(const AddToCartRequest& request, Session& session);
+    UpdateCartItemResponse handleUpdateCartItem(const UpdateCartItemRequest& request, Session& session);
+    RemoveCartItemResponse handleRemoveCartItem(const RemoveCartItemRequest& request, Session& session);
+    ClearCartResponse handleClearCart(const ClearCartRequest& request, Session& session);
+
+    // 订单
+    CreateOrderResponse handleCreateOrder(const CreateOrderRequest& request, Session& session);
+    OrderListResponse handleGetOrderList(const OrderListRequest& request, Session& session);
+    OrderDetailResponse handleGetOrderDetail(const OrderDetailRequest& request, Session& session);
+    UpdateOrderStatusResponse handleUpdateOrderStatus(const UpdateOrderStatusRequest& request, Session& session);
+    CancelOrderResponse handleCancelOrder(const CancelOrderRequest& request, Session& session);
+
+    // 订阅
+    SubscribeResponse handleSubscribe(const SubscribeRequest& request, Session& session);
+    UnsubscribeResponse handleUnsubscribe(const UnsubscribeRequest& request, Session& session);
+
+    // 主题
+    ChangeThemeResponse handleChangeTheme(const ChangeThemeRequest& request, Session& session);
+
+    // 运行统计
+    StatsResponse handleGetStats(const StatsRequest& request, Session& session);
+
+    // 批量请求: 逐个分发子请求, 含写操作时整批在一个事务里执行
+    void handleBatch(const FrameView& frame, Session& session, QByteArray& out);
+    // 依次分发批量中的子请求, 各自的响应去掉协议头后追加到 body
+    void runBatchItems(const std::vector<FrameView>& items, Session& session, QByteArray& body);
+    // 整批在一个事务中执行; 开始事务失败时一个子请求也不执行, 否则各子请求会各自自动提交
+    void runBatchTransaction(const std::vector<FrameView>& items, Session& session, QByteArray& body,
+        bool& began, bool& committed);
+
+    // 把写操作交给提交线程, 组提交之后在提交线程上由 reply 生成响应, 经 session.push 交回连接所属线程
+    // 期间置 session.write_pending; 提交线程已停止时返回 false, work 和 reply 都不执行
+    bool postWrite(Session& session, MessageType type, GroupCommit::Work work,
+        std::function<void(bool committed, QByteArray& out)> reply);
+
+    // 请求的截止时间预算已经用完, 客户端已放弃等待
+    static bool isExpired(const Session& session);
+
+    // 事务结束后让变化的商品缓存再失效一次并推送给订阅者, 调用方持有 dbMutex; 事务未结束时留到提交之后
+    void publishProductChanges();
+
+    // 为本次请求创建的订单安排支付超时, 在连接所属线程上调用
+    void scheduleOrderExpiry(Session& session);
+
+    // 取消待支付订单并归还库存, 调用方持有 dbMutex
+    bool cancelUnpaidOrder(const Order& order);
+
+    DatabaseManager& db;
+    // 每个工作线程有自己的数据库连接, 读并发执行; 写在这把锁内依次执行, 连接之间不会互等写锁
+    // 批量请求持锁期间会重入
+    QRecursiveMutex dbMutex;
+    int orderPaymentTimeout;
+    bool statsEndpoint;
+
+    // 抢购开始时大量相同的读请求只查一次数据库
+    SingleFlight<int, Product> productFlight;
+    SingleFlight<int, Cart> cartFlight;
+    SingleFlight<int, User> userFlight;
+
+    ResponseCache productCache;     // 商品被修改时经 DatabaseManager 的回调失效
+    RateLimiter limiter;
+    RequestScheduler scheduler;     // 数据库前的排队, 下单优先于浏览
+    AdmissionController admission;  // 排队时间持续过长时拒绝新的浏览请求
+    ServerStats stats;
+
+    SubscriptionHub subscriptions;
+    std::vector<int> changedProducts;   // 被修改但尚未推送的商品, 只有写操作修改, 受 dbMutex 保护
+    // 开启时写请求交给提交线程合并提交; 放在最后, 最先析构, 提交线程停下之后其他成员才析构
+    GroupCommit groupCommit;
+};
+
+#endif // REQUEST_DISPATCHER_H
@@ -0,0 +1,120 @@
+#include "request_scheduler.h"
+
+RequestScheduler::RequestScheduler(int capacity)
+    : capacity(capacity > 0 ? capacity : 1)
+    , active(0)
+    , totalQueued(0)
+{
+    // 同时排队时下单约拿到 16/29 的放行机会, 浏览约 1/29
+    setWeight(RequestClass::CHECKOUT, 16);
+    setWeight(RequestClass::CART, 8);
+    setWeight(RequestClass::GENERAL, 4);
+    setWeight(RequestClass::BROWSE, 1);
+    // 浏览最多占住 4 个工作线程排队, 其余类别不拒绝
+    setShedThreshold(RequestClass::BROWSE, 4);
+}
+
+RequestClass RequestScheduler::classify(MessageType type)
+{
+    switch (type) {
+    case MessageType::CREATE_ORDER_REQUEST:
+    case MessageType::UPDATE_ORDER_STATUS_REQUEST:
+    case MessageType::CANCEL_ORDER_REQUEST:
+    case MessageType::APPLY_DISCOUNT_REQUEST:
+    case MessageType::APPLY_COUPON_REQUEST:
+        return RequestClass::CHECKOUT;
+    case MessageType::GET_CART_REQUEST:
+    case MessageType::ADD_TO_CART_REQUEST:
+    case MessageType::UPDATE_CART_ITEM_REQUEST:
+    case MessageType::REMOVE_CART_ITEM_REQUEST:
+    case MessageType::CLEAR_CART_REQUEST:
+        return RequestClass::CART;
+    case MessageType::GET_PRODUCT_LIST_REQUEST:
+    case MessageType::GET_PRODUCT_DETAIL_REQUEST:
+    case MessageType::DOWNLOAD_IMAGE_REQUEST:
+        return RequestClass::BROWSE;
+    default:
+        return RequestClass::GENERAL;
+    }
+}
+
+void RequestScheduler::setWeight(RequestClass requestClass, int weight)
+{
+    queues[index(requestClass)].weight = weight > 0 ? weight : 1;
+}
+
+void RequestScheduler::setShedThreshold(RequestClass requestClass, int threshold)
+{
+    queues[index(requestClass)].shedThreshold = threshold > 0 ? threshold : 0;
+}
+
+bool RequestScheduler::shouldShed(RequestClass requestClass) const
+{
+    const Queue& queue = queues[index(requestClass)];
+    return queue.shedThreshold > 0 && queue.queued.load(std::memory_order_relaxed) >= queue.shedThreshold;
+}
+
+void RequestScheduler::setCapacity(int capacity)
+{
+    std::lock_guard<std::mutex> locker(mutex);
+    this->capacity = capacity > 0 ? capacity : 1;
+}
+
+void RequestScheduler::acquire(RequestClass requestClass)
+{
+    std::unique_lock<std::mutex> locker(mutex);
+    if (active < capacity && totalQueued == 0) {
+        ++active;
+        return;
+    }
+
+    Queue& queue = queues[index(requestClass)];
+    queue.queued.fetch_add(1, std::memory_order_relaxed);
+    ++totalQueued;
+    queue.wakeup.wait(locker, [&queue]() { return queue.granted > 0; });
+    // 名额由 release 直接转交, active 不变
+    --queue.granted;
+}
+
+void RequestScheduler::release()
+{
+    std::lock_guard<std::mutex> locker(mutex);
+    const int next = pickNext();
+    if (next < 0) {
+        --active;
+        return;
+    }
+
+    Queue& queue = queues[next];
+    queue.queued.fetch_sub(1, std::memory_order_relaxed);
+    --totalQueued;
+    ++queue.granted;
+    queue.wakeup.notify_one();
+}
+
+int RequestScheduler::waiting(RequestClass requestClass) const
+{
+    return queues[index(requestClass)].queued.load(std::memory_order_relaxed);
+}
+
+int RequestScheduler::pickNext()
+{
+    if (totalQueued == 0)
+        return -1;
+
+    int best = -1;
+    int totalWeight = 0;
+    for (int i = 0; i < CLASS_COUNT; ++i) {
+        Queue& queue = queues[i];
+        if (queue.queued.load(std::memory_order_relaxed) == 0) {
+            queue.current = 0;
+            continue;
+        }
+        queue.current += queue.weight;
+        totalWeight += queue.weight;
+        if (best < 0 || queue.current > queues[best].current)
+            best = i;
+    }
+    queues[best].current -= totalWeight;
+    return best;
+}
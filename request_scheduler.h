@@ -0,0 +1,67 @@
+#ifndef REQUEST_SCHEDULER_H
+#define REQUEST_SCHEDULER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include "com_protocol.h"
+
+// 请求的调度类别, 数值越小越优先
+enum class RequestClass : uint8_t {
+    CHECKOUT,   // 下单, 支付, 取消订单, 优惠; 抢购时的下单也在这一类
+    CART,       // 购物车, 抢购的前一步
+    GENERAL,    // 登录注册, 用户信息, 订单查询, 商品管理等
+    BROWSE      // 商品列表, 商品详情, 图片下载
+};
+
+// 默认同时访问数据库的请求数; 读在各线程自己的连接上并发, 写由分发器另外串行
+const int DEFAULT_DB_CONCURRENCY = 4;
+
+// 访问数据库前的多类别排队: 同时访问数据库的请求不超过 capacity 个, 其余按类别排队
+// 有空位时按权重在非空队列之间轮转 (平滑加权轮询), 下单的权重远高于浏览, 不会饿死浏览
+// 排队的是工作线程, 某一类排队数达到阈值后新到的该类请求直接拒绝, 避免浏览请求占住所有工作线程
+class RequestScheduler
+{
+public:
+    static const int CLASS_COUNT = 4;
+
+    explicit RequestScheduler(int capacity = DEFAULT_DB_CONCURRENCY);
+
+    static RequestClass classify(MessageType type);
+
+    // 在服务启动前配置; threshold 为 0 表示该类从不拒绝
+    void setCapacity(int capacity);
+    void setWeight(RequestClass requestClass, int weight);
+    void setShedThreshold(RequestClass requestClass, int threshold);
+
+    // 该类排队数已达阈值, 调用方应直接回复 SERVER_OVERLOADED; 不加锁, 只是近似值
+    bool shouldShed(RequestClass requestClass) const;
+
+    // 阻塞到轮到该请求; 与 release 成对调用
+    void acquire(RequestClass requestClass);
+    void release();
+
+    int waiting(RequestClass requestClass) const;
+
+private:
+    static int index(RequestClass requestClass) { return static_cast<int>(requestClass); }
+    // 按权重选出下一个放行的类别, 没有排队的请求时返回 -1; 调用方持有 mutex
+    int pickNext();
+
+    struct Queue {
+        std::condition_variable wakeup;
+        std::atomic<int> queued{ 0 };   // 在 mutex 内修改
+        int granted = 0;                // 已放行但还没醒来的请求
+        int weight = 1;
+        int current = 0;                // 平滑加权轮询的当前值
+        int shedThreshold = 0;
+    };
+
+    std::mutex mutex;
+    Queue queues[CLASS_COUNT];
+    int capacity;
+    int active;
+    int totalQueued;
+};
+
+#endif // REQUEST_SCHEDULER_H
@@ -0,0 +1,80 @@
+#include "response_cache.h"
+#include <QMutexLocker>
+
+ResponseCache::ResponseCache(int maxProducts)
+    : nextVersion(1)
+    , floorVersion(0)
+    , maxProducts(maxProducts)
+{
+}
+
+bool ResponseCache::find(int productID, BodyCodec codec, QByteArray& body) const
+{
+    QMutexLocker locker(&mutex);
+    auto it = entries.constFind(productID);
+    if (it == entries.constEnd())
+        return false;
+    const QByteArray& cached = it->bodies[static_cast<int>(codec)];
+    if (cached.isEmpty())
+        return false;
+    body = cached;
+    return true;
+}
+
+quint64 ResponseCache::token(int productID) const
+{
+    QMutexLocker locker(&mutex);
+    auto it = entries.constFind(productID);
+    return it == entries.constEnd() ? floorVersion : it->version;
+}
+
+void ResponseCache::insert(int productID, BodyCodec codec, quint64 token, const QByteArray& body)
+{
+    QMutexLocker locker(&mutex);
+    auto it = entries.find(productID);
+    if (it == entries.end()) {
+        if (token != floorVersion)
+            return;
+        // 表满时整体清空, 热门商品很快会重新填回来
+        if (entries.size() >= maxProducts) {
+            entries.clear();
+            floorVersion = nextVersion++;
+            return;
+        }
+        it = entries.insert(productID, Slot());
+        it->version = token;
+    }
+    else if (it->version != token) {
+        return;
+    }
+    it->bodies[static_cast<int>(codec)] = body;
+}
+
+void ResponseCache::invalidate(int productID)
+{
+    // 留下一个新版本的空槽, 让在途的读取写不回来
+    QMutexLocker locker(&mutex);
+    if (!entries.contains(productID) && entries.size() >= maxProducts) {
+        entries.clear();
+        floorVersion = nextVersion++;
+        return;
+    }
+    Slot& slot = entries[productID];
+    slot.version = nextVersion++;
+    for (QByteArray& body : slot.bodies) {
+        body = QByteArray();
+    }
+}
+
+void ResponseCache::clear()
+{
+    QMutexLocker locker(&mutex);
+    entries.clear();
+    floorVersion = nextVersion++;
+}
+
+int ResponseCache::size() const
+{
+    QMutexLocker locker(&mutex);
+    return static_cast<int>(entries.size());
+}
@@ -0,0 +1,43 @@
+#ifndef RESPONSE_CACHE_H
+#define RESPONSE_CACHE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include "com_protocol.h"
+
+// 热门商品详情响应的消息体缓存 (不含协议头), 按商品编号和编码各存一份
+// QByteArray 隐式共享, 命中时只拷贝引用, 发送时与协议头一起追加到发送缓冲区, 不再重新编码
+// 商品被修改时 invalidate; 读数据库前先取 token, 写回时 token 已失效说明期间商品被改过, 丢弃这次结果
+class ResponseCache
+{
+public:
+    explicit ResponseCache(int maxProducts = 4096);
+
+    bool find(int productID, BodyCodec codec, QByteArray& body) const;
+
+    // 在读数据库之前调用; 期间 invalidate 过的商品 insert 时被丢弃
+    quint64 token(int productID) const;
+    void insert(int productID, BodyCodec codec, quint64 token, const QByteArray& body);
+
+    void invalidate(int productID);
+    void clear();
+
+    int size() const;
+
+private:
+    static const int CODEC_COUNT = 2;
+
+    struct Slot {
+        quint64 version = 0;
+        QByteArray bodies[CODEC_COUNT];
+    };
+
+    mutable QMutex mutex;
+    QHash<int, Slot> entries;
+    quint64 nextVersion;
+    quint64 floorVersion;   // 不在表中的商品的 token, clear 时更新
+    int maxProducts;
+};
+
+#endif // RESPONSE_CACHE_H
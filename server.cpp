@@ -0,0 +1,325 @@
+#include "server.h"
+#include <QDebug>
+
+namespace {
+
+// 单次从 socket 读入的上限, 读一块解一块, 缓冲区不会因积压而无限增长
+const qint64 READ_CHUNK_SIZE = 64 * 1024;
+// 暂停读取时 Qt 读缓冲区的上限, 满了之后 Qt 不再从内核读取, 压力经 TCP 窗口传回客户端
+const qint64 READ_BUFFER_LIMIT = 4 * READ_CHUNK_SIZE;
+
+} // namespace
+
+ClientConnection::ClientConnection(QTcpSocket* socket, quint64 connectionID, RequestDispatcher& dispatcher,
+    TimerWheel& timers, size_t highWaterMark, size_t lowWaterMark, int idleTimeout, QObject* parent)
+    : QObject(parent)
+    , socket(socket)
+    , dispatcher(dispatcher)
+    , highWaterMark(highWaterMark)
+    , lowWaterMark(lowWaterMark)
+    , readPaused(false)
+    , timers(timers)
+    , idleTimeout(idleTimeout)
+    , lastActive(timers.now())
+    , idleTimer(0)
+    , socketClosed(false)
+{
+    session.connection_id = connectionID;
+    session.timers = &timers;
+    session.push = this;
+    socket->setParent(this);
+    socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    socket->setReadBufferSize(READ_BUFFER_LIMIT);
+
+    connect(socket, &QTcpSocket::readyRead, this, &ClientConnection::onReadyRead);
+    connect(socket, &QTcpSocket::bytesWritten, this, &ClientConnection::onBytesWritten);
+    connect(socket, &QTcpSocket::disconnected, this, &ClientConnection::onDisconnected);
+
+    armIdleTimer(idleTimeout);
+}
+
+ClientConnection::~ClientConnection()
+{
+    // 工作线程退出时连接可能没有收到 disconnected
+    dispatcher.closeSession(session);
+}
+
+void ClientConnection::push(const QByteArray& message)
+{
+    // 连接销毁后排队中的调用会被 Qt 丢弃
+    QMetaObject::invokeMethod(this, [this, message]() {
+        if (static_cast<size_t>(socket->bytesToWrite()) >= highWaterMark) {
+            qDebug() << "Closing slow subscriber" << session.connection_id;
+            socket->abort();
+            return;
+        }
+        socket->write(message);
+    }, Qt::QueuedConnection);
+}
+
+void ClientConnection::completeWrite(const QByteArray& response)
+{
+    // 连接在写请求完成之前不会销毁, 见 onDisconnected
+    QMetaObject::invokeMethod(this, [this, response]() {
+        onWriteCompleted(response);
+    }, Qt::QueuedConnection);
+}
+
+void ClientConnection::onWriteCompleted(const QByteArray& response)
+{
+    dispatcher.finishWrite(session);
+    emit dispatched();
+    if (socketClosed) {
+        deleteLater();
+        return;
+    }
+    socket->write(response);
+    onReadyRead();
+}
+
+void ClientConnection::armIdleTimer(qint64 delayMs)
+{
+    if (idleTimeout <= 0)
+        return;
+    idleTimer = timers.schedule(delayMs, [this]() {
+        onIdleTimer();
+    });
+}
+
+void ClientConnection::onIdleTimer()
+{
+    // 收到数据时只记录时间, 到期时再按最近活动时间决定断开还是顺延
+    idleTimer = 0;
+    const qint64 idle = timers.now() - lastActive;
+    if (idle < idleTimeout) {
+        armIdleTimer(idleTimeout - idle);
+        return;
+    }
+    qDebug() << "Closing idle connection" << session.connection_id;
+    socket->abort();
+}
+
+void ClientConnection::onReadyRead()
+{
+    // 写请求交给提交线程期间不再分发这个连接的请求, 保证后面的请求能读到它的结果
+    if (readPaused || session.write_pending)
+        return;
+
+    FrameView frame;
+    FrameDecoder::Status status = FrameDecoder::Status::NEED_MORE;
+
+    for (;;) {
+        // 先处理解码缓冲区中已有的请求, 包括上次因写请求暂停而留下的
+        while (!session.write_pending && (status = decoder.next(frame)) == FrameDecoder::Status::FRAME_READY) {
+            dispatcher.dispatch(frame, session, outBuffer);
+        }
+        if (status == FrameDecoder::Status::BAD_HEADER || session.write_pending)
+            break;
+
+        // 客户端收得慢, 待写数据超过高水位后不再处理它的请求
+        if (static_cast<size_t>(socket->bytesToWrite() + outBuffer.size()) >= highWaterMark) {
+            readPaused = true;
+            break;
+        }
+
+        const qint64 available = qMin(socket->bytesAvailable(), READ_CHUNK_SIZE);
+        if (available <= 0)
+            break;
+
+        const qint64 n = socket->read(decoder.prepareWrite(static_cast<size_t>(available)), available);
+        if (n <= 0)
+            break;
+        decoder.commitWrite(static_cast<size_t>(n));
+        lastActive = timers.now();
+        session.received_at = lastActive;
+    }
+
+    if (status == FrameDecoder::Status::BAD_HEADER) {
+        qDebug() << "Invalid frame from connection" << session.connection_id
+                 << "error" << static_cast<int>(decoder.error());
+        outBuffer.append(ProtocolHelper::createErrorResponse(ErrorCode::INVALID_REQUEST, "协议头非法", 0,
+            session.codec));
+    }
+
+    if (!outBuffer.isEmpty()) {
+        socket->write(outBuffer);
+        outBuffer.resize(0);    // 保留容量供下次复用
+    }
+    emit dispatched();
+
+    if (status == FrameDecoder::Status::BAD_HEADER) {
+        socket->disconnectFromHost();
+    }
+}
+
+void ClientConnection::onBytesWritten()
+{
+    if (readPaused && static_cast<size_t>(socket->bytesToWrite()) <= lowWaterMark) {
+        readPaused = false;
+        onReadyRead();
+    }
+}
+
+void ClientConnection::onDisconnected()
+{
+    dispatcher.closeSession(session);
+    timers.cancel(idleTimer);
+    idleTimer = 0;
+    emit closed();
+    if (session.write_pending)
+        socketClosed = true;
+    else
+        deleteLater();
+}
+
+ServerWorker::ServerWorker(RequestDispatcher& dispatcher, QObject* parent)
+    : QObject(parent)
+    , dispatcher(dispatcher)
+    , connections(0)
+    , highWaterMark(DEFAULT_WRITE_HIGH_WATER_MARK)
+    , lowWaterMark(DEFAULT_WRITE_LOW_WATER_MARK)
+    , idleTimeout(DEFAULT_IDLE_TIMEOUT_MS)
+    , wheelTimer(new QTimer(this))
+{
+    wheelTimer->setSingleShot(true);
+    connect(wheelTimer, &QTimer::timeout, this, &ServerWorker::onWheelTimer);
+}
+
+void ServerWorker::addConnection(qintptr socketDescriptor, quint64 connectionID)
+{
+    auto* socket = new QTcpSocket();
+    if (!socket->setSocketDescriptor(socketDescriptor)) {
+        qDebug() << "Failed to adopt socket: " << socket->errorString();
+        delete socket;
+        connections.fetch_sub(1, std::memory_order_relaxed);
+        return;
+    }
+
+    auto* connection = new ClientConnection(socket, connectionID, dispatcher, timers, highWaterMark, lowWaterMark,
+        idleTimeout, this);
+    connect(connection, &ClientConnection::closed, this, [this]() {
+        connections.fetch_sub(1, std::memory_order_relaxed);
+    });
+    connect(connection, &ClientConnection::dispatched, this, &ServerWorker::rearmWheelTimer);
+    rearmWheelTimer();
+}
+
+void ServerWorker::onWheelTimer()
+{
+    timers.advance();
+    rearmWheelTimer();
+}
+
+void ServerWorker::rearmWheelTimer()
+{
+    // nextTimeout() 不超过时间轮第 0 层一圈, 之后新加的定时器最多晚这么久被检查到
+    const int timeout = timers.nextTimeout();
+    if (timeout < 0)
+        wheelTimer->stop();
+    else if (!wheelTimer->isActive() || wheelTimer->remainingTime() > timeout)
+        wheelTimer->start(timeout);
+}
+
+Server::Server(RequestDispatcher& dispatcher, int workerCount, QObject* parent)
+    : QTcpServer(parent)
+    , dispatcher(dispatcher)
+    , nextWorker(0)
+    , nextConnectionID(1)
+{
+    if (workerCount <= 0) {
+        workerCount = qMax(1, QThread::idealThreadCount());
+    }
+
+    for (int i = 0; i < workerCount; ++i) {
+        auto* thread = new QThread(this);
+        thread->setObjectName(QString("irondeal-worker-%1").arg(i));
+
+        auto* worker = new ServerWorker(dispatcher);
+        worker->moveToThread(thread);
+        connect(thread, &QThread::finished, worker, &QObject::deleteLater);
+
+        threads.push_back(thread);
+        workers.push_back(worker);
+    }
+}
+
+Server::~Server()
+{
+    stop();
+}
+
+bool Server::start(const QHostAddress& address, quint16 port)
+{
+    for (QThread* thread : threads) {
+        if (!thread->isRunning())
+            thread->start();
+    }
+
+    if (!listen(address, port)) {
+        qDebug() << "Server listen failed: " << errorString();
+        return false;
+    }
+
+    qDebug() << "Server listening on" << serverAddress().toString() << serverPort()
+             << "with" << workers.size() << "workers";
+    return true;
+}
+
+void Server::stop()
+{
+    close();
+    for (QThread* thread : threads) {
+        thread->quit();
+    }
+    for (QThread* thread : threads) {
+        thread->wait();
+    }
+}
+
+void Server::setWriteWaterMarks(size_t high, size_t low)
+{
+    // 工作线程尚未处理连接, 直接写入
+    for (ServerWorker* worker : workers) {
+        worker->highWaterMark = high;
+        worker->lowWaterMark = low;
+    }
+}
+
+void Server::setIdleTimeout(int timeoutMs)
+{
+    for (ServerWorker* worker : workers) {
+        worker->idleTimeout = timeoutMs;
+    }
+}
+
+ServerWorker* Server::pickWorker()
+{
+    // 从轮询位置开始找连接数最少的工作线程, 负载相同时自然退化为轮询
+    const size_t count = workers.size();
+    size_t best = nextWorker % count;
+    int bestLoad = workers[best]->connectionCount();
+
+    for (size_t i = 1; i < count && bestLoad > 0; ++i) {
+        const size_t index = (nextWorker + i) % count;
+        const int load = workers[index]->connectionCount();
+        if (load < bestLoad) {
+            best = index;
+            bestLoad = load;
+        }
+    }
+
+    nextWorker = best + 1;
+    return workers[best];
+}
+
+void Server::incomingConnection(qintptr socketDescriptor)
+{
+    ServerWorker* worker = pickWorker();
+    const quint64 connectionID = nextConnectionID++;
+
+    // 先计数, 避免连接真正建立前的突发 accept 全部落到同一个线程
+    worker->connections.fetch_add(1, std::memory_order_relaxed);
+    QMetaObject::invokeMethod(worker, [worker, socketDescriptor, connectionID]() {
+        worker->addConnection(socketDescriptor, connectionID);
+    }, Qt::QueuedConnection);
+}
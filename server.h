@@ -0,0 +1,125 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <atomic>
+#include <vector>
+#include <QHostAddress>
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+#include <QTimer>
+#include "frame_decoder.h"
+#include "outbound_queue.h"
+#include "request_dispatcher.h"
+#include "timer_wheel.h"
+#include "transport.h"
+
+// 单个客户端连接, 只在所属工作线程中访问 (push 除外)
+class ClientConnection : public QObject, public PushTarget
+{
+    Q_OBJECT
+
+public:
+    ClientConnection(QTcpSocket* socket, quint64 connectionID, RequestDispatcher& dispatcher, TimerWheel& timers,
+        size_t highWaterMark, size_t lowWaterMark, int idleTimeout, QObject* parent = nullptr);
+    ~ClientConnection() override;
+
+    // 可在任意线程调用, 经事件队列转到所属线程写出
+    void push(const QByteArray& message) override;
+    void completeWrite(const QByteArray& response) override;
+
+signals:
+    void closed();
+    // 处理完一批请求, 期间可能在时间轮上加了定时器 (如订单支付超时)
+    void dispatched();
+
+private slots:
+    void onReadyRead();
+    void onBytesWritten();
+    void onDisconnected();
+
+private:
+    void armIdleTimer(qint64 delayMs);
+    void onIdleTimer();
+    // 交给提交线程的写请求已完成, 写出响应后继续处理暂停的请求
+    void onWriteCompleted(const QByteArray& response);
+
+    QTcpSocket* socket;
+    FrameDecoder decoder;
+    Session session;
+    RequestDispatcher& dispatcher;
+    QByteArray outBuffer;   // 一次 readyRead 内产生的响应合并为一次写入
+    size_t highWaterMark;   // socket 待写字节超过高水位后暂停读取, 降到低水位恢复
+    size_t lowWaterMark;
+    bool readPaused;
+    TimerWheel& timers;
+    int idleTimeout;
+    qint64 lastActive;
+    TimerWheel::TimerId idleTimer;
+    bool socketClosed;      // 断开时写请求还在提交线程上, 会话留到它完成再释放
+};
+
+// 工作线程上的 reactor, 拥有自己的事件循环和分配给它的所有连接
+class ServerWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ServerWorker(RequestDispatcher& dispatcher, QObject* parent = nullptr);
+
+    int connectionCount() const { return connections.load(std::memory_order_relaxed); }
+
+    // 在工作线程中调用, 接管 socket 描述符
+    void addConnection(qintptr socketDescriptor, quint64 connectionID);
+
+private slots:
+    void onWheelTimer();
+    // 时间轮空闲时 QTimer 是停的, 新加的定时器要重新设置它
+    void rearmWheelTimer();
+
+private:
+    friend class Server;
+
+    RequestDispatcher& dispatcher;
+    std::atomic<int> connections;
+    size_t highWaterMark;
+    size_t lowWaterMark;
+    int idleTimeout;
+    TimerWheel timers;      // 本线程所有连接共用, 由单个 QTimer 驱动
+    QTimer* wheelTimer;
+};
+
+// 基于 Qt 的网络后端
+// 监听线程只负责 accept, 连接按最少负载 (相同时轮询) 分给 N 个工作线程
+class Server : public QTcpServer, public Transport
+{
+    Q_OBJECT
+
+public:
+    // workerCount <= 0 时取 CPU 核数
+    explicit Server(RequestDispatcher& dispatcher, int workerCount = 0, QObject* parent = nullptr);
+    ~Server();
+
+    bool start(const QHostAddress& address, quint16 port) override;
+    void stop() override;
+    const char* name() const override { return "qt"; }
+    void setWriteWaterMarks(size_t high, size_t low) override;
+    void setIdleTimeout(int timeoutMs) override;
+
+    int workerCount() const { return static_cast<int>(workers.size()); }
+
+protected:
+    void incomingConnection(qintptr socketDescriptor) override;
+
+private:
+    ServerWorker* pickWorker();
+
+    RequestDispatcher& dispatcher;
+    std::vector<QThread*> threads;
+    std::vector<ServerWorker*> workers;
+    size_t nextWorker;
+    quint64 nextConnectionID;
+};
+
+#endif // SERVER_H
@@ -0,0 +1,255 @@
+// 无界面的服务端入口, 只依赖 QtCore/QtNetwork/QtSql
+#include <memory>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QHostAddress>
+#include <QTimer>
+#include "database_manager.h"
+#include "outbound_queue.h"
+#include "request_dispatcher.h"
+#include "server.h"
+#include "wal_checkpointer.h"
+#ifdef Q_OS_LINUX
+#include "epoll_server.h"
+#endif
+#ifdef Q_OS_UNIX
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include <QSocketNotifier>
+#endif
+
+namespace {
+
+const quint16 DEFAULT_PORT = 8888;
+const int DEFAULT_STATS_INTERVAL_S = 60;
+
+std::unique_ptr<Transport> createTransport(const QString& backend, RequestDispatcher& dispatcher, int workers)
+{
+    if (backend == "qt")
+        return std::make_unique<Server>(dispatcher, workers);
+#ifdef Q_OS_LINUX
+    if (backend == "epoll")
+        return std::make_unique<EpollServer>(dispatcher, workers, EpollServer::Mode::EPOLL);
+    if (backend == "io_uring") {
+        if (!EpollServer::ioUringAvailable()) {
+            qDebug() << "io_uring is not available in this build";
+            return nullptr;
+        }
+        return std::make_unique<EpollServer>(dispatcher, workers, EpollServer::Mode::IO_URING);
+    }
+#endif
+    qDebug() << "Unknown backend:" << backend;
+    return nullptr;
+}
+
+#ifdef Q_OS_UNIX
+// SIGINT/SIGTERM 的处理函数只往管道写一个字节, 事件循环读到后再 quit, 退出流程走 aboutToQuit
+int quitSignalPipe[2] = { -1, -1 };
+
+void onQuitSignal(int)
+{
+    const char byte = 0;
+    const ssize_t written = ::write(quitSignalPipe[1], &byte, 1);
+    (void)written;
+}
+
+bool installQuitSignals(QCoreApplication& app)
+{
+    if (::pipe(quitSignalPipe) != 0) {
+        qDebug() << "Failed to create signal pipe";
+        return false;
+    }
+    for (int fd : quitSignalPipe) {
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+        ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+
+    auto* notifier = new QSocketNotifier(quitSignalPipe[0], QSocketNotifier::Read, &app);
+    QObject::connect(notifier, &QSocketNotifier::activated, &app, [notifier]() {
+        char byte = 0;
+        while (::read(quitSignalPipe[0], &byte, 1) > 0) {
+        }
+        notifier->setEnabled(false);
+        QCoreApplication::quit();
+    });
+
+    struct sigaction action = {};
+    action.sa_handler = onQuitSignal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    return sigaction(SIGINT, &action, nullptr) == 0 && sigaction(SIGTERM, &action, nullptr) == 0;
+}
+#endif
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("irondeal_server");
+#ifdef Q_OS_UNIX
+    if (!installQuitSignals(app))
+        qDebug() << "Failed to install SIGINT/SIGTERM handlers, statistics will not be written on exit";
+#endif
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("IronDeal server");
+    parser.addHelpOption();
+#ifdef Q_OS_LINUX
+    const QString defaultBackend = "epoll";
+#else
+    const QString defaultBackend = "qt";
+#endif
+    const QCommandLineOption dbOption("db", "SQLite database file.", "path", "data/data.db");
+    const QCommandLineOption addressOption("address", "Listen address.", "address", "0.0.0.0");
+    const QCommandLineOption portOption("port", "Listen port.", "port", QString::number(DEFAULT_PORT));
+    const QCommandLineOption backendOption("backend", "Network backend: qt, epoll or io_uring.", "name",
+        defaultBackend);
+    const QCommandLineOption workersOption("workers", "Worker threads, 0 for one per CPU core.", "count", "0");
+    const QCommandLineOption highWaterOption("high-water", "Per-connection send backlog (bytes) that pauses reading.",
+        "bytes", QString::number(DEFAULT_WRITE_HIGH_WATER_MARK));
+    const QCommandLineOption lowWaterOption("low-water", "Send backlog (bytes) at which reading resumes.", "bytes",
+        QString::number(DEFAULT_WRITE_LOW_WATER_MARK));
+    const QCommandLineOption idleOption("idle-timeout", "Close connections idle for this many ms, 0 to disable.",
+        "ms", QString::number(DEFAULT_IDLE_TIMEOUT_MS));
+    const QCommandLineOption paymentOption("payment-timeout", "Cancel unpaid orders after this many ms, 0 to disable.",
+        "ms", QString::number(DEFAULT_ORDER_PAYMENT_TIMEOUT_MS));
+    const QCommandLineOption dbConcurrencyOption("db-concurrency",
+        "Requests allowed to use the database at once; each worker thread has its own connection.", "count",
+        QString::number(DEFAULT_DB_CONCURRENCY));
+    const QCommandLineOption groupWindowOption("group-commit-window",
+        "Merge writes arriving within this many microseconds into one commit, 0 to commit each request.",
+        "us", "0");
+    const QCommandLineOption groupMaxOption("group-commit-max", "Commit a group early once it has this many writes.",
+        "count", QString::number(DEFAULT_GROUP_COMMIT_MAX_WRITES));
+    const StorageProfile defaultStorage;
+    const QCommandLineOption journalOption("journal-mode", "SQLite journal mode, e.g. WAL or DELETE.", "mode",
+        defaultStorage.journalMode);
+    const QCommandLineOption synchronousOption("synchronous", "SQLite synchronous level: OFF, NORMAL or FULL.",
+        "level", defaultStorage.synchronous);
+    const QCommandLineOption cacheSizeOption("cache-size", "SQLite page cache per connection.", "KiB",
+        QString::number(defaultStorage.cacheSizeKiB));
+    const QCommandLineOption mmapSizeOption("mmap-size", "SQLite memory-mapped I/O size, 0 to disable.", "bytes",
+        QString::number(defaultStorage.mmapSize));
+    const QCommandLineOption tempStoreOption("temp-store", "SQLite temp_store: DEFAULT, FILE or MEMORY.", "mode",
+        defaultStorage.tempStore);
+    const QCommandLineOption busyTimeoutOption("busy-timeout", "Wait this many ms for a locked database.", "ms",
+        QString::number(defaultStorage.busyTimeoutMs));
+    const QCommandLineOption checkpointOption("checkpoint-interval",
+        "Checkpoint the WAL in the background every this many ms, 0 to checkpoint on commit.",
+        "ms", QString::number(DEFAULT_CHECKPOINT_INTERVAL_MS));
+    const QCommandLineOption statsFileOption("stats-file", "Periodically write latency statistics to this file.",
+        "path");
+    const QCommandLineOption statsIntervalOption("stats-interval", "Seconds between statistics dumps.", "seconds",
+        QString::number(DEFAULT_STATS_INTERVAL_S));
+    const QCommandLineOption statsEndpointOption("stats-endpoint",
+        "Let logged-in clients read latency statistics with STATS_REQUEST.");
+    parser.addOption(dbOption);
+    parser.addOption(addressOption);
+    parser.addOption(portOption);
+    parser.addOption(backendOption);
+    parser.addOption(workersOption);
+    parser.addOption(highWaterOption);
+    parser.addOption(lowWaterOption);
+    parser.addOption(idleOption);
+    parser.addOption(paymentOption);
+    parser.addOption(dbConcurrencyOption);
+    parser.addOption(journalOption);
+    parser.addOption(synchronousOption);
+    parser.addOption(cacheSizeOption);
+    parser.addOption(mmapSizeOption);
+    parser.addOption(tempStoreOption);
+    parser.addOption(busyTimeoutOption);
+    parser.addOption(checkpointOption);
+    parser.addOption(groupWindowOption);
+    parser.addOption(groupMaxOption);
+    parser.addOption(statsFileOption);
+    parser.addOption(statsEndpointOption);
+    parser.addOption(statsIntervalOption);
+    parser.process(app);
+
+    // 开启后台检查点时, 请求线程提交时不再做检查点
+    const int checkpointInterval = parser.value(checkpointOption).toInt();
+    StorageProfile storage;
+    storage.journalMode = parser.value(journalOption);
+    storage.synchronous = parser.value(synchronousOption);
+    storage.cacheSizeKiB = parser.value(cacheSizeOption).toInt();
+    storage.mmapSize = parser.value(mmapSizeOption).toLongLong();
+    storage.tempStore = parser.value(tempStoreOption);
+    storage.busyTimeoutMs = parser.value(busyTimeoutOption).toInt();
+    if (checkpointInterval > 0)
+        storage.autoCheckpointPages = 0;
+
+    DatabaseManager dbManager;
+    dbManager.setStorageProfile(storage);
+    if (!dbManager.initializeDatabase(parser.value(dbOption))) {
+        qDebug() << "Failed to initialize database";
+        return 1;
+    }
+
+    WalCheckpointer checkpointer(dbManager);
+    if (checkpointInterval > 0) {
+        checkpointer.setInterval(checkpointInterval);
+        checkpointer.start();
+    }
+
+    RequestDispatcher dispatcher(dbManager);
+    dispatcher.setOrderPaymentTimeout(parser.value(paymentOption).toInt());
+    dispatcher.setStatsEndpointEnabled(parser.isSet(statsEndpointOption));
+    dispatcher.requestScheduler().setCapacity(parser.value(dbConcurrencyOption).toInt());
+    dispatcher.groupCommitter().setWindow(parser.value(groupWindowOption).toInt(),
+        parser.value(groupMaxOption).toInt());
+
+    // 上次运行时没等到支付超时的订单: 过期的已取消, 其余在主线程上按剩余时间取消
+    for (const auto& unpaid : dispatcher.recoverUnpaidOrders()) {
+        const int orderID = unpaid.first;
+        QTimer::singleShot(static_cast<int>(unpaid.second), &app, [&dispatcher, orderID]() {
+            dispatcher.expireOrder(orderID);
+        });
+    }
+
+    std::unique_ptr<Transport> transport =
+        createTransport(parser.value(backendOption), dispatcher, parser.value(workersOption).toInt());
+    if (!transport)
+        return 1;
+
+    const size_t highWater = parser.value(highWaterOption).toULongLong();
+    const size_t lowWater = parser.value(lowWaterOption).toULongLong();
+    if (highWater == 0 || lowWater > highWater) {
+        qDebug() << "Invalid water marks" << highWater << lowWater;
+        return 1;
+    }
+    transport->setWriteWaterMarks(highWater, lowWater);
+    transport->setIdleTimeout(parser.value(idleOption).toInt());
+
+    const QHostAddress address(parser.value(addressOption));
+    const quint16 port = static_cast<quint16>(parser.value(portOption).toUInt());
+    if (!transport->start(address, port)) {
+        qDebug() << "Failed to start" << transport->name() << "backend on port" << port;
+        return 1;
+    }
+    qDebug() << "Listening on" << address.toString() << port << "with" << transport->name() << "backend";
+
+    // 统计文件每次整体重写, 退出时再写一次
+    QTimer statsTimer;
+    const QString statsFile = parser.value(statsFileOption);
+    if (!statsFile.isEmpty()) {
+        const int interval = parser.value(statsIntervalOption).toInt();
+        statsTimer.setInterval((interval > 0 ? interval : DEFAULT_STATS_INTERVAL_S) * 1000);
+        QObject::connect(&statsTimer, &QTimer::timeout, [&dispatcher, statsFile]() {
+            dispatcher.serverStats().dump(statsFile);
+        });
+        statsTimer.start();
+    }
+
+    QObject::connect(&app, &QCoreApplication::aboutToQuit, [&transport, &dispatcher, &checkpointer, statsFile]() {
+        // 先让提交线程执行完已交出的写请求, 它的完成回调还要用到网络层的连接
+        dispatcher.groupCommitter().stop();
+        transport->stop();
+        checkpointer.stop();
+        if (!statsFile.isEmpty())
+            dispatcher.serverStats().dump(statsFile);
+    });
+    return app.exec();
+}
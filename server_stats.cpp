@@ -0,0 +1,121 @@
+#include "server_stats.h"
+#include <cstdio>
+#include <QFile>
+
+namespace {
+
+double toMs(uint64_t micros)
+{
+    return static_cast<double>(micros) / 1000.0;
+}
+
+void appendRow(std::string& text, const char* label, const LatencyStats& stats)
+{
+    char line[256];
+    snprintf(line, sizeof(line), "%-28s %10llu %8llu %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f\n", label,
+        static_cast<unsigned long long>(stats.count), static_cast<unsigned long long>(stats.errors), stats.mean_ms,
+        stats.p50_ms, stats.p90_ms, stats.p99_ms, stats.p999_ms, stats.max_ms);
+    text += line;
+}
+
+} // namespace
+
+ServerStats::ServerStats(const DatabaseManager& db)
+    : db(db)
+    , started(std::chrono::steady_clock::now())
+{
+    for (std::atomic<uint64_t>& errors : errorCounts) {
+        errors.store(0, std::memory_order_relaxed);
+    }
+}
+
+void ServerStats::record(MessageType type, int64_t elapsedMicros, bool errorResponse)
+{
+    const int index = static_cast<int>(type);
+    if (index >= TRACKED_TYPES)
+        return;
+    requestLatency[index].record(elapsedMicros);
+    if (errorResponse)
+        errorCounts[index].fetch_add(1, std::memory_order_relaxed);
+}
+
+LatencyStats ServerStats::summarize(const LatencyHistogram::Snapshot& snapshot)
+{
+    LatencyStats stats{};
+    stats.count = snapshot.count;
+    stats.mean_ms = snapshot.mean() / 1000.0;
+    stats.p50_ms = toMs(snapshot.valueAt(0.5));
+    stats.p90_ms = toMs(snapshot.valueAt(0.9));
+    stats.p99_ms = toMs(snapshot.valueAt(0.99));
+    stats.p999_ms = toMs(snapshot.valueAt(0.999));
+    stats.max_ms = toMs(snapshot.max);
+    return stats;
+}
+
+StatsResponse ServerStats::collect(int minCount) const
+{
+    StatsResponse response{};
+    response.uptime_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - started).count();
+
+    const uint64_t threshold = minCount > 0 ? static_cast<uint64_t>(minCount) : 1;
+    for (int type = 0; type < TRACKED_TYPES; ++type) {
+        if (requestLatency[type].count() < threshold)
+            continue;
+        LatencyStats stats = summarize(requestLatency[type].snapshot());
+        stats.message_type = type;
+        stats.errors = errorCounts[type].load(std::memory_order_relaxed);
+        response.requests.push_back(std::move(stats));
+    }
+    for (int i = 0; i < DB_OPERATION_COUNT; ++i) {
+        const DbOperation operation = static_cast<DbOperation>(i);
+        const LatencyHistogram& histogram = db.latency(operation);
+        if (histogram.count() < threshold)
+            continue;
+        LatencyStats stats = summarize(histogram.snapshot());
+        stats.name = DatabaseManager::operationName(operation);
+        response.db_operations.push_back(std::move(stats));
+    }
+    return response;
+}
+
+bool ServerStats::dump(const QString& path) const
+{
+    const StatsResponse stats = collect();
+
+    std::string text;
+    char line[128];
+    snprintf(line, sizeof(line), "uptime_ms %lld\n", static_cast<long long>(stats.uptime_ms));
+    text += line;
+    const char* const header = "%-28s %10s %8s %9s %9s %9s %9s %9s %9s\n";
+    snprintf(line, sizeof(line), header, "request", "count", "errors", "mean_ms", "p50_ms", "p90_ms", "p99_ms",
+        "p999_ms", "max_ms");
+    text += line;
+    for (const LatencyStats& request : stats.requests) {
+        snprintf(line, sizeof(line), "type %d", request.message_type);
+        appendRow(text, line, request);
+    }
+    text += "\n";
+    snprintf(line, sizeof(line), header, "db_operation", "count", "errors", "mean_ms", "p50_ms", "p90_ms", "p99_ms",
+        "p999_ms", "max_ms");
+    text += line;
+    for (const LatencyStats& operation : stats.db_operations) {
+        appendRow(text, operation.name.c_str(), operation);
+    }
+
+    const QString temporaryPath = path + ".tmp";
+    QFile file(temporaryPath);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+        qDebug() << "Cannot write stats file:" << temporaryPath;
+        return false;
+    }
+    const QByteArray bytes(text.data(), static_cast<qsizetype>(text.size()));
+    const bool written = file.write(bytes) == bytes.size();
+    file.close();
+    if (!written) {
+        qDebug() << "Write stats file failed:" << temporaryPath;
+        return false;
+    }
+    QFile::remove(path);
+    return QFile::rename(temporaryPath, path);
+}
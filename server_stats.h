@@ -0,0 +1,38 @@
+#ifndef SERVER_STATS_H
+#define SERVER_STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <QString>
+#include "com_protocol.h"
+#include "database_manager.h"
+#include "latency_histogram.h"
+
+// 服务端运行统计: 每种 MessageType 的处理耗时直方图和错误回复数, 连同 DatabaseManager 各操作的耗时
+// 经 STATS_REQUEST 查询, 也可以定期写到文件; 记录可在任意线程并发调用
+class ServerStats
+{
+public:
+    explicit ServerStats(const DatabaseManager& db);
+
+    // 一个请求处理完: elapsedMicros 为在分发器中的耗时 (含排队等数据库), errorResponse 表示以 ERROR_RESPONSE 回复
+    void record(MessageType type, int64_t elapsedMicros, bool errorResponse);
+
+    StatsResponse collect(int minCount = 0) const;
+
+    // 以文本表格写入 path, 先写临时文件再替换, 读取方不会看到写了一半的文件
+    bool dump(const QString& path) const;
+
+private:
+    // 编号小于此值的 MessageType 单独统计, 其余 (未知类型) 不统计
+    static const int TRACKED_TYPES = 128;
+
+    static LatencyStats summarize(const LatencyHistogram::Snapshot& snapshot);
+
+    const DatabaseManager& db;
+    std::chrono::steady_clock::time_point started;
+    LatencyHistogram requestLatency[TRACKED_TYPES];
+    std::atomic<uint64_t> errorCounts[TRACKED_TYPES];
+};
+
+#endif // SERVER_STATS_H
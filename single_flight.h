@@ -0,0 +1,94 @@
+#ifndef SINGLE_FLIGHT_H
+#define SINGLE_FLIGHT_H
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// 相同 key 的并发读合并为一次: 第一个调用方 (leader) 去数据库读, 其余调用方等待并共享它的结果
+// leader 拿到数据库锁后才关闭本轮合并, 所以等待者拿到的结果一定读于它发起请求之后, 不会读到它自己之前写入前的旧数据
+template<typename Key, typename Value>
+class SingleFlight
+{
+public:
+    // dbLock 只由 leader 加锁, fn 在持锁期间调用, 结果写入 value
+    // leader 拿到锁后先问 expired: 它的请求已过期时不调用 fn, 返回 false; 等它的调用方醒来后另起一轮
+    template<typename Lock, typename Expired, typename Fn>
+    bool run(const Key& key, Lock& dbLock, Expired&& expired, Fn&& fn, Value& value);
+
+    // 当前正在等待结果的 key 数量
+    size_t inFlight() const;
+
+private:
+    struct Call {
+        std::condition_variable done;
+        bool ready = false;
+        bool abandoned = false;
+        Value value{};
+    };
+
+    mutable std::mutex mutex;
+    std::unordered_map<Key, std::shared_ptr<Call>> calls;
+};
+
+template<typename Key, typename Value>
+template<typename Lock, typename Expired, typename Fn>
+bool SingleFlight<Key, Value>::run(const Key& key, Lock& dbLock, Expired&& expired, Fn&& fn, Value& value)
+{
+    std::shared_ptr<Call> call;
+    {
+        std::unique_lock<std::mutex> locker(mutex);
+        for (;;) {
+            auto it = calls.find(key);
+            if (it == calls.end())
+                break;
+            call = it->second;
+            call->done.wait(locker, [&call]() { return call->ready || call->abandoned; });
+            if (call->ready) {
+                value = call->value;
+                return true;
+            }
+            // leader 已过期放弃, 重新查找, 没有别人接手时自己做 leader
+        }
+        call = std::make_shared<Call>();
+        calls.emplace(key, call);
+    }
+
+    dbLock.lock();
+    {
+        // 此后到达的请求另起一轮
+        std::lock_guard<std::mutex> locker(mutex);
+        calls.erase(key);
+    }
+    if (expired()) {
+        dbLock.unlock();
+        {
+            std::lock_guard<std::mutex> locker(mutex);
+            call->abandoned = true;
+        }
+        call->done.notify_all();
+        return false;
+    }
+    Value result = fn();
+    dbLock.unlock();
+
+    {
+        std::lock_guard<std::mutex> locker(mutex);
+        call->value = std::move(result);
+        call->ready = true;
+    }
+    call->done.notify_all();
+    // ready 之后 value 不再修改
+    value = call->value;
+    return true;
+}
+
+template<typename Key, typename Value>
+size_t SingleFlight<Key, Value>::inFlight() const
+{
+    std::lock_guard<std::mutex> locker(mutex);
+    return calls.size();
+}
+
+#endif // SINGLE_FLIGHT_H
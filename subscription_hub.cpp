@@ -0,0 +1,149 @@
+#include "subscription_hub.h"
+#include <algorithm>
+#include <QMutexLocker>
+#include "body_codec.h"
+
+bool SubscriptionHub::subscribe(PushTarget* target, BodyCodec codec, const std::vector<int>& productIDs, int* count)
+{
+    QMutexLocker locker(&mutex);
+    std::vector<int>& subscribed = targets[target];
+
+    std::vector<int> added;
+    for (int productID : productIDs) {
+        if (std::find(subscribed.begin(), subscribed.end(), productID) == subscribed.end()
+            && std::find(added.begin(), added.end(), productID) == added.end())
+            added.push_back(productID);
+    }
+    if (subscribed.size() + added.size() > static_cast<size_t>(MAX_SUBSCRIPTIONS)) {
+        if (count)
+            *count = static_cast<int>(subscribed.size());
+        if (subscribed.empty())
+            targets.remove(target);
+        return false;
+    }
+
+    // 已订阅的商品沿用最新的编码
+    for (int productID : subscribed) {
+        for (Subscriber& subscriber : topics[productID].subscribers) {
+            if (subscriber.target == target)
+                subscriber.codec = codec;
+        }
+    }
+    for (int productID : added) {
+        topics[productID].subscribers.push_back(Subscriber{ target, codec });
+        subscribed.push_back(productID);
+    }
+    if (count)
+        *count = static_cast<int>(subscribed.size());
+    if (subscribed.empty())
+        targets.remove(target);
+    return true;
+}
+
+int SubscriptionHub::unsubscribe(PushTarget* target, const std::vector<int>& productIDs)
+{
+    QMutexLocker locker(&mutex);
+    auto it = targets.find(target);
+    if (it == targets.end())
+        return 0;
+
+    std::vector<int>& subscribed = it.value();
+    const std::vector<int> removing = productIDs.empty() ? subscribed : productIDs;
+    for (int productID : removing) {
+        auto pos = std::find(subscribed.begin(), subscribed.end(), productID);
+        if (pos == subscribed.end())
+            continue;
+        subscribed.erase(pos);
+        removeSubscriber(productID, target);
+    }
+
+    const int remaining = static_cast<int>(subscribed.size());
+    if (remaining == 0)
+        targets.erase(it);
+    return remaining;
+}
+
+void SubscriptionHub::unsubscribeAll(PushTarget* target)
+{
+    unsubscribe(target, std::vector<int>());
+}
+
+bool SubscriptionHub::hasSubscribers(int productID) const
+{
+    QMutexLocker locker(&mutex);
+    return topics.contains(productID);
+}
+
+void SubscriptionHub::removeSubscriber(int productID, PushTarget* target)
+{
+    auto it = topics.find(productID);
+    if (it == topics.end())
+        return;
+    std::vector<Subscriber>& subscribers = it.value().subscribers;
+    subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(),
+        [target](const Subscriber& subscriber) { return subscriber.target == target; }), subscribers.end());
+    if (subscribers.empty())
+        topics.erase(it);
+}
+
+void SubscriptionHub::publish(int productID, const Product& product)
+{
+    QMutexLocker locker(&mutex);
+    auto it = topics.find(productID);
+    if (it == topics.end())
+        return;
+    Topic& topic = it.value();
+
+    std::vector<ClassUpdate> current;
+    if (product.productID != 0) {
+        for (const ProductClass& productClass : product.product_class) {
+            current.push_back(ClassUpdate{ productClass.classID, productClass.stock, productClass.price });
+        }
+    }
+
+    ProductUpdatePush update{ productID, {} };
+    for (const ClassUpdate& now : current) {
+        auto before = std::find_if(topic.last.begin(), topic.last.end(),
+            [&now](const ClassUpdate& last) { return last.class_id == now.class_id; });
+        if (!topic.known || before == topic.last.end() || before->stock != now.stock || before->price != now.price)
+            update.classes.push_back(now);
+    }
+    // 被删掉的规格按库存 0 推送
+    for (const ClassUpdate& last : topic.last) {
+        auto after = std::find_if(current.begin(), current.end(),
+            [&last](const ClassUpdate& now) { return now.class_id == last.class_id; });
+        if (after == current.end())
+            update.classes.push_back(ClassUpdate{ last.class_id, 0, last.price });
+    }
+    topic.last = std::move(current);
+    topic.known = true;
+
+    if (!update.classes.empty()) {
+        QByteArray messages[2];
+        std::string body;
+        for (const Subscriber& subscriber : topic.subscribers) {
+            QByteArray& message = messages[static_cast<int>(subscriber.codec)];
+            if (message.isEmpty()) {
+                body.clear();
+                encodeBody(subscriber.codec, update, body);
+                ProtocolHelper::appendMessage(message, MessageType::PRODUCT_UPDATE_PUSH, body.data(),
+                    static_cast<uint32_t>(body.size()), 0, ProtocolHelper::versionForCodec(subscriber.codec));
+            }
+            subscriber.target->push(message);
+        }
+    }
+
+    // 商品已删除, 订阅没有意义了
+    if (product.productID == 0) {
+        for (const Subscriber& subscriber : topic.subscribers) {
+            auto target = targets.find(subscriber.target);
+            if (target == targets.end())
+                continue;
+            std::vector<int>& subscribed = target.value();
+            subscribed.erase(std::remove(subscribed.begin(), subscribed.end(), productID), subscribed.end());
+            if (subscribed.empty())
+                targets.erase(target);
+        }
+        topics.erase(it);
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef SUBSCRIPTION_HUB_H
+#define SUBSCRIPTION_HUB_H
+
+#include <vector>
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include "com_protocol.h"
+#include "data_info.h"
+
+// 连接的推送出口, 由网络层实现
+class PushTarget
+{
+public:
+    virtual ~PushTarget() = default;
+
+    // 可能在任意线程调用, 实现只把消息转交给连接所属线程, 不能阻塞, 也不能回调 SubscriptionHub
+    // 推送只带有变化的规格, 丢掉一条客户端就会一直显示旧库存; 所以连接待发送数据已达高水位时
+    // 网络层不再追加而是断开它, 客户端重连后重新订阅并读取最新状态
+    virtual void push(const QByteArray& message) = 0;
+
+    // 交给组提交线程的写请求完成后在提交线程上调用, 同样只把响应转交给连接所属线程;
+    // 那边写出响应, 调用 RequestDispatcher::finishWrite, 再继续处理这个连接暂停的请求
+    virtual void completeWrite(const QByteArray& response) = 0;
+};
+
+// 商品库存和价格订阅, 所有连接共享
+// 每个商品记住上次推送的各规格状态, publish 时只推送有变化的规格; 同一条推送按编码各序列化一次, 所有订阅者共享
+class SubscriptionHub
+{
+public:
+    // 超过 MAX_SUBSCRIPTIONS 时不做任何修改并返回 false; count 返回该连接当前的订阅数
+    bool subscribe(PushTarget* target, BodyCodec codec, const std::vector<int>& productIDs, int* count = nullptr);
+    // productIDs 为空时取消全部, 返回剩余的订阅数
+    int unsubscribe(PushTarget* target, const std::vector<int>& productIDs);
+    // 连接关闭时调用, 返回之后不会再向 target 推送
+    void unsubscribeAll(PushTarget* target);
+
+    bool hasSubscribers(int productID) const;
+
+    // 商品的最新状态, product.productID 为 0 表示商品已被删除
+    void publish(int productID, const Product& product);
+
+private:
+    struct Subscriber {
+        PushTarget* target;
+        BodyCodec codec;
+    };
+
+    struct Topic {
+        std::vector<Subscriber> subscribers;
+        std::vector<ClassUpdate> last;  // 上次推送时的状态
+        bool known = false;             // 还没推送过时 last 无效, 第一次推送全部规格
+    };
+
+    // 调用方持有 mutex
+    void removeSubscriber(int productID, PushTarget* target);
+
+    mutable QMutex mutex;
+    QHash<int, Topic> topics;
+    QHash<PushTarget*, std::vector<int>> targets;  // 每个连接订阅的商品
+};
+
+#endif // SUBSCRIPTION_HUB_H
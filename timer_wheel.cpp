@@ -0,0 +1,196 @@
+#include "timer_wheel.h"
+#include <chrono>
+
+namespace {
+
+qint64 monotonicMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+TimerWheel::TimerWheel(int tickMs)
+    : currentTick(0)
+    , startTime(monotonicMs())
+    , tickMs(tickMs > 0 ? tickMs : 1)
+    , count(0)
+{
+    for (uint32_t& head : heads) {
+        head = NIL;
+    }
+}
+
+qint64 TimerWheel::now() const
+{
+    return monotonicMs() - startTime;
+}
+
+TimerWheel::TimerId TimerWheel::schedule(qint64 delayMs, Callback callback)
+{
+    uint32_t index;
+    if (!freeList.empty()) {
+        index = freeList.back();
+        freeList.pop_back();
+    }
+    else {
+        index = static_cast<uint32_t>(nodes.size());
+        nodes.emplace_back();
+    }
+
+    // 向上取整到格, 且至少在下一格触发
+    const qint64 expireMs = now() + qMax<qint64>(0, delayMs);
+    Node& node = nodes[index];
+    node.callback = std::move(callback);
+    node.expireTick = qMax(currentTick + 1, (expireMs + tickMs - 1) / tickMs);
+    place(index);
+    ++count;
+
+    return (static_cast<TimerId>(node.generation) << 32) | (index + 1);
+}
+
+bool TimerWheel::cancel(TimerId id)
+{
+    if (id == 0)
+        return false;
+    const uint32_t index = static_cast<uint32_t>(id & 0xFFFFFFFF) - 1;
+    if (index >= nodes.size())
+        return false;
+    Node& node = nodes[index];
+    if (node.slot == NIL || node.generation != static_cast<uint32_t>(id >> 32))
+        return false;
+
+    unlink(index);
+    release(index);
+    return true;
+}
+
+void TimerWheel::place(uint32_t index)
+{
+    const qint64 expire = nodes[index].expireTick;
+    const qint64 delta = expire - currentTick;
+
+    // 按剩余格数选层; 超出最高层范围的先放在最高层最远的槽, 转到时再重新落槽
+    for (int level = 0; level < LEVELS; ++level) {
+        const qint64 range = qint64(1) << (SLOT_BITS * (level + 1));
+        if (delta < range || level == LEVELS - 1) {
+            const qint64 target = delta < range ? expire : currentTick + range - 1;
+            const uint32_t slot = static_cast<uint32_t>((target >> (SLOT_BITS * level)) & (SLOTS - 1));
+            link(index, static_cast<uint32_t>(level * SLOTS) + slot);
+            return;
+        }
+    }
+}
+
+void TimerWheel::link(uint32_t index, uint32_t slot)
+{
+    Node& node = nodes[index];
+    node.slot = slot;
+    node.prev = NIL;
+    node.next = heads[slot];
+    if (node.next != NIL)
+        nodes[node.next].prev = index;
+    heads[slot] = index;
+}
+
+void TimerWheel::unlink(uint32_t index)
+{
+    Node& node = nodes[index];
+    if (node.prev != NIL)
+        nodes[node.prev].next = node.next;
+    else
+        heads[node.slot] = node.next;
+    if (node.next != NIL)
+        nodes[node.next].prev = node.prev;
+    node.prev = NIL;
+    node.next = NIL;
+}
+
+void TimerWheel::release(uint32_t index)
+{
+    Node& node = nodes[index];
+    node.callback = nullptr;
+    node.slot = NIL;
+    ++node.generation;
+    freeList.push_back(index);
+    --count;
+}
+
+void TimerWheel::cascade(int level)
+{
+    // 把上层当前槽的定时器按剩余时间重新放到下层
+    const uint32_t slot = static_cast<uint32_t>(level * SLOTS)
+        + static_cast<uint32_t>((currentTick >> (SLOT_BITS * level)) & (SLOTS - 1));
+    uint32_t index = heads[slot];
+    heads[slot] = NIL;
+    while (index != NIL) {
+        const uint32_t next = nodes[index].next;
+        place(index);
+        index = next;
+    }
+}
+
+void TimerWheel::expireCurrent()
+{
+    const uint32_t slot = static_cast<uint32_t>(currentTick & (SLOTS - 1));
+    uint32_t index = heads[slot];
+    heads[slot] = NIL;
+
+    // 先整体挪到 EXPIRING_SLOT, 回调中取消同一批里的其他定时器也是安全的
+    while (index != NIL) {
+        const uint32_t next = nodes[index].next;
+        link(index, EXPIRING_SLOT);
+        index = next;
+    }
+
+    while ((index = heads[EXPIRING_SLOT]) != NIL) {
+        unlink(index);
+        if (nodes[index].expireTick > currentTick) {
+            place(index);
+            continue;
+        }
+        Callback callback = std::move(nodes[index].callback);
+        release(index);
+        callback();
+    }
+}
+
+void TimerWheel::advance()
+{
+    const qint64 targetTick = now() / tickMs;
+    if (count == 0) {
+        currentTick = qMax(currentTick, targetTick);
+        return;
+    }
+
+    while (currentTick < targetTick) {
+        ++currentTick;
+        // 低层转完一圈时, 从上层取下一批
+        for (int level = 1; level < LEVELS; ++level) {
+            if ((currentTick & ((qint64(1) << (SLOT_BITS * level)) - 1)) != 0)
+                break;
+            cascade(level);
+        }
+        expireCurrent();
+        if (count == 0) {
+            currentTick = targetTick;
+            break;
+        }
+    }
+}
+
+int TimerWheel::nextTimeout() const
+{
+    if (count == 0)
+        return -1;
+
+    // 只看第 0 层到下一次进位为止, 更远的定时器由进位时的 advance() 处理
+    qint64 tick = currentTick + 1;
+    for (; tick <= currentTick + SLOTS; ++tick) {
+        if (heads[tick & (SLOTS - 1)] != NIL || (tick & (SLOTS - 1)) == 0)
+            break;
+    }
+    const qint64 wait = tick * tickMs - now();
+    return static_cast<int>(qBound<qint64>(0, wait, SLOTS * tickMs));
+}
@@ -0,0 +1,67 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <QtGlobal>
+
+// 分层时间轮, 每个 reactor 线程一个, 只在所属线程访问
+// 4 层 x 64 槽, 默认每格 10ms: 第 0 层覆盖 640ms, 第 3 层约 46 小时, 更远的定时器到时再重新落槽
+// 定时器节点放在数组里复用, 插入和取消都是 O(1), 不为每个定时器单独分配内存
+class TimerWheel
+{
+public:
+    using Callback = std::function<void()>;
+    using TimerId = quint64;    // 0 表示无效
+
+    explicit TimerWheel(int tickMs = 10);
+
+    // delayMs 毫秒后在 advance() 中调用 callback; 回调里可以再添加或取消定时器
+    TimerId schedule(qint64 delayMs, Callback callback);
+    // 已触发或已取消的定时器返回 false
+    bool cancel(TimerId id);
+
+    // 触发所有到期的定时器
+    void advance();
+
+    // 距离下一次需要调用 advance() 的毫秒数, 没有定时器时返回 -1, 可直接作为 epoll_wait 的超时
+    int nextTimeout() const;
+
+    // 时间轮创建以来的毫秒数 (单调时钟)
+    qint64 now() const;
+    size_t size() const { return count; }
+
+private:
+    static const int LEVELS = 4;
+    static const int SLOT_BITS = 6;
+    static const int SLOTS = 1 << SLOT_BITS;
+    static const uint32_t NIL = UINT32_MAX;
+    static const uint32_t EXPIRING_SLOT = LEVELS * SLOTS;  // 正在触发的链表
+
+    struct Node {
+        Callback callback;
+        qint64 expireTick = 0;
+        uint32_t prev = NIL;
+        uint32_t next = NIL;
+        uint32_t slot = NIL;        // 所在槽, NIL 表示空闲
+        uint32_t generation = 0;    // 节点复用后旧的 TimerId 失效
+    };
+
+    void place(uint32_t index);
+    void link(uint32_t index, uint32_t slot);
+    void unlink(uint32_t index);
+    void release(uint32_t index);
+    void cascade(int level);
+    void expireCurrent();
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> freeList;
+    uint32_t heads[LEVELS * SLOTS + 1];
+    qint64 currentTick;
+    qint64 startTime;
+    int tickMs;
+    size_t count;
+};
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,26 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <QHostAddress>
+
+// 网络后端接口
+// 后端只负责收发 ProtocolHeader 帧, 业务处理统一交给 RequestDispatcher
+class Transport
+{
+public:
+    virtual ~Transport() = default;
+
+    virtual bool start(const QHostAddress& address, quint16 port) = 0;
+    virtual void stop() = 0;
+
+    // 后端名称, 用于日志
+    virtual const char* name() const = 0;
+
+    // 单连接待发送数据的高/低水位 (字节), 超过高水位停止读取该连接, 降到低水位恢复; 在 start() 之前调用
+    virtual void setWriteWaterMarks(size_t high, size_t low) = 0;
+
+    // 连接超过 timeoutMs 没有收到任何数据 (包括心跳) 即断开, 0 表示不检查; 在 start() 之前调用
+    virtual void setIdleTimeout(int timeoutMs) = 0;
+};
+
+#endif // TRANSPORT_H
@@ -0,0 +1,84 @@
+#include "wal_checkpointer.h"
+
+WalCheckpointer::WalCheckpointer(DatabaseManager& db)
+    : db(db)
+    , interval(DEFAULT_CHECKPOINT_INTERVAL_MS)
+    , truncatePages(DEFAULT_CHECKPOINT_TRUNCATE_PAGES)
+    , lastVersion(-1)
+    , walPages(0)
+    , backlogPages(0)
+    , stopping(false)
+{
+}
+
+WalCheckpointer::~WalCheckpointer()
+{
+    stop();
+}
+
+void WalCheckpointer::setInterval(int intervalMs)
+{
+    interval = std::chrono::milliseconds(intervalMs > 0 ? intervalMs : DEFAULT_CHECKPOINT_INTERVAL_MS);
+}
+
+void WalCheckpointer::setTruncatePages(int pages)
+{
+    truncatePages = pages > 0 ? pages : DEFAULT_CHECKPOINT_TRUNCATE_PAGES;
+}
+
+void WalCheckpointer::start()
+{
+    if (thread.joinable())
+        return;
+    stopping = false;
+    thread = std::thread([this]() { run(); });
+}
+
+void WalCheckpointer::stop()
+{
+    {
+        std::lock_guard<std::mutex> locker(mutex);
+        stopping = true;
+    }
+    wakeup.notify_all();
+    if (thread.joinable())
+        thread.join();
+}
+
+void WalCheckpointer::run()
+{
+    // 本线程在 DatabaseManager 中有自己的连接, 不占请求线程的连接; 等待上限只改这个连接
+    db.setBusyTimeout(CHECKPOINT_BUSY_TIMEOUT_MS);
+    std::unique_lock<std::mutex> locker(mutex);
+    while (!wakeup.wait_for(locker, interval, [this]() { return stopping; })) {
+        locker.unlock();
+        checkpoint();
+        locker.lock();
+    }
+}
+
+void WalCheckpointer::checkpoint()
+{
+    const qint64 version = db.dataVersion();
+    if (version < 0)
+        return;
+
+    if (version != lastVersion || backlogPages > 0) {
+        // 有新的提交或上次没合并完: PASSIVE 不等读写, 不影响请求
+        lastVersion = version;
+        int checkpointedPages = 0;
+        if (db.checkpoint(CheckpointMode::PASSIVE, &walPages, &checkpointedPages))
+            backlogPages = walPages > checkpointedPages ? walPages - checkpointedPages : 0;
+        return;
+    }
+
+    // 整个周期没有提交, WAL 已全部合并但文件还很大
+    if (walPages < truncatePages)
+        return;
+    int remaining = 0;
+    if (db.checkpoint(CheckpointMode::TRUNCATE, &remaining)) {
+        walPages = 0;
+        return;
+    }
+    qDebug() << "WAL truncate checkpoint deferred," << walPages << "pages";
+}
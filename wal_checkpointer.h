@@ -0,0 +1,54 @@
+#ifndef WAL_CHECKPOINTER_H
+#define WAL_CHECKPOINTER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "database_manager.h"
+
+const int DEFAULT_CHECKPOINT_INTERVAL_MS = 1000;
+// 4 KiB 的页约 64 MiB
+const int DEFAULT_CHECKPOINT_TRUNCATE_PAGES = 16384;
+// TRUNCATE 等读结束的上限, 期间到达的写最多被挡住这么久
+const int CHECKPOINT_BUSY_TIMEOUT_MS = 50;
+
+// 后台 WAL 检查点线程: 请求线程提交时不再做检查点 (StorageProfile::autoCheckpointPages 设为 0)
+// 每个周期先看 data_version, 上个周期以来有提交时做 PASSIVE 检查点, 不等读写, 合并多少算多少;
+// 没有新提交且 WAL 已全部合并但页数超过 truncatePages 时, 说明刚过一阵写高峰, 趁空闲做 TRUNCATE 清空 WAL 文件,
+// 检查点线程自己的连接只等 CHECKPOINT_BUSY_TIMEOUT_MS, 等不到就留到下一个空闲周期
+class WalCheckpointer
+{
+public:
+    explicit WalCheckpointer(DatabaseManager& db);
+    ~WalCheckpointer();
+
+    // 在 start 之前配置
+    void setInterval(int intervalMs);
+    void setTruncatePages(int pages);
+
+    void start();
+    // 等正在做的检查点结束后退出线程
+    void stop();
+
+private:
+    void run();
+    // 一个周期的检查
+    void checkpoint();
+
+    DatabaseManager& db;
+    std::chrono::milliseconds interval;
+    int truncatePages;
+
+    // 以下只在检查点线程中访问
+    qint64 lastVersion;
+    int walPages;       // 上次检查点时 WAL 中的页数
+    int backlogPages;   // 上次检查点后还没合并回数据库的页数
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    bool stopping;
+};
+
+#endif // WAL_CHECKPOINTER_H